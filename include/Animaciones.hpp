@@ -0,0 +1,178 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <array>
+
+// ---------------------- Animaciones (tweens) ----------------------
+// Planificador con un número fijo de huecos: lanzar una animación no reserva memoria y
+// todas las activas se avanzan en una sola pasada por frame con el mismo dt, así que la
+// duración no depende de los FPS. Si el planificador está lleno la animación se aplica
+// directamente en su estado final.
+
+enum class Suavizado { Lineal, SalidaCubica, EntradaSalidaCubica };
+
+inline float aplicarSuavizado(Suavizado s, float t){
+    if (t <= 0.f) return 0.f;
+    if (t >= 1.f) return 1.f;
+    switch(s){
+        case Suavizado::Lineal: return t;
+        case Suavizado::SalidaCubica: { float u = 1.f - t; return 1.f - u*u*u; }
+        case Suavizado::EntradaSalidaCubica: {
+            if (t < 0.5f) return 4.f*t*t*t;
+            float u = -2.f*t + 2.f;
+            return 1.f - u*u*u/2.f;
+        }
+    }
+    return t;
+}
+
+const int MAX_ANIMACIONES = 64;
+
+struct Tween {
+    sf::Sprite* sprite = nullptr;
+    float transcurrido = 0.f;
+    float duracion = 0.f;
+    Suavizado suavizado = Suavizado::Lineal;
+
+    bool animaPosicion = false;
+    sf::Vector2f desdePos, hastaPos;
+    bool animaEscala = false;
+    sf::Vector2f desdeEsc, hastaEsc;
+    bool animaAlfa = false;
+    float desdeAlfa = 255.f, hastaAlfa = 255.f;
+
+    bool ocultarAlTerminar = false;   // al acabar se manda el sprite fuera de pantalla
+    bool* enCurso = nullptr;          // se pone a false al acabar (p.ej. Pieza::animandoCaptura)
+};
+
+struct PlanificadorAnimaciones {
+    std::array<Tween, MAX_ANIMACIONES> huecos;
+    std::array<int, MAX_ANIMACIONES> activos;   // índices de huecos en uso, compactos
+    int numActivos = 0;
+    float velocidad = 1.0f;                     // >1 acelera todas las animaciones (repeticiones)
+
+    // Mueve el sprite desde donde está hasta 'destino'
+    void mover(sf::Sprite &s, sf::Vector2f destino, float duracion, Suavizado suav = Suavizado::SalidaCubica){
+        Tween *t = reservar(s);
+        if (!t){ s.setPosition(destino); return; }
+        t->duracion = duracion;
+        t->suavizado = suav;
+        t->animaPosicion = true;
+        t->desdePos = s.getPosition();
+        t->hastaPos = destino;
+    }
+
+    // Encoge y desvanece el sprite; al acabar lo oculta y pone *enCurso a false
+    void capturar(sf::Sprite &s, float baseSx, float baseSy, float duracion, bool *enCurso){
+        Tween *t = reservar(s);
+        if (enCurso) *enCurso = true;
+        if (!t){
+            Tween fin;
+            fin.sprite = &s; fin.ocultarAlTerminar = true; fin.enCurso = enCurso;
+            terminar(fin);
+            return;
+        }
+        t->duracion = duracion;
+        t->suavizado = Suavizado::Lineal;
+        t->animaEscala = true;
+        t->desdeEsc = sf::Vector2f(baseSx, baseSy);
+        t->hastaEsc = sf::Vector2f(0.f, 0.f);
+        t->animaAlfa = true;
+        t->desdeAlfa = 255.f;
+        t->hastaAlfa = 0.f;
+        t->ocultarAlTerminar = true;
+        t->enCurso = enCurso;
+    }
+
+    bool animando(const sf::Sprite &s) const {
+        return buscar(s) != -1;
+    }
+
+    // Quita la animación del sprite. Si 'completar', salta a su estado final; si no, se queda donde está.
+    void detener(const sf::Sprite &s, bool completar){
+        int k = buscar(s);
+        if (k == -1) return;
+        Tween &t = huecos[activos[k]];
+        if (completar || t.ocultarAlTerminar){
+            t.transcurrido = t.duracion;
+            aplicar(t);
+            terminar(t);
+        }
+        quitar(k);
+    }
+
+    // Termina todas las animaciones en su estado final
+    void completarTodas(){
+        for (int k=0;k<numActivos;++k){
+            Tween &t = huecos[activos[k]];
+            t.transcurrido = t.duracion;
+            aplicar(t);
+            terminar(t);
+        }
+        numActivos = 0;
+    }
+
+    // Una pasada por frame sobre las animaciones activas
+    void avanzar(float dt){
+        dt *= velocidad;
+        for (int k=0;k<numActivos;){
+            Tween &t = huecos[activos[k]];
+            t.transcurrido += dt;
+            aplicar(t);
+            if (t.transcurrido >= t.duracion){
+                terminar(t);
+                quitar(k);          // el último ocupa la posición k: no avanzar
+            } else {
+                ++k;
+            }
+        }
+    }
+
+private:
+    int buscar(const sf::Sprite &s) const {
+        for (int k=0;k<numActivos;++k) if (huecos[activos[k]].sprite == &s) return k;
+        return -1;
+    }
+
+    // Devuelve un hueco limpio para el sprite (reutiliza el suyo si ya estaba animándose)
+    Tween* reservar(sf::Sprite &s){
+        int k = buscar(s);
+        int h;
+        if (k != -1){
+            h = activos[k];
+        } else {
+            if (numActivos == MAX_ANIMACIONES) return nullptr;
+            // buscar un hueco que no esté en la lista de activos
+            bool usado[MAX_ANIMACIONES] = {};
+            for (int i=0;i<numActivos;++i) usado[activos[i]] = true;
+            h = 0;
+            while (usado[h]) ++h;
+            activos[numActivos++] = h;
+        }
+        huecos[h] = Tween();
+        huecos[h].sprite = &s;
+        return &huecos[h];
+    }
+
+    void quitar(int k){
+        activos[k] = activos[--numActivos];
+    }
+
+    static void aplicar(Tween &t){
+        float u = (t.duracion > 0.f) ? t.transcurrido / t.duracion : 1.f;
+        float e = aplicarSuavizado(t.suavizado, u);
+        if (t.animaPosicion)
+            t.sprite->setPosition(t.desdePos + (t.hastaPos - t.desdePos) * e);
+        if (t.animaEscala)
+            t.sprite->setScale(t.desdeEsc + (t.hastaEsc - t.desdeEsc) * e);
+        if (t.animaAlfa){
+            sf::Color c = t.sprite->getColor();
+            c.a = (sf::Uint8)(t.desdeAlfa + (t.hastaAlfa - t.desdeAlfa) * e);
+            t.sprite->setColor(c);
+        }
+    }
+
+    static void terminar(Tween &t){
+        if (t.ocultarAlTerminar) t.sprite->setPosition(-2000.f, -2000.f);
+        if (t.enCurso) *t.enCurso = false;
+    }
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+
+// ---------------------- Contador de asignaciones ----------------------
+// Para comprobar que el bucle del juego no pide memoria en el montón. Compilado con
+// -DALMATE_CONTAR_ASIGNACIONES (make asignaciones) se sustituyen los operator new/delete
+// globales y cada hilo cuenta las suyas; el perfilador (Perfil.hpp) las reparte por secciones
+// del frame y se para con un informe si un frame pasa del presupuesto. Lo que SFML y el driver
+// piden por dentro (cola de eventos, display, título de la ventana) se aparta con
+// FueraDePresupuesto. Sin la macro los contadores se quedan a 0 y no cambia nada.
+// Define los operadores globales: solo se incluye desde un .cpp (Juego.cpp).
+
+#ifdef ALMATE_CONTAR_ASIGNACIONES
+const bool CONTANDO_ASIGNACIONES = true;
+#else
+const bool CONTANDO_ASIGNACIONES = false;
+#endif
+
+inline thread_local unsigned long asignacionesHilo = 0;     // operator new en este hilo
+inline thread_local unsigned long asignacionesAjenas = 0;   // de ellas, dentro de FueraDePresupuesto
+
+// Las que cuentan para el presupuesto
+inline unsigned long asignacionesPropias(){ return asignacionesHilo - asignacionesAjenas; }
+
+// Mientras vive, lo que se pida es ajeno (se puede anidar)
+struct FueraDePresupuesto {
+    unsigned long hilo = asignacionesHilo, ajenas = asignacionesAjenas;
+    ~FueraDePresupuesto(){ asignacionesAjenas = ajenas + (asignacionesHilo - hilo); }
+};
+
+#ifdef ALMATE_CONTAR_ASIGNACIONES
+void* operator new(std::size_t n){
+    asignacionesHilo++;
+    if (void *p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n){ return operator new(n); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept { asignacionesHilo++; return std::malloc(n ? n : 1); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { asignacionesHilo++; return std::malloc(n ? n : 1); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+#endif
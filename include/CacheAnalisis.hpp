@@ -0,0 +1,352 @@
+#pragma once
+#include "Protocolo.hpp"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+// ---------------------- Caché de análisis ----------------------
+// Resultados de Analisis.exe guardados en disco por posición, compartidos entre ejecuciones y
+// entre procesos a la vez (POSIX: mmap y flock). El archivo es un registro que solo crece:
+// cabecera de 16 bytes ("ALMATE CACHE v1\n") y registros fijos de 48 bytes
+//   [0..31]  clave: ocupación, piezas, derechos de Almate, turno, regla 50 y profundidad
+//   [32..43] valor: movimientos, estado, mejor jugada y su valor
+//   [44..47] suma de comprobación (FNV-1a de los bytes 0..43)
+// Cada proceso mapea el archivo y tiene su propio índice en memoria (direccionamiento abierto:
+// número de registro por hash de la clave); una consulta es un hash, una o dos comparaciones
+// de 32 bytes en el mapa y ninguna llamada al sistema. Los registros que añaden otros procesos
+// se indexan al llamar a ponerAlDia(). Escribir toma el cerrojo <ruta>.cerrojo, recorta un
+// registro a medias que haya dejado otro proceso al morir y añade todo el lote con un write.
+// Compactar reescribe solo el último registro de cada clave en un archivo nuevo y lo renombra
+// encima: quien tenga el viejo mapeado sigue leyéndolo y se pasa al nuevo en su ponerAlDia().
+// No se hace fsync: todo se puede recalcular, y lo que quede a medias no cuadra con su suma.
+
+const char CABECERA_CACHE[] = "ALMATE CACHE v1\n";
+const size_t TAM_CABECERA_CACHE = 16;
+const size_t TAM_REGISTRO_CACHE = 48;
+const size_t TAM_CLAVE_CACHE = 32;
+const size_t MAPA_CACHE_INICIAL = 1ULL << 30;   // espacio de direcciones; se dobla si el archivo lo pasa
+
+// Posición exacta, no un hash: 64 bits de ocupación, un nibble por pieza en orden de casilla
+// (color*6 + tipo + 1) y los derechos de SeguimientoTablas (enroques, al paso, guardia y enroque
+// extendido gastados, pieza protegida) con el turno, la regla de 50 cumplida y la profundidad.
+struct ClaveAnalisis {
+    uint8_t b[TAM_CLAVE_CACHE] = {};
+    bool operator==(const ClaveAnalisis &o) const { return std::memcmp(b, o.b, TAM_CLAVE_CACHE) == 0; }
+};
+
+struct HashClaveAnalisis {
+    size_t operator()(const ClaveAnalisis &k) const {
+        uint64_t h = 0;
+        for (int i=0; i<4; ++i){
+            uint64_t w;
+            std::memcpy(&w, k.b + 8 * i, 8);
+            h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+            h ^= h >> 29;
+        }
+        return (size_t)h;
+    }
+};
+
+// false si la posición no cabe en la clave (más de 32 piezas)
+inline bool claveAnalisis(const EstadoPartida &e, int profundidad, ClaveAnalisis &k){
+    k = ClaveAnalisis();
+    int n = 0;
+    for (int s=0; s<FILAS*COLS; ++s){
+        int i = e.tablero[s / COLS][s % COLS];
+        if (i == -1) continue;
+        if (n == 32) return false;
+        const Pieza &p = e.piezas[i];
+        k.b[s >> 3] |= (uint8_t)(1 << (s & 7));
+        k.b[8 + (n >> 1)] |= (uint8_t)(((int)p.color * 6 + (int)p.tipo + 1) << ((n & 1) * 4));
+        n++;
+    }
+    uint64_t extra = e.tablas.derechosPosicion()
+                   | (uint64_t)(e.turno == ColorPieza::Black) << 32
+                   | (uint64_t)(e.tablas.relojCincuenta() >= 100) << 33
+                   | (uint64_t)(profundidad & 0xFF) << 40;
+    for (int i=0; i<8; ++i) k.b[24 + i] = (uint8_t)(extra >> (8 * i));
+    return true;
+}
+
+enum class EstadoAnalisis : uint8_t { Juego, Jaque, Mate, Ahogado, Tablas50, TablasMaterial, TablasRepeticion };
+
+struct ValorAnalisis {
+    uint16_t movimientos = 0;
+    EstadoAnalisis estado = EstadoAnalisis::Juego;
+    bool conMejor = false;        // hay mejor jugada (profundidad > 0 y algún movimiento)
+    Jugada mejor;
+    int32_t valor = 0;
+};
+
+inline uint32_t sumaCache(const uint8_t *b, size_t n){
+    uint32_t h = 2166136261u;
+    for (size_t i=0; i<n; ++i){ h ^= b[i]; h *= 16777619u; }
+    return h;
+}
+
+inline void codificarRegistroCache(const ClaveAnalisis &k, const ValorAnalisis &v, uint8_t *b){
+    std::memcpy(b, k.b, TAM_CLAVE_CACHE);
+    uint8_t *q = b + TAM_CLAVE_CACHE;
+    q[0] = (uint8_t)v.movimientos; q[1] = (uint8_t)(v.movimientos >> 8);
+    q[2] = (uint8_t)v.estado;
+    q[3] = v.conMejor ? 1 : 0;
+    q[4] = v.mejor.origen; q[5] = v.mejor.destino; q[6] = v.mejor.promocion; q[7] = v.mejor.guardia;
+    uint32_t x = (uint32_t)v.valor;
+    q[8] = (uint8_t)x; q[9] = (uint8_t)(x >> 8); q[10] = (uint8_t)(x >> 16); q[11] = (uint8_t)(x >> 24);
+    uint32_t s = sumaCache(b, 44);
+    b[44] = (uint8_t)s; b[45] = (uint8_t)(s >> 8); b[46] = (uint8_t)(s >> 16); b[47] = (uint8_t)(s >> 24);
+}
+
+inline bool registroCacheValido(const uint8_t *b){
+    uint32_t s = sumaCache(b, 44);
+    return b[44] == (uint8_t)s && b[45] == (uint8_t)(s >> 8) && b[46] == (uint8_t)(s >> 16) && b[47] == (uint8_t)(s >> 24);
+}
+
+inline void decodificarValorCache(const uint8_t *b, ValorAnalisis &v){
+    const uint8_t *q = b + TAM_CLAVE_CACHE;
+    v.movimientos = (uint16_t)(q[0] | (q[1] << 8));
+    v.estado = (EstadoAnalisis)q[2];
+    v.conMejor = q[3] != 0;
+    v.mejor.origen = q[4]; v.mejor.destino = q[5]; v.mejor.promocion = q[6]; v.mejor.guardia = q[7];
+    v.valor = (int32_t)((uint32_t)q[8] | ((uint32_t)q[9] << 8) | ((uint32_t)q[10] << 16) | ((uint32_t)q[11] << 24));
+}
+
+struct NuevoAnalisis {
+    ClaveAnalisis clave;
+    ValorAnalisis valor;
+};
+
+class CacheAnalisis {
+public:
+    ~CacheAnalisis(){ cerrar(); }
+
+    // Abre o crea la caché; con ella, el índice de todo lo que ya tiene
+    bool abrir(const std::string &ruta){
+        cerrar();
+        this->ruta = ruta;
+        fdCerrojo = ::open((ruta + ".cerrojo").c_str(), O_RDWR | O_CREAT, 0644);
+        if (fdCerrojo < 0) return false;
+        flock(fdCerrojo, LOCK_EX);
+        bool ok = abrirArchivo(true);
+        flock(fdCerrojo, LOCK_UN);
+        if (!ok) cerrar();
+        return ok;
+    }
+
+    void cerrar(){
+        std::unique_lock<std::shared_mutex> lk(mtx);
+        soltarArchivo();
+        if (fdCerrojo >= 0) ::close(fdCerrojo);
+        fdCerrojo = -1;
+    }
+
+    bool abierta() const { return fd >= 0; }
+
+    // Desde cualquier hilo
+    bool buscar(const ClaveAnalisis &k, ValorAnalisis &v) const {
+        std::shared_lock<std::shared_mutex> lk(mtx);
+        const uint8_t *r = encontrar(k);
+        if (r) decodificarValorCache(r, v);
+        return r != nullptr;
+    }
+
+    // Indexa lo que otros procesos hayan añadido (o compactado) desde la última vez
+    void ponerAlDia(){
+        struct stat st, actual;
+        {
+            std::shared_lock<std::shared_mutex> lk(mtx);
+            if (fd < 0) return;
+            bool reemplazado = ::stat(ruta.c_str(), &actual) == 0 && actual.st_ino != inodo;
+            if (!reemplazado && (::fstat(fd, &st) != 0 || (size_t)st.st_size <= indexado)) return;
+        }
+        std::unique_lock<std::shared_mutex> lk(mtx);
+        if (fd < 0) return;
+        if (::stat(ruta.c_str(), &actual) == 0 && actual.st_ino != inodo) reabrir();
+        else if (::fstat(fd, &st) == 0) indexarHasta((size_t)st.st_size);
+    }
+
+    // Añade un lote (claves distintas) con una sola escritura y lo indexa. Lo que ya esté, porque
+    // otro hilo o proceso lo guardó después de buscarlo, no se repite. Devuelve cuántos escribió.
+    size_t guardar(const std::vector<NuevoAnalisis> &nuevos){
+        if (nuevos.empty() || fdCerrojo < 0) return 0;
+        std::vector<uint8_t> buf;
+        size_t escritos = 0;
+
+        flock(fdCerrojo, LOCK_EX);
+        {
+            std::unique_lock<std::shared_mutex> lk(mtx);
+            struct stat actual, st;
+            if (::stat(ruta.c_str(), &actual) == 0 && actual.st_ino != inodo) reabrir();
+            if (fd >= 0 && ::fstat(fd, &st) == 0){
+                // con el cerrojo nadie más escribe: lo que no se pueda indexar está roto
+                indexarHasta((size_t)st.st_size);
+                buf.reserve(nuevos.size() * TAM_REGISTRO_CACHE);
+                for (const NuevoAnalisis &n : nuevos){
+                    if (encontrar(n.clave)) continue;
+                    buf.resize(buf.size() + TAM_REGISTRO_CACHE);
+                    codificarRegistroCache(n.clave, n.valor, &buf[buf.size() - TAM_REGISTRO_CACHE]);
+                }
+                bool alineado = (size_t)st.st_size == indexado || ::ftruncate(fd, (off_t)indexado) == 0;
+                if (fd >= 0 && alineado && !buf.empty() && ::pwrite(fd, buf.data(), buf.size(), (off_t)indexado) == (ssize_t)buf.size()){
+                    indexarHasta(indexado + buf.size());
+                    escritos = buf.size() / TAM_REGISTRO_CACHE;
+                }
+            }
+        }
+        flock(fdCerrojo, LOCK_UN);
+        return escritos;
+    }
+
+    // Reescribe la caché con un registro por clave
+    bool compactar(){
+        if (fdCerrojo < 0) return false;
+        flock(fdCerrojo, LOCK_EX);
+        bool ok = false;
+        {
+            std::unique_lock<std::shared_mutex> lk(mtx);
+            struct stat actual, st;
+            if (::stat(ruta.c_str(), &actual) == 0 && actual.st_ino != inodo) reabrir();
+            if (fd >= 0 && ::fstat(fd, &st) == 0) indexarHasta((size_t)st.st_size);
+            std::string temporal = ruta + ".compactando";
+            int nuevo = ::open(temporal.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd >= 0 && nuevo >= 0){
+                std::vector<uint8_t> buf;
+                buf.reserve(TAM_CABECERA_CACHE + entradas * TAM_REGISTRO_CACHE);
+                buf.insert(buf.end(), CABECERA_CACHE, CABECERA_CACHE + TAM_CABECERA_CACHE);
+                for (uint32_t n : indice){
+                    if (!n) continue;
+                    const uint8_t *r = registro(n - 1);
+                    buf.insert(buf.end(), r, r + TAM_REGISTRO_CACHE);
+                }
+                ok = ::write(nuevo, buf.data(), buf.size()) == (ssize_t)buf.size() && ::fsync(nuevo) == 0;
+                ::close(nuevo);
+                ok = ok && ::rename(temporal.c_str(), ruta.c_str()) == 0;
+                if (ok) reabrir();
+            } else if (nuevo >= 0){
+                ::close(nuevo);
+            }
+            if (!ok) ::unlink(temporal.c_str());
+        }
+        flock(fdCerrojo, LOCK_UN);
+        return ok;
+    }
+
+    size_t numEntradas() const { std::shared_lock<std::shared_mutex> lk(mtx); return entradas; }
+    size_t numRegistros() const { std::shared_lock<std::shared_mutex> lk(mtx); return (indexado - TAM_CABECERA_CACHE) / TAM_REGISTRO_CACHE; }
+
+private:
+    std::string ruta;
+    int fd = -1, fdCerrojo = -1;
+    ino_t inodo = 0;
+    const uint8_t *mapa = nullptr;
+    size_t tamMapa = 0;
+    size_t indexado = 0;                  // bytes del archivo ya indexados (cabecera incluida)
+    std::vector<uint32_t> indice;         // número de registro + 1; 0 = libre
+    size_t entradas = 0;
+    mutable std::shared_mutex mtx;
+
+    const uint8_t* registro(uint32_t n) const { return mapa + TAM_CABECERA_CACHE + (size_t)n * TAM_REGISTRO_CACHE; }
+
+    static size_t hashClave(const ClaveAnalisis &k){ return HashClaveAnalisis()(k); }
+
+    // el registro de la clave, o nullptr (con mtx tomado)
+    const uint8_t* encontrar(const ClaveAnalisis &k) const {
+        if (indice.empty()) return nullptr;
+        size_t mascara = indice.size() - 1;
+        for (size_t h = hashClave(k) & mascara; indice[h]; h = (h + 1) & mascara){
+            const uint8_t *r = registro(indice[h] - 1);
+            if (std::memcmp(r, k.b, TAM_CLAVE_CACHE) == 0) return r;
+        }
+        return nullptr;
+    }
+
+    // con el cerrojo del archivo: si está vacío (recién creado) se le pone la cabecera
+    bool abrirArchivo(bool crear){
+        fd = ::open(ruta.c_str(), crear ? (O_RDWR | O_CREAT) : O_RDWR, 0644);
+        if (fd < 0) return false;
+        struct stat st;
+        if (::fstat(fd, &st) != 0) return false;
+        if (st.st_size == 0){
+            if (::pwrite(fd, CABECERA_CACHE, TAM_CABECERA_CACHE, 0) != (ssize_t)TAM_CABECERA_CACHE) return false;
+            st.st_size = TAM_CABECERA_CACHE;
+        }
+        char cabecera[TAM_CABECERA_CACHE];
+        if (::pread(fd, cabecera, TAM_CABECERA_CACHE, 0) != (ssize_t)TAM_CABECERA_CACHE
+            || std::memcmp(cabecera, CABECERA_CACHE, TAM_CABECERA_CACHE) != 0) return false;
+        inodo = st.st_ino;
+        indexado = TAM_CABECERA_CACHE;
+        entradas = 0;
+        indice.assign(1024, 0);
+        indexarHasta((size_t)st.st_size);
+        return true;
+    }
+
+    void soltarArchivo(){
+        if (mapa) ::munmap((void*)mapa, tamMapa);
+        mapa = nullptr;
+        tamMapa = 0;
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        indice.clear();
+        entradas = 0;
+        indexado = 0;
+    }
+
+    // el archivo de la ruta ya es otro (compactado): mapear el nuevo
+    void reabrir(){
+        soltarArchivo();
+        if (!abrirArchivo(false)) soltarArchivo();
+    }
+
+    // registros completos y válidos hasta 'tam' (con mtx exclusivo); se para en el primero roto
+    void indexarHasta(size_t tam){
+        if (tam > tamMapa){
+            size_t nuevoTam = tamMapa ? tamMapa : MAPA_CACHE_INICIAL;
+            while (nuevoTam < tam) nuevoTam *= 2;
+            if (mapa) ::munmap((void*)mapa, tamMapa);
+            void *p = ::mmap(nullptr, nuevoTam, PROT_READ, MAP_SHARED, fd, 0);
+            mapa = nullptr;
+            if (p == MAP_FAILED){ soltarArchivo(); return; }    // sin mapa no hay caché
+            mapa = (const uint8_t*)p;
+            tamMapa = nuevoTam;
+        }
+        while (indexado + TAM_REGISTRO_CACHE <= tam){
+            uint32_t n = (uint32_t)((indexado - TAM_CABECERA_CACHE) / TAM_REGISTRO_CACHE);
+            const uint8_t *r = registro(n);
+            if (!registroCacheValido(r)) break;
+            if (2 * (entradas + 1) > indice.size()) crecerIndice();
+            size_t mascara = indice.size() - 1;
+            ClaveAnalisis k;
+            std::memcpy(k.b, r, TAM_CLAVE_CACHE);
+            size_t h = hashClave(k) & mascara;
+            while (indice[h] && std::memcmp(registro(indice[h] - 1), r, TAM_CLAVE_CACHE) != 0) h = (h + 1) & mascara;
+            if (!indice[h]) entradas++;
+            indice[h] = n + 1;                 // la última escritura de una clave manda
+            indexado += TAM_REGISTRO_CACHE;
+        }
+    }
+
+    void crecerIndice(){
+        std::vector<uint32_t> viejo;
+        viejo.swap(indice);
+        indice.assign(viejo.size() * 2, 0);
+        size_t mascara = indice.size() - 1;
+        for (uint32_t n : viejo){
+            if (!n) continue;
+            ClaveAnalisis k;
+            std::memcpy(k.b, registro(n - 1), TAM_CLAVE_CACHE);
+            size_t h = hashClave(k) & mascara;
+            while (indice[h]) h = (h + 1) & mascara;
+            indice[h] = n;
+        }
+    }
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "Control.hpp"
+#include "Graficos.hpp"
+
+// ---------------------- Capa de control ----------------------
+// Sombrea cada casilla según cuántas piezas de cada bando la atacan (MapaControl, con la guardia):
+// azul si dominan las blancas, rojo si las negras, violeta si están igualadas, y más opaca cuantos
+// más atacantes. Es un solo VertexArray de 64 quads; los colores se rehacen cuando cambia el mapa
+// (una vez por jugada), no en cada frame.
+
+const sf::Color COLOR_CONTROL_BLANCAS(60, 130, 255);
+const sf::Color COLOR_CONTROL_NEGRAS(235, 60, 50);
+const int ALFA_CONTROL_MIN = 45;     // un solo atacante
+const int ALFA_CONTROL_PASO = 25;    // por cada atacante más
+const int ALFA_CONTROL_MAX = 170;
+
+struct CapaControl {
+    sf::VertexArray quads;
+
+    CapaControl() : quads(sf::Quads, 4 * FILAS * COLS) {
+        for (int s=0; s<FILAS*COLS; ++s){
+            float x = (float)(TABLERO_X + (s % COLS) * TAM_CASILLA), y = (float)(TABLERO_Y + (s / COLS) * TAM_CASILLA);
+            float t = (float)TAM_CASILLA;
+            quads[4*s + 0].position = sf::Vector2f(x, y);
+            quads[4*s + 1].position = sf::Vector2f(x + t, y);
+            quads[4*s + 2].position = sf::Vector2f(x + t, y + t);
+            quads[4*s + 3].position = sf::Vector2f(x, y + t);
+        }
+    }
+
+    void construir(const MapaControl &mapa, const std::vector<Pieza> &piezas){
+        for (int s=0; s<FILAS*COLS; ++s){
+            int b = mapa.atacantes(piezas, ColorPieza::White, s);
+            int n = mapa.atacantes(piezas, ColorPieza::Black, s);
+            sf::Color c = sf::Color::Transparent;
+            if (b + n > 0){
+                // mezcla por la proporción de atacantes blancos
+                float f = (float)b / (float)(b + n);
+                c.r = (sf::Uint8)(COLOR_CONTROL_NEGRAS.r + f * (COLOR_CONTROL_BLANCAS.r - COLOR_CONTROL_NEGRAS.r));
+                c.g = (sf::Uint8)(COLOR_CONTROL_NEGRAS.g + f * (COLOR_CONTROL_BLANCAS.g - COLOR_CONTROL_NEGRAS.g));
+                c.b = (sf::Uint8)(COLOR_CONTROL_NEGRAS.b + f * (COLOR_CONTROL_BLANCAS.b - COLOR_CONTROL_NEGRAS.b));
+                int alfa = ALFA_CONTROL_MIN + ALFA_CONTROL_PASO * (b + n - 1);
+                c.a = (sf::Uint8)(alfa > ALFA_CONTROL_MAX ? ALFA_CONTROL_MAX : alfa);
+            }
+            for (int k=0; k<4; ++k) quads[4*s + k].color = c;
+        }
+    }
+
+    void dibujar(sf::RenderTarget &destino) const { destino.draw(quads); }
+};
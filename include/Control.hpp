@@ -0,0 +1,54 @@
+#pragma once
+#include "Reglas.hpp"
+#include <vector>
+#include <cstdint>
+
+// ---------------------- Mapa de control ----------------------
+// Cuántas piezas de cada bando atacan cada casilla, con la semántica de puedeAtacar (los peones
+// en diagonal hacia delante, las deslizantes hasta la primera pieza, propia o no, el rey a su
+// alrededor), para la capa de control del juego. Se guarda lo que ataca cada pieza; al
+// actualizar solo se recalculan las piezas que se movieron, salieron, volvieron o cambiaron de
+// tipo, y de las deslizantes solo los rayos que atacaban alguna casilla que cambió (los únicos
+// que pueden abrirse o cerrarse). En las cuentas se restan y se suman solo las casillas que una
+// pieza dejó de atacar o empezó a atacar. Una jugada normal cambia 2 a 4 casillas y toca unas
+// pocas piezas, no las 32.
+
+class MapaControl {
+public:
+    // Todo desde cero
+    void iniciar(const vector<Pieza>& piezas, const Tablero& tablero);
+
+    // Lo que cambió desde la última llamada, sea una jugada, deshacer, una promoción o un salto
+    // en la repetición (se compara el tablero con el de entonces). Las piezas tienen que ser las
+    // mismas (índice y color); con otra posición cargada, iniciar. Con más de 64 piezas siempre se
+    // empieza de cero. Devuelve las piezas recalculadas.
+    int actualizar(const vector<Pieza>& piezas, const Tablero& tablero);
+
+    // Atacantes de 'lado' sobre 'casilla'. Regla 1: la pieza protegida con la guardia no se puede
+    // capturar, así que mientras dura la protección su casilla no cuenta como atacada por el rival.
+    int atacantes(const vector<Pieza>& piezas, ColorPieza lado, int casilla) const;
+
+    // Sin mirar la guardia
+    int cuentaBruta(ColorPieza lado, int casilla) const {
+        int n = 0;
+        for (int b=0; b<BITS_CUENTA; ++b) n |= (int)((planos[(int)lado][b] >> casilla) & 1) << b;
+        return n;
+    }
+
+private:
+    // Las cuentas de cada bando van en planos de bits: el bit b de la cuenta de la casilla s es el
+    // bit s de planos[lado][b]. Sumar o restar las casillas que ataca una pieza es una suma con
+    // acarreo sobre 5 palabras, no un incremento por casilla.
+    static const int BITS_CUENTA = 5;        // hasta 31 atacantes por bando
+    uint64_t planos[2][BITS_CUENTA] = {};
+    std::vector<uint64_t> ataques;           // por pieza
+    std::vector<uint8_t> tipoPieza;          // por pieza (una promoción cambia lo que ataca)
+    uint64_t deslizantes = 0;                // bit i: la pieza i es torre, alfil o dama y está viva
+    uint64_t coronables = 0;                 // bit i: la pieza i puede haber sido peón (y cambiar de tipo)
+    Tablero anterior;                        // el tablero la última vez
+
+    void sumar(ColorPieza lado, uint64_t casillas);
+    void restar(ColorPieza lado, uint64_t casillas);
+    void cambiar(ColorPieza lado, int i, uint64_t nuevos);
+    void recalcular(const vector<Pieza>& piezas, const Tablero& tablero, int i);
+};
@@ -0,0 +1,211 @@
+#pragma once
+#include "Reglas.hpp"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// ---------------------- Diario de la partida ----------------------
+// Autoguardado a prueba de cortes: cada jugada, deshacer, rehacer y elección de promoción se
+// añade al final de un archivo como un registro fijo de 16 bytes, con una sola escritura (el
+// registro entero en un write). Un hilo aparte hace fsync poco después de cada escritura, así
+// que el bucle del juego nunca espera al disco; como mucho se pierde lo escrito en los últimos
+// SINCRONIZAR_MS. Al arrancar, el juego lee el diario y lo repite para volver a la misma
+// posición, con el historial de deshacer y los relojes.
+//
+// Formato: cabecera de 16 bytes ("ALMATE DIARIO 1\n") y registros de 16 bytes:
+//   [0]     tipo: 'J' jugada, 'D' deshacer, 'R' rehacer, 'P' promoción elegida
+//   [1..4]  origen, destino, promoción y guardia de la jugada (Jugada; en 'P' solo la promoción)
+//   [5..8]  tiempo que les queda a las blancas, ms (little endian)
+//   [9..12] tiempo que les queda a las negras, ms
+//   [13..15] suma de comprobación (FNV-1a de los bytes 0..12, 24 bits)
+// Un registro a medio escribir (corte de luz) no cuadra con su suma: se descarta él y todo lo
+// que venga detrás, y el archivo se recorta antes de seguir escribiendo.
+
+const char CABECERA_DIARIO[] = "ALMATE DIARIO 1\n";
+const int TAM_CABECERA_DIARIO = 16;
+const int TAM_REGISTRO_DIARIO = 16;
+const int SINCRONIZAR_MS = 250;      // espera antes de cada fsync (junta las escrituras seguidas)
+
+struct RegistroDiario {
+    char tipo = 'J';
+    Jugada jugada;
+    int64_t msBlancas = 0, msNegras = 0;
+};
+
+inline uint32_t sumaDiario(const uint8_t *b, int n){
+    uint32_t h = 2166136261u;
+    for (int i=0; i<n; ++i){ h ^= b[i]; h *= 16777619u; }
+    return h & 0xFFFFFF;
+}
+
+inline void codificarRegistroDiario(const RegistroDiario &r, uint8_t *b){
+    auto u32 = [](uint8_t *q, int64_t v){
+        uint32_t x = (uint32_t)(v < 0 ? 0 : v > 0xFFFFFFFFLL ? 0xFFFFFFFFLL : v);
+        q[0] = (uint8_t)x; q[1] = (uint8_t)(x >> 8); q[2] = (uint8_t)(x >> 16); q[3] = (uint8_t)(x >> 24);
+    };
+    b[0] = (uint8_t)r.tipo;
+    b[1] = r.jugada.origen;
+    b[2] = r.jugada.destino;
+    b[3] = r.jugada.promocion;
+    b[4] = r.jugada.guardia;
+    u32(b + 5, r.msBlancas);
+    u32(b + 9, r.msNegras);
+    uint32_t s = sumaDiario(b, 13);
+    b[13] = (uint8_t)s; b[14] = (uint8_t)(s >> 8); b[15] = (uint8_t)(s >> 16);
+}
+
+inline bool decodificarRegistroDiario(const uint8_t *b, RegistroDiario &r){
+    uint32_t s = sumaDiario(b, 13);
+    if (b[13] != (uint8_t)s || b[14] != (uint8_t)(s >> 8) || b[15] != (uint8_t)(s >> 16)) return false;
+    if (b[0] != 'J' && b[0] != 'D' && b[0] != 'R' && b[0] != 'P') return false;
+    auto u32 = [](const uint8_t *q){ return (int64_t)((uint32_t)q[0] | ((uint32_t)q[1] << 8) | ((uint32_t)q[2] << 16) | ((uint32_t)q[3] << 24)); };
+    r.tipo = (char)b[0];
+    r.jugada.origen = b[1];
+    r.jugada.destino = b[2];
+    r.jugada.promocion = b[3];
+    r.jugada.guardia = b[4];
+    r.msBlancas = u32(b + 5);
+    r.msNegras = u32(b + 9);
+    return true;
+}
+
+// Registros válidos del diario, hasta el primero roto; false si no existe o no es un diario
+inline bool leerDiario(const std::string &ruta, std::vector<RegistroDiario> &registros){
+    registros.clear();
+    std::ifstream in(ruta, std::ios::binary);
+    if (!in) return false;
+    char cabecera[TAM_CABECERA_DIARIO];
+    if (!in.read(cabecera, TAM_CABECERA_DIARIO) || std::memcmp(cabecera, CABECERA_DIARIO, TAM_CABECERA_DIARIO) != 0) return false;
+    uint8_t b[TAM_REGISTRO_DIARIO];
+    RegistroDiario r;
+    while (in.read((char*)b, TAM_REGISTRO_DIARIO) && decodificarRegistroDiario(b, r)) registros.push_back(r);
+    return true;
+}
+
+class DiarioPartida {
+public:
+    ~DiarioPartida(){ cerrar(); }
+
+    // Empieza a escribir en 'ruta' conservando sus 'conservar' primeros registros (los que se
+    // repitieron al arrancar); lo que hubiera detrás se recorta. Con 0 empieza un diario nuevo.
+    bool abrir(const std::string &ruta, size_t conservar){
+        cerrar();
+        std::error_code ec;
+        if (conservar == 0 || !std::filesystem::exists(ruta, ec)){
+            std::FILE *f = std::fopen(ruta.c_str(), "wb");
+            if (!f) return false;
+            std::fwrite(CABECERA_DIARIO, 1, TAM_CABECERA_DIARIO, f);
+            std::fclose(f);
+        } else {
+            std::filesystem::resize_file(ruta, TAM_CABECERA_DIARIO + conservar * TAM_REGISTRO_DIARIO, ec);
+            if (ec) return false;
+        }
+        archivo = std::fopen(ruta.c_str(), "ab");
+        if (!archivo) return false;
+        this->ruta = ruta;
+        terminar = false;
+        sucio = true;                 // la cabecera o el recorte también van al disco
+        sincronizador = std::thread([this]{ sincronizar(); });
+        return true;
+    }
+
+    bool activo() const { return archivo != nullptr; }
+
+    void jugada(const Jugada &j, int64_t msBlancas, int64_t msNegras){ anadir('J', j, msBlancas, msNegras); }
+    void deshacer(int64_t msBlancas, int64_t msNegras){ anadir('D', Jugada(), msBlancas, msNegras); }
+    void rehacer(int64_t msBlancas, int64_t msNegras){ anadir('R', Jugada(), msBlancas, msNegras); }
+    void promocion(TipoPieza tipo, int64_t msBlancas, int64_t msNegras){
+        Jugada j;
+        j.promocion = (uint8_t)(1 + (int)tipo);
+        anadir('P', j, msBlancas, msNegras);
+    }
+
+    // Último fsync y cerrar (también al destruirlo)
+    void cerrar(){
+        if (!archivo) return;
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            terminar = true;
+        }
+        cv.notify_all();
+        sincronizador.join();
+        std::fclose(archivo);
+        archivo = nullptr;
+    }
+
+    // La partida terminó: no hay nada que reanudar
+    void borrar(){
+        if (!archivo) return;
+        cerrar();
+        std::error_code ec;
+        std::filesystem::remove(ruta, ec);
+    }
+
+    long escritos = 0;
+    long sincronizaciones = 0;
+
+private:
+    std::FILE *archivo = nullptr;
+    std::string ruta;
+    std::thread sincronizador;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool sucio = false;
+    bool terminar = false;
+
+    void anadir(char tipo, const Jugada &j, int64_t msBlancas, int64_t msNegras){
+        if (!archivo) return;
+        RegistroDiario r;
+        r.tipo = tipo;
+        r.jugada = j;
+        r.msBlancas = msBlancas;
+        r.msNegras = msNegras;
+        uint8_t b[TAM_REGISTRO_DIARIO];
+        codificarRegistroDiario(r, b);
+        std::fwrite(b, 1, TAM_REGISTRO_DIARIO, archivo);
+        std::fflush(archivo);         // al sistema ya: sobrevive a que se cierre el juego
+        escritos++;
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            sucio = true;
+        }
+        cv.notify_one();
+    }
+
+    // Hilo: fsync (que puede tardar decenas de ms) fuera del bucle del juego
+    void sincronizar(){
+        int fd = fileno(archivo);
+        std::unique_lock<std::mutex> lk(mtx);
+        for (;;){
+            cv.wait(lk, [&]{ return sucio || terminar; });
+            if (!terminar) cv.wait_for(lk, std::chrono::milliseconds(SINCRONIZAR_MS), [&]{ return terminar; });
+            bool hacer = sucio;
+            sucio = false;
+            bool salir = terminar;
+            lk.unlock();
+            if (hacer){
+#ifdef _WIN32
+                _commit(fd);
+#else
+                fsync(fd);
+#endif
+                sincronizaciones++;
+            }
+            lk.lock();
+            if (salir && !sucio) return;
+        }
+    }
+};
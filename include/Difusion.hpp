@@ -0,0 +1,317 @@
+#pragma once
+#include "Protocolo.hpp"
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+
+// ---------------------- Difusión a espectadores ----------------------
+// Una partida se retransmite a muchos espectadores con mensajes binarios pequeños:
+//   'D' delta de una jugada (8 bytes): ply, pieza, origen, destino, marcas y casilla de guardia
+//   'F' foto de la posición (74 bytes): turno, flags de los dos bandos y las 32 piezas
+// Cada delta se codifica una sola vez en un registro común y cada espectador solo guarda hasta
+// dónde lo ha recibido. Quien entra tarde recibe la última foto (se hace cada FOTO_CADA jugadas)
+// y las deltas desde ella; a quien se queda atrás más de MAX_RETRASO_DELTAS no se le manda
+// todo lo atrasado: se le salta a la última foto y su cola.
+// Solo Linux/POSIX. Los sockets de los espectadores son no bloqueantes; el dueño los vigila con
+// EPOLLOUT | EPOLLET y llama a sePuedeEscribir cuando vuelven a admitir datos.
+
+const int TAM_DELTA = 8;
+const int TAM_FOTO = 74;
+const int FOTO_CADA = 32;
+const size_t MAX_RETRASO_DELTAS = 64;
+
+// marcas de una delta
+const uint8_t DELTA_CAPTURA   = 1 << 0;
+const uint8_t DELTA_ENROQUE   = 1 << 1;
+const uint8_t DELTA_ENROQUE3  = 1 << 2;   // enroque extendido (Regla 2)
+const uint8_t DELTA_GUARDIA   = 1 << 3;   // Regla 1
+// bits 4-6: promoción (0 = ninguna; si no, 1 + TipoPieza)
+const uint8_t DELTA_ALPASO    = 1 << 7;   // captura al paso (la víctima no está en el destino)
+
+struct DeltaJugada {
+    uint16_t ply = 0;         // jugadas hechas antes de esta
+    uint8_t pieza = 0;        // índice en piezas (para mover su sprite sin buscar)
+    uint8_t origen = SIN_CASILLA;
+    uint8_t destino = SIN_CASILLA;
+    uint8_t marcas = 0;
+    uint8_t guardia = SIN_CASILLA;
+
+    uint8_t promocion() const { return (marcas >> 4) & 7; }
+
+    Jugada jugada() const {
+        Jugada j;
+        j.origen = origen;
+        j.destino = destino;
+        j.promocion = promocion();
+        j.guardia = (marcas & DELTA_GUARDIA) ? guardia : SIN_CASILLA;
+        return j;
+    }
+};
+
+// Delta de la jugada 'j' sobre la posición 'antes' (se llama ANTES de aplicarla)
+inline DeltaJugada crearDelta(const EstadoPartida &antes, const Jugada &j){
+    DeltaJugada d;
+    d.ply = (uint16_t)antes.jugadas;
+    int oF = j.origen / COLS, oC = j.origen % COLS;
+    int dF = j.destino / COLS, dC = j.destino % COLS;
+    int idx = antes.tablero[oF][oC];
+    d.pieza = (uint8_t)idx;
+    d.origen = j.origen;
+    d.destino = j.destino;
+    if (antes.tablero[dF][dC] != -1) d.marcas |= DELTA_CAPTURA;
+    else if (idx != -1 && antes.piezas[idx].tipo == TipoPieza::Pawn && dC != oC) d.marcas |= DELTA_CAPTURA | DELTA_ALPASO;
+    if (idx != -1 && antes.piezas[idx].tipo == TipoPieza::King){
+        if (abs(dC - oC) == 2) d.marcas |= DELTA_ENROQUE;
+        if (abs(dC - oC) == 3) d.marcas |= DELTA_ENROQUE3;
+    }
+    if (j.guardia != SIN_CASILLA){
+        d.marcas |= DELTA_GUARDIA;
+        d.guardia = j.guardia;
+    }
+    // sin pieza elegida se promociona a dama, igual que EstadoPartida::jugar
+    uint8_t promocion = j.promocion;
+    bool ultima = (antes.turno==ColorPieza::White)? (dF==0) : (dF==FILAS-1);
+    if (promocion == 0 && idx != -1 && antes.piezas[idx].tipo == TipoPieza::Pawn && ultima)
+        promocion = 1 + (int)TipoPieza::Queen;
+    d.marcas |= (uint8_t)((promocion & 7) << 4);
+    return d;
+}
+
+inline void codificarDelta(const DeltaJugada &d, uint8_t *b){
+    b[0] = 'D';
+    b[1] = (uint8_t)(d.ply & 0xFF);
+    b[2] = (uint8_t)(d.ply >> 8);
+    b[3] = d.pieza;
+    b[4] = d.origen;
+    b[5] = d.destino;
+    b[6] = d.marcas;
+    b[7] = d.guardia;
+}
+
+inline DeltaJugada decodificarDelta(const uint8_t *b){
+    DeltaJugada d;
+    d.ply = (uint16_t)(b[1] | (b[2] << 8));
+    d.pieza = b[3];
+    d.origen = b[4];
+    d.destino = b[5];
+    d.marcas = b[6];
+    d.guardia = b[7];
+    return d;
+}
+
+// ---------------------- Fotos ----------------------
+inline void codificarFlags(const ReglasFlags &f, uint8_t *b){
+    b[0] = (uint8_t)((f.guardiaUsado ? 1 : 0) | (f.proteccionActiva ? 2 : 0) | (f.enroque3Usado ? 4 : 0)
+                     | ((int)f.proteccionTurnoDe << 3));
+    b[1] = (uint8_t)(int8_t)f.guardiaIdx;
+    b[2] = (uint8_t)(int8_t)f.alPaso;
+}
+
+inline void decodificarFlags(const uint8_t *b, ReglasFlags &f){
+    f.guardiaUsado = (b[0] & 1) != 0;
+    f.proteccionActiva = (b[0] & 2) != 0;
+    f.enroque3Usado = (b[0] & 4) != 0;
+    f.proteccionTurnoDe = (ColorPieza)((b[0] >> 3) & 1);
+    f.guardiaIdx = (int8_t)b[1];
+    f.alPaso = (int8_t)b[2];
+}
+
+// Por pieza: casilla (0xFF fuera) y tipo | color<<3 | vivo<<4 | movida<<5 | protegida<<6
+inline void codificarFoto(const EstadoPartida &e, uint8_t *b){
+    b[0] = 'F';
+    b[1] = (uint8_t)(e.jugadas & 0xFF);
+    b[2] = (uint8_t)(e.jugadas >> 8);
+    b[3] = (uint8_t)e.turno;
+    codificarFlags(e.flagsBlanco, b + 4);
+    codificarFlags(e.flagsNegro, b + 7);
+    for (int i=0; i<32; ++i){
+        uint8_t *q = b + 10 + 2*i;
+        if (i >= (int)e.piezas.size()){ q[0] = SIN_CASILLA; q[1] = 0; continue; }
+        const Pieza &p = e.piezas[i];
+        q[0] = p.alive ? (uint8_t)indiceCasilla(p.fila, p.col) : SIN_CASILLA;
+        q[1] = (uint8_t)((int)p.tipo | ((int)p.color << 3) | (p.alive ? 16 : 0) | (p.hasMoved ? 32 : 0) | (p.protegido ? 64 : 0));
+    }
+}
+
+inline void decodificarFoto(const uint8_t *b, EstadoPartida &e){
+    e.jugadas = b[1] | (b[2] << 8);
+    e.turno = (ColorPieza)b[3];
+    decodificarFlags(b + 4, e.flagsBlanco);
+    decodificarFlags(b + 7, e.flagsNegro);
+    e.piezas.resize(32);
+    for (int r=0; r<FILAS; ++r) for (int c=0; c<COLS; ++c) e.tablero[r][c] = -1;
+    for (int i=0; i<32; ++i){
+        const uint8_t *q = b + 10 + 2*i;
+        Pieza &p = e.piezas[i];
+        p.tipo = (TipoPieza)(q[1] & 7);
+        p.color = (ColorPieza)((q[1] >> 3) & 1);
+        p.alive = (q[1] & 16) != 0;
+        p.hasMoved = (q[1] & 32) != 0;
+        p.protegido = (q[1] & 64) != 0;
+        if (p.alive && q[0] != SIN_CASILLA){
+            p.fila = q[0] / COLS; p.col = q[0] % COLS;
+            e.tablero[p.fila][p.col] = i;
+        } else {
+            p.fila = p.col = -1;
+        }
+    }
+    // la foto no lleva historia: repetición y regla de las 50 cuentan desde aquí
+    e.tablas.iniciar(e.piezas, e.tablero, e.flagsBlanco, e.flagsNegro, e.turno);
+}
+
+// ---------------------- Difusor ----------------------
+struct Suscriptor {
+    int fd = -1;
+    size_t cursor = 0;            // bytes del registro ya enviados
+    uint8_t foto[TAM_FOTO];
+    int fotoEnviada = TAM_FOTO;   // < TAM_FOTO: hay una foto a medio mandar
+    bool bloqueado = false;       // el socket no admitía más: esperar a que se pueda escribir
+};
+
+class Difusor {
+public:
+    explicit Difusor(const EstadoPartida &inicial){
+        registro.reserve(256 * TAM_DELTA);
+        guardarFoto(inicial);
+    }
+
+    // Nuevo espectador (socket no bloqueante): última foto y las deltas desde ella
+    void suscribir(int fd){
+        Suscriptor s;
+        s.fd = fd;
+        ponerEnFoto(s);
+        suscriptores.push_back(s);
+        escribir(suscriptores.back());
+    }
+
+    void desuscribir(int fd){
+        for (size_t i=0; i<suscriptores.size(); ++i){
+            if (suscriptores[i].fd == fd){
+                suscriptores[i] = suscriptores.back();
+                suscriptores.pop_back();
+                return;
+            }
+        }
+    }
+
+    // Jugada 'd' ya aplicada; 'despues' es la posición resultante
+    void publicar(const DeltaJugada &d, const EstadoPartida &despues){
+        size_t n = registro.size();
+        registro.resize(n + TAM_DELTA);
+        codificarDelta(d, registro.data() + n);
+        if (despues.jugadas % FOTO_CADA == 0) guardarFoto(despues);
+
+        for (Suscriptor &s : suscriptores){
+            if (s.bloqueado){
+                coalescer(s);
+                continue;     // se enviará al poder escribir
+            }
+            escribir(s);
+        }
+    }
+
+    // El socket de 'fd' vuelve a admitir datos
+    void sePuedeEscribir(int fd){
+        for (Suscriptor &s : suscriptores){
+            if (s.fd == fd){
+                s.bloqueado = false;
+                coalescer(s);
+                escribir(s);
+                return;
+            }
+        }
+    }
+
+    // Escribe lo pendiente; false si el socket está cerrado o con error
+    bool escribir(Suscriptor &s){
+        while (s.fotoEnviada < TAM_FOTO){
+            ssize_t n = send(s.fd, s.foto + s.fotoEnviada, TAM_FOTO - s.fotoEnviada, MSG_NOSIGNAL);
+            if (n <= 0) return atasco(s, n);
+            s.fotoEnviada += (int)n;
+        }
+        while (s.cursor < registro.size()){
+            ssize_t n = send(s.fd, registro.data() + s.cursor, registro.size() - s.cursor, MSG_NOSIGNAL);
+            if (n <= 0) return atasco(s, n);
+            s.cursor += (size_t)n;
+        }
+        return true;
+    }
+
+    size_t numSuscriptores() const { return suscriptores.size(); }
+    long saltosAFoto = 0;         // veces que un espectador lento se puso al día con una foto
+
+private:
+    std::vector<uint8_t> registro;    // todas las deltas de la partida, codificadas una vez
+    uint8_t ultimaFoto[TAM_FOTO];
+    size_t registroFoto = 0;          // posición del registro en la que se hizo la foto
+    std::vector<Suscriptor> suscriptores;
+
+    void guardarFoto(const EstadoPartida &e){
+        codificarFoto(e, ultimaFoto);
+        registroFoto = registro.size();
+    }
+
+    void ponerEnFoto(Suscriptor &s){
+        std::memcpy(s.foto, ultimaFoto, TAM_FOTO);
+        s.fotoEnviada = 0;
+        s.cursor = registroFoto;
+    }
+
+    // Muy atrasado y sin nada a medias: saltar a la última foto
+    void coalescer(Suscriptor &s){
+        bool aMedias = s.fotoEnviada < TAM_FOTO || (s.cursor % TAM_DELTA) != 0;
+        if (aMedias || s.cursor >= registroFoto) return;
+        if (registro.size() - s.cursor <= MAX_RETRASO_DELTAS * TAM_DELTA) return;
+        ponerEnFoto(s);
+        saltosAFoto++;
+    }
+
+    bool atasco(Suscriptor &s, ssize_t n){
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+            s.bloqueado = true;
+            return true;
+        }
+        return false;
+    }
+};
+
+// ---------------------- Espectador ----------------------
+// Reconstruye la partida a partir de los bytes recibidos (pueden llegar cortados por cualquier sitio)
+struct LectorDifusion {
+    EstadoPartida estado;
+    uint8_t pendiente[TAM_FOTO];
+    int enPendiente = 0;
+    bool conFoto = false;          // hasta la primera foto no hay posición
+    long deltas = 0, fotos = 0, desfases = 0;
+
+    // Aplica la delta si es la jugada que sigue a la posición actual
+    bool aplicarDelta(const DeltaJugada &d){
+        if (!conFoto || d.ply != estado.jugadas){ desfases++; return false; }
+        estado.aplicar(d.jugada());
+        deltas++;
+        return true;
+    }
+
+    // Llama a alDelta(d) tras aplicar cada delta y a alFoto() tras cada foto
+    template <typename FDelta, typename FFoto>
+    void consumir(const uint8_t *b, size_t n, FDelta alDelta, FFoto alFoto){
+        for (size_t k=0; k<n; ){
+            if (enPendiente == 0 && b[k] != 'D' && b[k] != 'F'){ desfases++; ++k; continue; }
+            pendiente[enPendiente++] = b[k++];
+            int tam = (pendiente[0] == 'D') ? TAM_DELTA : TAM_FOTO;
+            if (enPendiente < tam) continue;
+            enPendiente = 0;
+            if (pendiente[0] == 'F'){
+                decodificarFoto(pendiente, estado);
+                conFoto = true;
+                fotos++;
+                alFoto();
+            } else {
+                DeltaJugada d = decodificarDelta(pendiente);
+                if (aplicarDelta(d)) alDelta(d);
+            }
+        }
+    }
+};
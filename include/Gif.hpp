@@ -0,0 +1,211 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+
+// ---------------------- GIF animado ----------------------
+// Codificador GIF89a sin bibliotecas externas (lo usa Video.cpp). Una paleta global de hasta 256
+// colores sacada del primer frame (los colores más frecuentes; el tablero y todas las piezas
+// están ahí) y, en cada frame, solo el rectángulo que cambió respecto al anterior, comprimido
+// con LZW. Cada frame se codifica por separado, así que varios hilos pueden codificar frames
+// distintos a la vez y otro los escribe en orden.
+// Los píxeles son RGBA de 8 bits; 'filasInvertidas' = la primera fila en memoria es la de abajo
+// (lo que devuelve glReadPixels).
+
+struct PaletaGif {
+    uint8_t rgb[256][3] = {};
+    int numColores = 0;
+    uint8_t indice[1 << 15];          // color de 15 bits (5-5-5) -> entrada de la paleta más cercana
+
+    static int color15(const uint8_t *px){ return ((px[0] >> 3) << 10) | ((px[1] >> 3) << 5) | (px[2] >> 3); }
+    uint8_t cuantizar(const uint8_t *px) const { return indice[color15(px)]; }
+
+    void calcular(const uint8_t *rgba, size_t numPixeles){
+        std::vector<uint32_t> cuenta(1 << 15, 0);
+        for (size_t i=0; i<numPixeles; ++i) cuenta[color15(rgba + 4*i)]++;
+
+        // los 256 colores de 15 bits más frecuentes
+        std::vector<int> usados;
+        for (int c=0; c<(1 << 15); ++c) if (cuenta[c]) usados.push_back(c);
+        size_t n = usados.size() < 256 ? usados.size() : 256;
+        std::partial_sort(usados.begin(), usados.begin() + n, usados.end(), [&](int a, int b){ return cuenta[a] > cuenta[b]; });
+        numColores = n ? (int)n : 1;
+        for (size_t k=0; k<n; ++k){
+            int c = usados[k];
+            rgb[k][0] = (uint8_t)(((c >> 10) & 31) * 255 / 31);
+            rgb[k][1] = (uint8_t)(((c >> 5) & 31) * 255 / 31);
+            rgb[k][2] = (uint8_t)((c & 31) * 255 / 31);
+        }
+
+        // el resto (mezclas de las animaciones) va al más cercano
+        for (int c=0; c<(1 << 15); ++c){
+            int r = ((c >> 10) & 31) * 255 / 31, g = ((c >> 5) & 31) * 255 / 31, b = (c & 31) * 255 / 31;
+            int mejor = 0, mejorDist = 1 << 30;
+            for (int k=0; k<numColores; ++k){
+                int dr = r - rgb[k][0], dg = g - rgb[k][1], db = b - rgb[k][2];
+                int d = 2*dr*dr + 4*dg*dg + 3*db*db;
+                if (d < mejorDist){ mejorDist = d; mejor = k; }
+            }
+            indice[c] = (uint8_t)mejor;
+        }
+    }
+};
+
+// Compresor LZW de GIF (códigos de 9 a 12 bits) con sus tablas: uno por hilo, se reutiliza
+// entre frames sin reservar memoria
+class CompresorLzw {
+public:
+    CompresorLzw() : claves(TAM_HASH), codigos(TAM_HASH), marcas(TAM_HASH, 0) {}
+
+    // Añade a 'out' el tamaño mínimo de código, los sub-bloques de datos y el terminador
+    void comprimir(const uint8_t *indices, size_t n, std::vector<uint8_t> &out){
+        const int MIN_CODIGO = 8, LIMPIAR = 1 << MIN_CODIGO, FIN = LIMPIAR + 1;
+        salida = &out;
+        bits = 0; numBits = 0; bloque = 0;
+        out.push_back((uint8_t)MIN_CODIGO);
+        out.push_back(0);                      // tamaño del primer sub-bloque (se rellena después)
+        int tamCodigo = MIN_CODIGO + 1, maxCodigo = FIN;
+        vaciarTabla();
+        escribir(LIMPIAR, tamCodigo);
+
+        int actual = n ? indices[0] : 0;
+        for (size_t i=1; i<n; ++i){
+            int c = indices[i];
+            uint32_t clave = ((uint32_t)actual << 8) | (uint32_t)c;
+            int h = (int)((clave * 2654435761u) >> (32 - BITS_HASH));
+            bool hallado = false;
+            while (marcas[h] == generacion){
+                if (claves[h] == clave){ actual = codigos[h]; hallado = true; break; }
+                h = (h + 1) & (TAM_HASH - 1);
+            }
+            if (hallado) continue;
+
+            escribir(actual, tamCodigo);
+            marcas[h] = generacion;
+            claves[h] = clave;
+            codigos[h] = (uint16_t)++maxCodigo;
+            if (maxCodigo >= (1 << tamCodigo)) tamCodigo++;
+            if (maxCodigo == 4095){
+                escribir(LIMPIAR, tamCodigo);
+                vaciarTabla();
+                tamCodigo = MIN_CODIGO + 1;
+                maxCodigo = FIN;
+            }
+            actual = c;
+        }
+        escribir(actual, tamCodigo);
+        escribir(FIN, tamCodigo);
+        if (numBits > 0) byte((uint8_t)bits);
+        cerrarBloque();
+        out.push_back(0);                      // sin más sub-bloques
+    }
+
+    std::vector<uint8_t> indices;             // búfer de trabajo para los índices del frame
+
+private:
+    static const int BITS_HASH = 13, TAM_HASH = 1 << BITS_HASH;   // más del doble de 4096 códigos
+    std::vector<uint32_t> claves;
+    std::vector<uint16_t> codigos;
+    std::vector<uint32_t> marcas;             // entrada válida si su marca es la generación actual
+    uint32_t generacion = 0;
+
+    std::vector<uint8_t> *salida = nullptr;
+    uint32_t bits = 0;
+    int numBits = 0;
+    int bloque = 0;                           // bytes en el sub-bloque abierto
+
+    void vaciarTabla(){
+        if (++generacion == 0){
+            std::fill(marcas.begin(), marcas.end(), 0);
+            generacion = 1;
+        }
+    }
+
+    void escribir(int codigo, int tam){
+        bits |= (uint32_t)codigo << numBits;
+        numBits += tam;
+        while (numBits >= 8){
+            byte((uint8_t)bits);
+            bits >>= 8;
+            numBits -= 8;
+        }
+    }
+
+    void byte(uint8_t b){
+        salida->push_back(b);
+        if (++bloque == 255){
+            cerrarBloque();
+            salida->push_back(0);
+        }
+    }
+
+    // escribe el tamaño del sub-bloque abierto en el byte reservado delante de él
+    void cerrarBloque(){
+        if (bloque == 0){ salida->pop_back(); return; }
+        (*salida)[salida->size() - bloque - 1] = (uint8_t)bloque;
+        bloque = 0;
+    }
+};
+
+// Cabecera, paleta global y bucle infinito (extensión NETSCAPE2.0)
+inline void cabeceraGif(std::vector<uint8_t> &out, int ancho, int alto, const PaletaGif &paleta){
+    const char firma[] = "GIF89a";
+    out.insert(out.end(), firma, firma + 6);
+    auto u16 = [&](int v){ out.push_back((uint8_t)(v & 0xFF)); out.push_back((uint8_t)(v >> 8)); };
+    u16(ancho); u16(alto);
+    out.push_back(0xF7);                       // paleta global de 256 entradas, 8 bits por color
+    out.push_back(0);                          // fondo
+    out.push_back(0);                          // proporción de píxel
+    for (int k=0; k<256; ++k)
+        for (int c=0; c<3; ++c) out.push_back(k < paleta.numColores ? paleta.rgb[k][c] : 0);
+    const uint8_t bucle[] = { 0x21, 0xFF, 0x0B, 'N','E','T','S','C','A','P','E','2','.','0', 0x03, 0x01, 0x00, 0x00, 0x00 };
+    out.insert(out.end(), bucle, bucle + sizeof(bucle));
+}
+
+const uint8_t FIN_GIF = 0x3B;
+
+// Un frame: control (retardo en centésimas; lo de fuera del rectángulo se queda como estaba)
+// y la parte que cambió respecto a 'anterior' (todo el frame si es nullptr; un píxel si no
+// cambió nada, porque el GIF no admite frames vacíos)
+inline void frameGif(std::vector<uint8_t> &out, const uint8_t *rgba, const uint8_t *anterior, int ancho, int alto, bool filasInvertidas,
+                     int retardoCs, const PaletaGif &paleta, CompresorLzw &lzw){
+    auto fila = [&](const uint8_t *img, int y){ return img + (size_t)(filasInvertidas ? alto - 1 - y : y) * ancho * 4; };
+
+    int x0 = 0, y0 = 0, x1 = ancho - 1, y1 = alto - 1;
+    if (anterior){
+        x0 = ancho; y0 = alto; x1 = -1; y1 = -1;
+        for (int y=0; y<alto; ++y){
+            const uint8_t *a = fila(rgba, y), *b = fila(anterior, y);
+            if (std::memcmp(a, b, (size_t)ancho * 4) == 0) continue;
+            int i = 0, j = ancho - 1;
+            while (std::memcmp(a + 4*i, b + 4*i, 4) == 0) ++i;
+            while (std::memcmp(a + 4*j, b + 4*j, 4) == 0) --j;
+            if (i < x0) x0 = i;
+            if (j > x1) x1 = j;
+            if (y < y0) y0 = y;
+            y1 = y;
+        }
+        if (x1 < 0){ x0 = x1 = 0; y0 = y1 = 0; }
+    }
+    int w = x1 - x0 + 1, h = y1 - y0 + 1;
+
+    auto u16 = [&](int v){ out.push_back((uint8_t)(v & 0xFF)); out.push_back((uint8_t)(v >> 8)); };
+    out.push_back(0x21); out.push_back(0xF9); out.push_back(4);
+    out.push_back(0x04);                       // eliminación 1: no borrar
+    u16(retardoCs);
+    out.push_back(0); out.push_back(0);
+
+    out.push_back(0x2C);
+    u16(x0); u16(y0); u16(w); u16(h);
+    out.push_back(0);                          // sin paleta local
+
+    lzw.indices.resize((size_t)w * h);
+    uint8_t *idx = lzw.indices.data();
+    for (int y=y0; y<=y1; ++y){
+        const uint8_t *px = fila(rgba, y) + 4*x0;
+        for (int x=0; x<w; ++x, px += 4) *idx++ = paleta.cuantizar(px);
+    }
+    lzw.comprimir(lzw.indices.data(), lzw.indices.size(), out);
+}
@@ -1,20 +1,55 @@
 #pragma once
-#include "Tipos.hpp"
 #include "Reglas.hpp"
 #include <SFML/Graphics.hpp>
+#include <iostream>
 #include <map>
-#include <vector>
 #include <string>
+#include <cmath>
 
-// ---------------------- Centrar y escalar sprite ----------------------
-inline void centrarYescalar(sf::Sprite &s, int fila, int col){
-    sf::FloatRect b = s.getLocalBounds();
-    s.setOrigin(b.width/2.f, b.height/2.f);
-    sf::Vector2f centro = centroCasilla(fila,col); // proviene de reglas.hpp
-    s.setPosition(centro);
+// ---------------------- Configuración ----------------------
+const int TAM_CASILLA = 70;
+const int TABLERO_X   = 381; // coordenada X del tablero (sin márgenes)
+const int TABLERO_Y   = 50;  // coordenada Y del tablero (sin márgenes)
+
+// tolerancia (px) para aceptar un "drop" en la casilla más cercana
+const float RADIO_ACEPTACION = 40.0f;
+
+// animación captura
+const float DURACION_ANIMACION_CAPTURA = 0.30f; // segundos
+const float DURACION_ANIMACION_MOVIMIENTO = 0.15f; // deslizamiento de una pieza hasta su casilla
+
+// dot color
+const sf::Color DOT_COLOR(200, 200, 255, 220);
+
+// ---------------------- Sprites ----------------------
+// Parte gráfica de cada pieza, en un vector paralelo a 'piezas' (mismo índice)
+struct SpritePieza {
+    sf::Sprite sprite;
+
+    // para animaciones / restaurar escala
+    float baseSx = 1.0f;
+    float baseSy = 1.0f;
+
+    bool animandoCaptura = false;     // el sprite sigue visible hasta que acaba la animación
+};
+
+// ---------------------- Helpers ----------------------
+inline sf::Vector2f centroCasilla(int fila,int col){
+    float x = TABLERO_X + col * TAM_CASILLA + TAM_CASILLA / 2.0f;
+    float y = TABLERO_Y + fila * TAM_CASILLA + TAM_CASILLA / 2.0f;
+    return {x,y};
+}
+
+inline pair<int,int> casillaMasCercana(float px, float py){
+    float fx = (px - TABLERO_X) / (float)TAM_CASILLA;
+    float fy = (py - TABLERO_Y) / (float)TAM_CASILLA;
+    int c = (int)floor(fx + 0.5f);
+    int r = (int)floor(fy + 0.5f);
+    if (r<0) r=0; if (r>FILAS-1) r=FILAS-1;
+    if (c<0) c=0; if (c>COLS-1) c=COLS-1;
+    return {r,c};
 }
 
-// ---------------------- Cargar texturas ----------------------
 inline bool cargarTxt(sf::Texture &t, const std::string &ruta){
     if(!t.loadFromFile(ruta)){
         std::cerr << "No se pudo cargar: " << ruta << "\n";
@@ -23,82 +58,29 @@ inline bool cargarTxt(sf::Texture &t, const std::string &ruta){
     return true;
 }
 
+// las texturas se llaman como las piezas (assets/images/PeonB.png, ...)
+inline string claveTextura(TipoPieza tipo, ColorPieza color){
+    return nombrePieza(tipo, color);
+}
+
+// ---------------------- Centrar y escalar sprite ----------------------
+inline void centrarYescalar(sf::Sprite &s, int fila, int col){
+    sf::FloatRect b = s.getLocalBounds();
+    s.setOrigin(b.width/2.f, b.height/2.f);
+    sf::Vector2f centro = centroCasilla(fila,col);
+    s.setPosition(centro);
+}
+
 // ---------------------- Inicializar tablero gráfico ----------------------
-inline void inicializarTablero(sf::Sprite &fondo, sf::Sprite &tablero, std::map<std::string,sf::Texture> &tex){
-    fondo.setTexture(tex["Fondo"]);
+// Solo el tablero, escalado a 8 casillas en (TABLERO_X, TABLERO_Y): Diagramas y Video no tienen fondo
+inline void inicializarTablero(sf::Sprite &tablero, std::map<std::string,sf::Texture> &tex){
     tablero.setTexture(tex["Tablero"]);
     tablero.setPosition((float)TABLERO_X, (float)TABLERO_Y);
     float escalaTab = (8.0f * TAM_CASILLA) / (float)tex["Tablero"].getSize().x;
     tablero.setScale(escalaTab, escalaTab);
 }
 
-// ---------------------- Añadir pieza ----------------------
-inline void addPieza(std::vector<Pieza> &piezas, std::map<std::string,sf::Texture> &tex,
-                     TipoPieza tipo, ColorPieza color, int fila, int col,
-                     const std::string &texKey, const std::string &baseKey, int &contadorId){
-    Pieza p;
-    p.id = baseKey + "_" + std::to_string(contadorId++);
-    p.tipo = tipo;
-    p.color = color;
-    p.fila = fila;
-    p.col = col;
-    p.sprite.setTexture(tex[texKey]);
-
-    const sf::Texture* t = p.sprite.getTexture();
-    if (t){
-        p.baseSx = (float)TAM_CASILLA / (float)t->getSize().x;
-        p.baseSy = (float)TAM_CASILLA / (float)t->getSize().y;
-        p.sprite.setScale(p.baseSx, p.baseSy);
-    }
-
-    centrarYescalar(p.sprite, fila, col);
-    tableroLogico[fila][col] = (int)piezas.size();
-    piezas.push_back(std::move(p));
-}
-
-// ---------------------- Dibujar movimientos válidos ----------------------
-inline void dibujarMovimientos(sf::RenderWindow &window, const std::vector<std::pair<int,int>> &movimientosValidos){
-    sf::CircleShape dot((float)TAM_CASILLA * 0.12f);
-    dot.setOrigin(dot.getRadius(), dot.getRadius());
-    dot.setFillColor(DOT_COLOR);
-    for (auto &m : movimientosValidos){
-        sf::Vector2f c = centroCasilla(m.first, m.second); // proviene de reglas.hpp
-        dot.setPosition(c);
-        window.draw(dot);
-    }
-}
-
-// ---------------------- Dibujar jaque ----------------------
-inline void dibujarJaque(sf::RenderWindow &window, const std::vector<Pieza> &piezas, bool blancoEnJaque, bool negroEnJaque){
-    if (blancoEnJaque || negroEnJaque){
-        int idxRey = -1;
-        ColorPieza c = blancoEnJaque ? ColorPieza::White : ColorPieza::Black;
-        idxRey = encontrarIndiceRey(piezas, c); // proviene de reglas.hpp
-        if (idxRey != -1 && piezas[idxRey].alive){
-            sf::RectangleShape r(sf::Vector2f((float)TAM_CASILLA, (float)TAM_CASILLA));
-            r.setFillColor(sf::Color::Transparent);
-            r.setOutlineColor(sf::Color::Red);
-            r.setOutlineThickness(3.0f);
-            float left = TABLERO_X + piezas[idxRey].col * TAM_CASILLA;
-            float top  = TABLERO_Y + piezas[idxRey].fila * TAM_CASILLA;
-            r.setPosition(left, top);
-            window.draw(r);
-        }
-    }
-}
-
-// ---------------------- Dibujar piezas ----------------------
-inline void dibujarPiezas(sf::RenderWindow &window, const std::vector<Pieza> &piezas, int idxSeleccionado){
-    for (int i=0;i<(int)piezas.size();++i){
-        if (i == idxSeleccionado) continue;
-        if (piezas[i].alive || piezas[i].animandoCaptura) window.draw(piezas[i].sprite);
-    }
+inline void inicializarTablero(sf::Sprite &fondo, sf::Sprite &tablero, std::map<std::string,sf::Texture> &tex){
+    fondo.setTexture(tex["Fondo"]);
+    inicializarTablero(tablero, tex);
 }
-
-// ---------------------- Dibujar sombra y pieza arrastrada ----------------------
-inline void dibujarArrastrada(sf::RenderWindow &window, const Pieza &pieza, sf::CircleShape &sombra){
-    sf::Vector2f pos = pieza.sprite.getPosition();
-    sombra.setPosition(pos.x + 6.f, pos.y + 10.f); // ahora sombra no es const
-    window.draw(sombra);
-    window.draw(pieza.sprite);
-}
\ No newline at end of file
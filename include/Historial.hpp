@@ -0,0 +1,98 @@
+#pragma once
+#include "Reglas.hpp"
+#include "Tablas.hpp"
+#include <vector>
+#include <algorithm>
+
+// ---------------------- Historial y repetición ----------------------
+// Cada INTERVALO_FOTOS jugadas se guarda una foto del estado lógico; ir a cualquier jugada
+// es restaurar la foto anterior y aplicar como mucho INTERVALO_FOTOS-1 jugadas con aplicarJugada.
+// Todo lo que cambia el estado entra por la jugada (también la guardia, en j.guardia): así el
+// registro para deshacer y las fotos se toman antes de que cambie nada. BancoReglas lo comprueba.
+const int INTERVALO_FOTOS = 16;
+const int MAX_PIEZAS = 32;
+
+struct FotoPosicion {
+    int8_t tablero[FILAS][COLS];
+    Pieza piezas[MAX_PIEZAS];
+    int numPiezas = 0;
+    ReglasFlags flagsBlanco, flagsNegro;
+    ColorPieza turno = ColorPieza::White;
+};
+
+inline void tomarFoto(FotoPosicion &foto, const vector<Pieza>& piezas, const Tablero& tablero, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro, ColorPieza turno){
+    for(int r=0;r<FILAS;r++) for(int c=0;c<COLS;c++) foto.tablero[r][c] = (int8_t)tablero[r][c];
+    foto.numPiezas = std::min((int)piezas.size(), MAX_PIEZAS);
+    std::copy(piezas.begin(), piezas.begin() + foto.numPiezas, foto.piezas);
+    foto.flagsBlanco = flagsBlanco;
+    foto.flagsNegro = flagsNegro;
+    foto.turno = turno;
+}
+
+inline void restaurarFoto(const FotoPosicion &foto, vector<Pieza>& piezas, Tablero& tablero, ReglasFlags& flagsBlanco, ReglasFlags& flagsNegro, ColorPieza& turno){
+    for(int r=0;r<FILAS;r++) for(int c=0;c<COLS;c++) tablero[r][c] = foto.tablero[r][c];
+    std::copy(foto.piezas, foto.piezas + std::min(foto.numPiezas, (int)piezas.size()), piezas.begin());
+    flagsBlanco = foto.flagsBlanco;
+    flagsNegro = foto.flagsNegro;
+    turno = foto.turno;
+}
+
+struct Historial {
+    vector<Jugada> jugadas;
+    vector<RegistroDeshacer> registros;   // uno por jugada, para deshacer
+    vector<FotoPosicion> fotos;           // fotos[k] = posición tras k*INTERVALO_FOTOS jugadas
+    int actual = 0;                       // jugadas aplicadas; las siguientes se pueden rehacer
+    SeguimientoTablas tablas;             // repetición, regla de las 50 y material de la posición actual
+
+    // Aplica una jugada nueva en la partida en vivo (descarta las que se podían rehacer)
+    EfectoJugada jugar(const Jugada& j, vector<Pieza>& piezas, Tablero& tablero, ReglasFlags& flagsBlanco, ReglasFlags& flagsNegro, ColorPieza& turno){
+        jugadas.resize(actual);
+        registros.resize(actual);
+        fotos.resize((actual + INTERVALO_FOTOS - 1) / INTERVALO_FOTOS);
+        if (actual % INTERVALO_FOTOS == 0){
+            fotos.emplace_back();
+            tomarFoto(fotos.back(), piezas, tablero, flagsBlanco, flagsNegro, turno);
+        }
+        jugadas.push_back(j);
+        registros.emplace_back();
+        actual++;
+        EfectoJugada ef = aplicarJugada(piezas, tablero, j, flagsBlanco, flagsNegro, turno, &registros.back());
+        tablas.registrar(piezas, tablero, j, registros.back(), flagsBlanco, flagsNegro, turno);
+        return ef;
+    }
+
+    // Memoria para 'n' medias jugadas: jugar no vuelve a pedir hasta pasar de ahí
+    void reservar(int n){
+        jugadas.reserve(n);
+        registros.reserve(n);
+        fotos.reserve(n / INTERVALO_FOTOS + 1);
+        tablas.reservar(n + 1);
+    }
+
+    bool puedeDeshacer() const { return actual > 0; }
+    bool puedeRehacer() const { return actual < (int)jugadas.size(); }
+
+    EfectoJugada deshacer(vector<Pieza>& piezas, Tablero& tablero, ReglasFlags& flagsBlanco, ReglasFlags& flagsNegro, ColorPieza& turno){
+        actual--;
+        tablas.deshacer();
+        return deshacerJugada(piezas, tablero, jugadas[actual], registros[actual], flagsBlanco, flagsNegro, turno);
+    }
+
+    EfectoJugada rehacer(vector<Pieza>& piezas, Tablero& tablero, ReglasFlags& flagsBlanco, ReglasFlags& flagsNegro, ColorPieza& turno){
+        EfectoJugada ef = aplicarJugada(piezas, tablero, jugadas[actual], flagsBlanco, flagsNegro, turno, &registros[actual]);
+        tablas.registrar(piezas, tablero, jugadas[actual], registros[actual], flagsBlanco, flagsNegro, turno);
+        actual++;
+        return ef;
+    }
+
+    // Deja el estado lógico en la posición tras 'ply' jugadas
+    void irA(int ply, vector<Pieza>& piezas, Tablero& tablero, ReglasFlags& flagsBlanco, ReglasFlags& flagsNegro, ColorPieza& turno) const {
+        if (fotos.empty()) return;
+        if (ply < 0) ply = 0;
+        if (ply > actual) ply = actual;
+        int k = std::min(ply / INTERVALO_FOTOS, (int)fotos.size() - 1);
+        restaurarFoto(fotos[k], piezas, tablero, flagsBlanco, flagsNegro, turno);
+        for (int i = k * INTERVALO_FOTOS; i < ply; ++i)
+            aplicarJugada(piezas, tablero, jugadas[i], flagsBlanco, flagsNegro, turno);
+    }
+};
@@ -0,0 +1,263 @@
+#pragma once
+#include "Protocolo.hpp"
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+#include <cstdint>
+#include <cctype>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// ---------------------- Índice de partidas ----------------------
+// Índice invertido de una colección de partidas (una por línea, en la notación del protocolo),
+// para preguntas como "partidas que pasan por esta posición", "con enroque extendido" o "que
+// llegan a dama contra torre". Cada partida aporta sus términos: las posiciones por las que pasa,
+// las firmas de material a las que llega y los sucesos de las reglas (guardia, enroques, al paso,
+// promociones, resultado). Cada término tiene su lista de partidas (número de línea, de menor a
+// mayor). Partidas.exe lo construye en varios hilos; para buscar se mapea el archivo (POSIX:
+// mmap) y una lista es un trozo del mapa, sin leer ni copiar nada más.
+//
+// Formato (enteros en el orden de bytes de la máquina, little endian en x86):
+//   cabecera de 48 bytes: "ALMATE INDICE 1\n", partidas, términos, apariciones y tamaño del
+//                         archivo de partidas indexado (u64 cada uno)
+//   desplazamientos:      (partidas + 1) u64, dónde empieza cada línea en el archivo de partidas
+//   directorio:           65537 u64, primer término cuyos 16 bits altos son >= i
+//   apariciones:          u32 por aparición, las listas una detrás de otra (y 4 bytes de
+//                         relleno si son impares)
+//   términos:             (términos + 1) x { clave u64, primera aparición u64 }, ordenados por
+//                         clave; el último es un centinela (la lista del término k acaba donde
+//                         empieza la del k+1)
+//
+// Las claves son hashes de 64 bits, no la posición entera: dos posiciones distintas con la misma
+// clave (improbable con menos de miles de millones) darían partidas de más.
+
+const char CABECERA_INDICE[] = "ALMATE INDICE 1\n";
+const size_t TAM_CABECERA_INDICE = 48;
+const int BITS_DIRECTORIO = 16;
+const size_t TAM_DIRECTORIO = (1u << BITS_DIRECTORIO) + 1;
+
+struct TerminoIndice {
+    uint64_t clave;
+    uint64_t inicio;
+};
+
+// Dónde empieza cada parte y cuánto ocupa todo
+inline size_t inicioDirectorio(uint64_t partidas){ return TAM_CABECERA_INDICE + (size_t)(partidas + 1) * 8; }
+inline size_t inicioApariciones(uint64_t partidas){ return inicioDirectorio(partidas) + TAM_DIRECTORIO * 8; }
+inline size_t inicioTerminos(uint64_t partidas, uint64_t apariciones){ return inicioApariciones(partidas) + (size_t)(apariciones + (apariciones & 1)) * 4; }
+inline size_t tamIndice(uint64_t partidas, uint64_t terminos, uint64_t apariciones){
+    return inicioTerminos(partidas, apariciones) + (size_t)(terminos + 1) * sizeof(TerminoIndice);
+}
+
+// ---------------------- Términos ----------------------
+// splitmix64: cambia la mitad de los bits de salida por cada bit de entrada
+inline uint64_t mezclarTermino(uint64_t x){
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+enum class TipoTermino : uint64_t { Posicion = 1, Material = 2, Suceso = 3 };
+
+// Piezas en sus casillas y el turno (sin derechos de enroque ni flags de Almate: la misma
+// posición en el tablero cuenta igual en cualquier partida)
+inline uint64_t terminoPosicion(const vector<Pieza>& piezas, const Tablero& tablero, ColorPieza turno){
+    uint64_t h = (turno == ColorPieza::Black) ? mezclarTermino((uint64_t)TipoTermino::Posicion << 56) : 0;
+    for (int s=0; s<FILAS*COLS; ++s){
+        int i = tablero[s / COLS][s % COLS];
+        if (i == -1) continue;
+        uint64_t pieza = (uint64_t)piezas[i].color * 6 + (uint64_t)piezas[i].tipo;
+        h ^= mezclarTermino(((uint64_t)TipoTermino::Posicion << 56) | ((uint64_t)s << 4) | pieza);
+    }
+    return h;
+}
+
+// Cuántas piezas de cada tipo tiene cada bando ([bando][TipoPieza])
+struct CuentaMaterial {
+    uint8_t n[2][6] = {};
+    bool operator==(const CuentaMaterial &o) const { return std::memcmp(n, o.n, sizeof(n)) == 0; }
+};
+
+inline CuentaMaterial cuentaMaterial(const vector<Pieza>& piezas){
+    CuentaMaterial m;
+    for (const Pieza &p : piezas)
+        if (p.alive && m.n[(int)p.color][(int)p.tipo] < 15) m.n[(int)p.color][(int)p.tipo]++;
+    return m;
+}
+
+inline uint64_t terminoMaterial(const CuentaMaterial &m){
+    uint64_t v = 0;
+    for (int c=0; c<2; ++c)
+        for (int t=0; t<6; ++t) v = (v << 4) | m.n[c][t];
+    return mezclarTermino(((uint64_t)TipoTermino::Material << 56) | v);
+}
+
+// Material en texto: las piezas de las blancas, '-' y las de las negras, con R rey, D dama,
+// T torre, A alfil, C caballo y P peón ("RD-RT", "RTPP-RT"). Sin rey se entiende que lo hay.
+inline bool textoAMaterial(const string &txt, CuentaMaterial &m){
+    m = CuentaMaterial();
+    size_t guion = txt.find('-');
+    if (guion == string::npos || txt.find('-', guion + 1) != string::npos) return false;
+    for (size_t i=0; i<txt.size(); ++i){
+        if (i == guion) continue;
+        int bando = (i < guion) ? 0 : 1;
+        TipoPieza t;
+        switch (std::toupper((unsigned char)txt[i])){
+            case 'R': t = TipoPieza::King; break;
+            case 'D': t = TipoPieza::Queen; break;
+            case 'T': t = TipoPieza::Rook; break;
+            case 'A': t = TipoPieza::Bishop; break;
+            case 'C': t = TipoPieza::Knight; break;
+            case 'P': t = TipoPieza::Pawn; break;
+            default: return false;
+        }
+        if (++m.n[bando][(int)t] > 15) return false;
+    }
+    for (int c=0; c<2; ++c)
+        if (m.n[c][(int)TipoPieza::King] == 0) m.n[c][(int)TipoPieza::King] = 1;
+    return true;
+}
+
+// Sucesos de las reglas que se indexan, por nombre (los resultados, como motivoResultado en
+// minúsculas: "mate_blancas", "tablas_50"...)
+const char* const SUCESOS_INDICE[] = {
+    "guardia",          // alguien usó la guardia (Regla 1)
+    "enroque3",         // enroque extendido (Regla 2)
+    "enroque",          // enroque normal
+    "alpaso",           // captura al paso
+    "promocion",
+    "subpromocion",     // a algo que no es dama
+    "ilegal",           // la línea tiene una jugada ilegal (se indexa hasta ella)
+};
+
+inline uint64_t terminoSuceso(const string &nombre){
+    uint64_t h = 14695981039346656037ULL;
+    for (char ch : nombre){ h ^= (uint8_t)std::tolower((unsigned char)ch); h *= 1099511628211ULL; }
+    return mezclarTermino(((uint64_t)TipoTermino::Suceso << 56) ^ h);
+}
+
+inline string nombreSucesoResultado(ResultadoPartida r){
+    string s = motivoResultado(r);
+    for (char &ch : s) ch = (char)std::tolower((unsigned char)ch);
+    return s;
+}
+
+// Todos los nombres que se pueden buscar con --suceso: SUCESOS_INDICE y los resultados
+inline vector<string> nombresSucesos(){
+    vector<string> v(std::begin(SUCESOS_INDICE), std::end(SUCESOS_INDICE));
+    for (int r = (int)ResultadoPartida::MateBlancas; r <= (int)ResultadoPartida::MaterialInsuficiente; ++r)
+        v.push_back(nombreSucesoResultado((ResultadoPartida)r));
+    return v;
+}
+
+// Sin distinguir mayúsculas, como terminoSuceso
+inline bool esSucesoIndice(const string &nombre){
+    string n = nombre;
+    for (char &ch : n) ch = (char)std::tolower((unsigned char)ch);
+    for (const string &s : nombresSucesos())
+        if (s == n) return true;
+    return false;
+}
+
+// ---------------------- Listas ----------------------
+struct ListaPartidas {
+    const uint32_t *p = nullptr;
+    size_t n = 0;
+};
+
+// Partidas que están en todas las listas (cada una de menor a mayor). Se recorre la más corta
+// y en las demás se avanza a saltos (1, 2, 4... y búsqueda binaria en el último salto), así que
+// una lista larga cuesta el logaritmo de lo que se salta, no su longitud.
+inline void interseccion(std::vector<ListaPartidas> listas, std::vector<uint32_t> &out){
+    out.clear();
+    if (listas.empty()) return;
+    std::sort(listas.begin(), listas.end(), [](const ListaPartidas &a, const ListaPartidas &b){ return a.n < b.n; });
+    std::vector<size_t> pos(listas.size(), 0);
+    for (size_t i=0; i<listas[0].n; ++i){
+        uint32_t x = listas[0].p[i];
+        bool enTodas = true;
+        for (size_t k=1; k<listas.size() && enTodas; ++k){
+            const ListaPartidas &l = listas[k];
+            size_t a = pos[k], paso = 1;
+            while (a + paso < l.n && l.p[a + paso] < x){ a += paso; paso *= 2; }
+            pos[k] = (size_t)(std::lower_bound(l.p + a, l.p + std::min(l.n, a + paso + 1), x) - l.p);
+            enTodas = pos[k] < l.n && l.p[pos[k]] == x;
+        }
+        if (enTodas) out.push_back(x);
+    }
+}
+
+// ---------------------- Lectura ----------------------
+class IndicePartidas {
+public:
+    ~IndicePartidas(){ cerrar(); }
+
+    bool abrir(const std::string &ruta){
+        cerrar();
+        fd = ::open(ruta.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || (size_t)st.st_size < TAM_CABECERA_INDICE){ cerrar(); return false; }
+        tam = (size_t)st.st_size;
+        void *p = ::mmap(nullptr, tam, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED){ cerrar(); return false; }
+        mapa = (const uint8_t*)p;
+        if (std::memcmp(mapa, CABECERA_INDICE, 16) != 0){ cerrar(); return false; }
+        std::memcpy(&partidas, mapa + 16, 8);
+        std::memcpy(&terminos, mapa + 24, 8);
+        std::memcpy(&apariciones, mapa + 32, 8);
+        std::memcpy(&tamOrigen, mapa + 40, 8);
+        if (tam != tamIndice(partidas, terminos, apariciones)){ cerrar(); return false; }
+        desplazamientos = (const uint64_t*)(mapa + TAM_CABECERA_INDICE);
+        directorio = desplazamientos + partidas + 1;
+        lista = (const uint32_t*)(directorio + TAM_DIRECTORIO);
+        tabla = (const TerminoIndice*)(lista + apariciones + (apariciones & 1));
+        return true;
+    }
+
+    void cerrar(){
+        if (mapa) ::munmap((void*)mapa, tam);
+        if (fd >= 0) ::close(fd);
+        mapa = nullptr;
+        fd = -1;
+        tam = 0;
+        partidas = terminos = apariciones = tamOrigen = 0;
+    }
+
+    // Partidas del término (vacía si no está): búsqueda binaria dentro de su trozo del directorio
+    ListaPartidas partidasCon(uint64_t clave) const {
+        ListaPartidas r;
+        if (!mapa) return r;
+        size_t d = (size_t)(clave >> (64 - BITS_DIRECTORIO));
+        const TerminoIndice *a = tabla + directorio[d], *b = tabla + directorio[d + 1];
+        const TerminoIndice *t = std::lower_bound(a, b, clave, [](const TerminoIndice &x, uint64_t k){ return x.clave < k; });
+        if (t == b || t->clave != clave) return r;
+        r.p = lista + t->inicio;
+        r.n = (size_t)(t[1].inicio - t->inicio);
+        return r;
+    }
+
+    // Byte donde empieza la línea de la partida en el archivo indexado, y dónde acaba
+    uint64_t inicioPartida(uint32_t partida) const { return desplazamientos[partida]; }
+    uint64_t finPartida(uint32_t partida) const { return desplazamientos[partida + 1]; }
+
+    uint64_t numPartidas() const { return partidas; }
+    uint64_t numTerminos() const { return terminos; }
+    uint64_t numApariciones() const { return apariciones; }
+    uint64_t tamArchivoPartidas() const { return tamOrigen; }
+
+private:
+    int fd = -1;
+    const uint8_t *mapa = nullptr;
+    size_t tam = 0;
+    uint64_t partidas = 0, terminos = 0, apariciones = 0, tamOrigen = 0;
+    const uint64_t *desplazamientos = nullptr;
+    const uint64_t *directorio = nullptr;
+    const TerminoIndice *tabla = nullptr;
+    const uint32_t *lista = nullptr;
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include "Reglas.hpp"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// ---------------------- Validación por lotes ----------------------
+// El servidor recibe jugadas de miles de partidas a la vez. validarLote comprueba N pares
+// (posición, jugada) juntos: cada posición va en bitboards (PosicionLote) y las comprobaciones
+// (origen y destino, geometría de la pieza, piezas en medio y si el rey propio queda en jaque
+// después) son desplazamientos y máscaras sin saltos, iguales para todas las jugadas. Con AVX2
+// van cuatro jugadas por instrucción; sin AVX2 (u otra CPU) el mismo código va de una en una.
+// Los enroques, que son pocos, se terminan de comprobar aparte, también sobre los bitboards.
+//
+// El resultado es el mismo que EstadoPartida::esValida (destinoLegal, la guardia y la
+// promoción) para la variante indicada. BancoReglas lo compara y lo mide.
+
+// Posición vista por el bando que mueve (88 bytes, se copia tal cual en el lote)
+struct PosicionLote {
+    uint64_t bandos[2] = {};         // casillas (bits de indiceCasilla) de blancas y negras
+    uint64_t tipos[6] = {};          // por TipoPieza, de los dos bandos
+    uint64_t sinMover = 0;           // piezas que no se han movido (enroque)
+    uint64_t protegida = 0;          // Regla 1: la pieza del rival con la guardia durante este turno
+    uint8_t turno = 0;               // (int)ColorPieza del que mueve
+    uint8_t alPaso = SIN_CASILLA;    // casilla que saltó el último avance doble del rival
+    bool guardiaUsada = false;       // del que mueve
+    bool enroque3Usado = false;      // del que mueve
+};
+
+void posicionALote(PosicionLote &p, const vector<Pieza>& piezas, const Tablero& tablero, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro,
+                   ColorPieza turno);
+
+enum class NucleoLote {
+    Automatico,       // AVX2 si la CPU lo tiene
+    Escalar,          // una jugada cada vez
+    Avx2
+};
+
+// true si este binario y esta CPU pueden usar el núcleo AVX2
+bool avx2Disponible();
+
+// legales[i] = 1 si jugadas[i] es legal en posiciones[i], 0 si no
+template <class Variante = ReglasAlmate>
+void validarLote(const PosicionLote *posiciones, const Jugada *jugadas, size_t n, uint8_t *legales, NucleoLote nucleo = NucleoLote::Automatico);
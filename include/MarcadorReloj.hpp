@@ -0,0 +1,126 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <string>
+#include <iostream>
+#include <cstdint>
+
+// ---------------------- Marcador del reloj ----------------------
+// Dibuja el tiempo de cada bando con los dígitos de assets/images ("0 claro".."9 oscuro",
+// "puntos", "m") y el panel "Reloj 1-6". Los glifos se copian una sola vez a una tira de
+// textura (fila 0 claro, fila 1 oscuro) y cada marcador es un VertexArray de quads que solo
+// se reconstruye cuando cambia el texto mostrado.
+
+const int GLIFO_ANCHO = 40;
+const int GLIFO_ALTO = 86;
+const int NUM_GLIFOS = 12;           // 0-9, ':' (puntos), 'm'
+const int GLIFO_PUNTOS = 10;
+const int GLIFO_M = 11;
+const int MAX_GLIFOS_MARCADOR = 5;   // "MM:SS" o "NNNm"
+
+const int NUM_PANELES_RELOJ = 6;
+const sf::IntRect AREA_PANEL_RELOJ(0, 0, 330, 225);   // el resto de "Reloj N.png" es transparente
+
+struct MarcadorReloj {
+    sf::Texture tira;
+    sf::Texture paneles[NUM_PANELES_RELOJ];
+    sf::Sprite panel[2];
+    sf::VertexArray digitos[2];
+    int64_t mostrado[2] = { -1, -1 };   // texto representado ahora (para no reconstruir los quads)
+    sf::Vector2f origenTexto[2];
+
+    bool cargar(const std::string &dir){
+        sf::Image img;
+        img.create(NUM_GLIFOS * GLIFO_ANCHO, 2 * GLIFO_ALTO, sf::Color::Transparent);
+        const char* estilos[2] = { " claro.png", " oscuro.png" };
+        for (int fila=0; fila<2; ++fila){
+            for (int g=0; g<NUM_GLIFOS; ++g){
+                std::string nombre = (g < 10) ? std::to_string(g) : (g == GLIFO_PUNTOS ? "puntos" : "m");
+                std::string ruta = dir + nombre + estilos[fila];
+                sf::Image glifo;
+                if (!glifo.loadFromFile(ruta)){
+                    std::cerr << "No se pudo cargar: " << ruta << "\n";
+                    return false;
+                }
+                img.copy(glifo, g * GLIFO_ANCHO, fila * GLIFO_ALTO);
+            }
+        }
+        if (!tira.loadFromImage(img)) return false;
+
+        for (int i=0; i<NUM_PANELES_RELOJ; ++i){
+            std::string ruta = dir + "Reloj " + std::to_string(i+1) + ".png";
+            if (!paneles[i].loadFromFile(ruta, AREA_PANEL_RELOJ)){
+                std::cerr << "No se pudo cargar: " << ruta << "\n";
+                return false;
+            }
+        }
+
+        // negras arriba colgando del borde superior; blancas abajo, reflejado, apoyado en el inferior
+        panel[1].setTexture(paneles[0]);
+        panel[1].setPosition(0.f, 0.f);
+        panel[0].setTexture(paneles[0]);
+        panel[0].setScale(1.f, -1.f);
+        panel[0].setPosition(0.f, 700.f);
+
+        float centroX = 185.f;
+        float x0 = centroX - MAX_GLIFOS_MARCADOR * GLIFO_ANCHO / 2.0f;
+        origenTexto[1] = sf::Vector2f(x0, 105.f - GLIFO_ALTO / 2.0f);
+        origenTexto[0] = sf::Vector2f(x0, 700.f - 105.f - GLIFO_ALTO / 2.0f);
+
+        for (int l=0; l<2; ++l) digitos[l] = sf::VertexArray(sf::Quads, MAX_GLIFOS_MARCADOR * 4);
+        return true;
+    }
+
+    // restanteMs: tiempo del bando; activo: su reloj corre; cuadro: fotograma del panel (0-5)
+    void actualizar(int lado, int64_t restanteMs, bool activo, int cuadro){
+        panel[lado].setTexture(paneles[activo ? cuadro % NUM_PANELES_RELOJ : 3]);
+
+        // "MM:SS" hasta 99:59, luego minutos con "m"; redondeo hacia arriba como los relojes de torneo
+        int64_t seg = (restanteMs + 999) / 1000;
+        int64_t visible = (seg < 100 * 60) ? seg : 100 * 60 + seg / 60;
+        int64_t clave = visible * 2 + (activo ? 1 : 0);
+        if (clave == mostrado[lado]) return;
+        mostrado[lado] = clave;
+
+        int glifos[MAX_GLIFOS_MARCADOR];
+        int n = 0;
+        if (seg < 100 * 60){
+            int64_t m = seg / 60, s = seg % 60;
+            glifos[n++] = (int)(m / 10); glifos[n++] = (int)(m % 10);
+            glifos[n++] = GLIFO_PUNTOS;
+            glifos[n++] = (int)(s / 10); glifos[n++] = (int)(s % 10);
+        } else {
+            int64_t m = seg / 60;
+            if (m > 999) m = 999;
+            glifos[n++] = (int)(m / 100); glifos[n++] = (int)(m / 10 % 10); glifos[n++] = (int)(m % 10);
+            glifos[n++] = GLIFO_M;
+        }
+
+        float fila = activo ? 0.f : (float)GLIFO_ALTO;
+        float x = origenTexto[lado].x + (MAX_GLIFOS_MARCADOR - n) * GLIFO_ANCHO / 2.0f;
+        float y = origenTexto[lado].y;
+        for (int i=0; i<MAX_GLIFOS_MARCADOR; ++i){
+            sf::Vertex *q = &digitos[lado][i * 4];
+            if (i >= n){
+                for (int v=0; v<4; ++v) q[v].position = q[v].texCoords = sf::Vector2f(0.f, 0.f);
+                continue;
+            }
+            float tx = (float)(glifos[i] * GLIFO_ANCHO);
+            float px = x + i * GLIFO_ANCHO;
+            q[0].position = sf::Vector2f(px, y);
+            q[1].position = sf::Vector2f(px + GLIFO_ANCHO, y);
+            q[2].position = sf::Vector2f(px + GLIFO_ANCHO, y + GLIFO_ALTO);
+            q[3].position = sf::Vector2f(px, y + GLIFO_ALTO);
+            q[0].texCoords = sf::Vector2f(tx, fila);
+            q[1].texCoords = sf::Vector2f(tx + GLIFO_ANCHO, fila);
+            q[2].texCoords = sf::Vector2f(tx + GLIFO_ANCHO, fila + GLIFO_ALTO);
+            q[3].texCoords = sf::Vector2f(tx, fila + GLIFO_ALTO);
+        }
+    }
+
+    void dibujar(sf::RenderTarget &destino){
+        for (int l=0; l<2; ++l){
+            destino.draw(panel[l]);
+            destino.draw(digitos[l], sf::RenderStates(&tira));
+        }
+    }
+};
@@ -0,0 +1,69 @@
+#pragma once
+#include "Reglas.hpp"
+#include "Tablas.hpp"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// ---------------------- Mate en N ----------------------
+// Demuestra mates forzados de hasta N jugadas del bando que mueve con las reglas de Almate:
+// búsqueda en profundidad con profundización iterativa y tabla de transposición (hash Zobrist
+// de Tablas.hpp). Las jugadas de los dos bandos incluyen el enroque extendido y, mientras no se
+// haya usado, la guardia: proteger una pieza solo cambia algo si el rival puede capturarla en
+// su jugada siguiente, así que solo se prueba sobre esas piezas (sobre las demás gasta la regla
+// sin ganar nada). Las tablas por repetición y por la regla de las 50 no se tienen en cuenta.
+// Cada BuscadorMate tiene su estado y su tabla: uno por hilo.
+
+struct ProblemaMate {
+    int jugadas = 0;             // N del mate más corto (0 = no hay mate hasta el límite)
+    Jugada clave;                // primera jugada de la solución
+    int claves = 0;              // jugadas clave distintas que dan mate en N (1 = solución única)
+    bool abortado = false;       // se acabaron los nodos antes de decidir
+    vector<Jugada> linea;        // clave, mejor defensa, ... hasta el mate
+};
+
+class BuscadorMate {
+public:
+    explicit BuscadorMate(size_t maxEntradas = 1 << 20) : maxEntradas(maxEntradas) {}
+
+    // Mate del bando 'turno' en como mucho 'maxN' jugadas. 'maxNodos' = 0 no limita la búsqueda.
+    ProblemaMate resolver(const vector<Pieza>& piezas, const Tablero& tablero, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro,
+                          ColorPieza turno, int maxN, unsigned long long maxNodos = 0);
+
+    unsigned long long nodos = 0;     // posiciones visitadas (acumulado)
+
+private:
+    struct EntradaTT {
+        uint8_t mate = 0;             // hay mate en estas jugadas (0 = no demostrado)
+        uint8_t sinMate = 0;          // no hay mate en estas jugadas o menos
+        Jugada mejor;                 // la que da el mate más corto conocido
+    };
+
+    vector<Pieza> piezas;
+    Tablero tablero;
+    ReglasFlags flagsBlanco, flagsNegro;
+    ColorPieza turno = ColorPieza::White;
+
+    std::unordered_map<uint64_t, EntradaTT> tabla;
+    size_t maxEntradas;
+    unsigned long long limiteNodos = 0;
+    bool abortado = false;
+
+    vector<MovimientosTurno> mts;     // por ply, para no recalcular ni reservar en la búsqueda
+    vector<vector<Jugada>> listas;
+
+    uint64_t hash() const { return hashPosicion(piezas, tablero, flagsBlanco, flagsNegro, turno); }
+    const ReglasFlags& flagsDe(ColorPieza c) const { return (c == ColorPieza::White) ? flagsBlanco : flagsNegro; }
+
+    void jugadasDe(const MovimientosTurno& mt, vector<Jugada>& out) const;
+    uint64_t capturables(const MovimientosTurno& mtRival, ColorPieza color) const;
+    uint8_t casillaAntes(int casilla, const Jugada& j, const RegistroDeshacer& reg) const;
+    void aplicar(const Jugada& j, RegistroDeshacer& reg);
+    void deshacer(const Jugada& j, const RegistroDeshacer& reg);
+    void ordenarJaquesPrimero(vector<Jugada>& lista);
+
+    bool ataque(int n, int ply);
+    bool probar(const Jugada& j, int n, int ply, Jugada* conGuardia);
+    bool defensa(int n, int ply);
+    int distanciaMate(int n, int ply);
+};
@@ -0,0 +1,305 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <vector>
+#include <array>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include "Reglas.hpp"   // ContadoresPerfil
+#include "Asignaciones.hpp"
+
+// ---------------------- Perfilador de frames ----------------------
+// Mide cuánto tarda cada frame del bucle principal y en qué se va el tiempo.
+// F3 muestra/oculta la gráfica; F4 empieza/termina una grabación que se vuelca
+// a perfil.csv y perfil.json (formato Chrome trace, abrir en chrome://tracing).
+// Al repetir una sesión grabada (Sesion.hpp) se graban todos sus frames y al final se
+// escribe un resumen.
+// Con el contador de asignaciones (Asignaciones.hpp) cada frame lleva también las que hizo
+// cada sección; si 'presupuestoAsignaciones' >= 0, un frame que lo pase (tras los primeros
+// FRAMES_ARRANQUE) para el programa con el desglose.
+
+enum class SeccionPerfil { Eventos, Jaque, Animacion, Dibujo, Presentar };
+const int NUM_SECCIONES = 5;
+
+inline const char* nombreSeccion(int s){
+    static const char* nombres[NUM_SECCIONES] = { "eventos", "jaque", "animacion", "dibujo", "presentar" };
+    return nombres[s];
+}
+
+const int HISTORIAL_FRAMES = 120;         // frames que se dibujan en la gráfica
+const float ESCALA_GRAFICA = 4.0f;        // px por milisegundo
+const float MS_OBJETIVO = 1000.0f / 60.0f;
+const int FRAMES_ARRANQUE = 3;            // frames sin presupuesto (primer dibujo, contexto de OpenGL)
+
+struct MuestraFrame {
+    double inicioUs = 0;                            // inicio del frame desde que arrancó el perfilador
+    float frameMs = 0;
+    float cpuMs = 0;                                // tiempo de CPU del proceso en el frame
+    float seccionMs[NUM_SECCIONES] = {};
+    double seccionInicioUs[NUM_SECCIONES] = {};     // primera entrada a la sección (para el trace)
+    unsigned movimientoLegal = 0;
+    unsigned dejaReyEnJaque = 0;
+    unsigned asignaciones = 0;                      // operator new propios en el frame
+    unsigned asignacionesSeccion[NUM_SECCIONES] = {};
+};
+
+struct Perfilador {
+    typedef std::chrono::steady_clock Reloj;
+
+    bool visible = false;
+    bool grabando = false;
+
+    Reloj::time_point origen = Reloj::now();
+    Reloj::time_point inicioFrame;
+    std::clock_t cpuInicioFrame = 0;
+    Reloj::time_point marca;
+    unsigned long marcaAsignaciones = 0;
+    int seccionActual = -1;
+    MuestraFrame actual;
+    long numFrame = 0;
+    long presupuestoAsignaciones = -1;    // por frame; -1 = sin límite
+
+    std::array<MuestraFrame, HISTORIAL_FRAMES> historial;
+    int cabeza = 0;       // siguiente posición a escribir
+    int llenos = 0;
+
+    std::vector<MuestraFrame> grabacion;
+
+    // percentiles del tiempo de frame, recalculados cada medio segundo
+    float p50 = 0, p95 = 0, p99 = 0, maximo = 0;
+    float ultimoResumen = 0;
+
+    sf::VertexArray barras{sf::Quads, (size_t)HISTORIAL_FRAMES * NUM_SECCIONES * 4};
+    sf::RectangleShape panel;
+    sf::RectangleShape lineaObjetivo;
+    std::string titulo;                   // el del resumen, con sitio reservado
+
+    Perfilador(){
+        panel.setFillColor(sf::Color(0,0,0,170));
+        lineaObjetivo.setFillColor(sf::Color(255,255,255,140));
+        titulo.reserve(512);
+    }
+
+    double microsDesdeOrigen(Reloj::time_point t) const {
+        return std::chrono::duration<double, std::micro>(t - origen).count();
+    }
+
+    void empezarFrame(){
+        inicioFrame = Reloj::now();
+        cpuInicioFrame = std::clock();
+        actual = MuestraFrame();
+        actual.inicioUs = microsDesdeOrigen(inicioFrame);
+        for (int s=0;s<NUM_SECCIONES;++s) actual.seccionInicioUs[s] = -1;
+        seccionActual = -1;
+        marcaAsignaciones = asignacionesPropias();
+    }
+
+    // Cierra la sección en curso (si hay) y abre 's'. Las fases del bucle se marcan en orden.
+    void seccion(int s){
+        Reloj::time_point ahora = Reloj::now();
+        unsigned long asignaciones = asignacionesPropias();
+        if (seccionActual >= 0){
+            if (actual.seccionInicioUs[seccionActual] < 0) actual.seccionInicioUs[seccionActual] = microsDesdeOrigen(marca);
+            actual.seccionMs[seccionActual] += std::chrono::duration<float, std::milli>(ahora - marca).count();
+            actual.asignacionesSeccion[seccionActual] += (unsigned)(asignaciones - marcaAsignaciones);
+            actual.asignaciones += (unsigned)(asignaciones - marcaAsignaciones);
+        }
+        seccionActual = s;
+        marca = ahora;
+        marcaAsignaciones = asignaciones;
+    }
+    void seccion(SeccionPerfil s){ seccion((int)s); }
+
+    void terminarFrame(){
+        seccion(-1);
+        actual.frameMs = std::chrono::duration<float, std::milli>(Reloj::now() - inicioFrame).count();
+        actual.cpuMs = (float)(std::clock() - cpuInicioFrame) * 1000.0f / CLOCKS_PER_SEC;
+        actual.movimientoLegal = perfContadores.movimientoLegal;
+        actual.dejaReyEnJaque = perfContadores.dejaReyEnJaque;
+        perfContadores = ContadoresPerfil();
+
+        historial[cabeza] = actual;
+        cabeza = (cabeza + 1) % HISTORIAL_FRAMES;
+        if (llenos < HISTORIAL_FRAMES) ++llenos;
+        if (grabando){
+            FueraDePresupuesto f;         // la grabación crece por su cuenta
+            grabacion.push_back(actual);
+        }
+        if (++numFrame > FRAMES_ARRANQUE && presupuestoAsignaciones >= 0 && (long)actual.asignaciones > presupuestoAsignaciones)
+            presupuestoSuperado();
+    }
+
+    // Un frame pidió más memoria de la permitida: desglose por secciones y abortar
+    void presupuestoSuperado() const {
+        std::fprintf(stderr, "Frame %ld: %u asignaciones (presupuesto %ld):", numFrame, actual.asignaciones, presupuestoAsignaciones);
+        for (int s=0;s<NUM_SECCIONES;++s) std::fprintf(stderr, " %s %u", nombreSeccion(s), actual.asignacionesSeccion[s]);
+        std::fprintf(stderr, "\n");
+        std::abort();
+    }
+
+    const MuestraFrame& muestra(int haceFrames) const {
+        return historial[(cabeza - 1 - haceFrames + 2*HISTORIAL_FRAMES) % HISTORIAL_FRAMES];
+    }
+
+    void calcularPercentiles(){
+        if (llenos == 0) return;
+        std::array<float, HISTORIAL_FRAMES> t;
+        for (int i=0;i<llenos;++i) t[i] = historial[i].frameMs;
+        auto percentil = [&](float q){
+            int k = std::min(llenos-1, (int)(q * (llenos-1) + 0.5f));
+            std::nth_element(t.begin(), t.begin()+k, t.begin()+llenos);
+            return t[k];
+        };
+        p50 = percentil(0.50f);
+        p95 = percentil(0.95f);
+        p99 = percentil(0.99f);
+        maximo = *std::max_element(t.begin(), t.begin()+llenos);
+    }
+
+    // Resumen numérico en el título de la ventana (no hay fuente en assets/)
+    void actualizarTitulo(sf::RenderWindow &window, const std::string &tituloBase){
+        float ahora = (float)(microsDesdeOrigen(Reloj::now()) / 1e6);
+        if (ahora - ultimoResumen < 0.5f) return;
+        ultimoResumen = ahora;
+        calcularPercentiles();
+
+        const MuestraFrame &m = muestra(0);
+        char buf[256], asig[32] = "";
+        if (CONTANDO_ASIGNACIONES) std::snprintf(asig, sizeof(asig), " asig %u", m.asignaciones);
+        std::snprintf(buf, sizeof(buf),
+            " | frame p50 %.2f p95 %.2f p99 %.2f max %.2f ms | ev %.2f jaque %.2f anim %.2f dib %.2f | movLegal %u dejaRey %u%s%s",
+            p50, p95, p99, maximo,
+            m.seccionMs[(int)SeccionPerfil::Eventos], m.seccionMs[(int)SeccionPerfil::Jaque],
+            m.seccionMs[(int)SeccionPerfil::Animacion], m.seccionMs[(int)SeccionPerfil::Dibujo],
+            m.movimientoLegal, m.dejaReyEnJaque, asig, grabando ? " | REC" : "");
+        titulo = tituloBase;
+        titulo += buf;
+        FueraDePresupuesto f;             // SFML pasa el título a sf::String
+        window.setTitle(titulo);
+    }
+
+    // ---------------------- Gráfica ----------------------
+    // Una barra apilada por frame (una franja por sección), más la línea de 16.6 ms.
+    void dibujar(sf::RenderTarget &window){
+        static const sf::Color colores[NUM_SECCIONES] = {
+            sf::Color(80,160,255), sf::Color(255,90,90), sf::Color(255,210,60),
+            sf::Color(90,220,120), sf::Color(120,120,120)
+        };
+        const float anchoBarra = 3.0f;
+        const float x0 = 10.f, yBase = 690.f;
+        const float alto = MS_OBJETIVO * 2.0f * ESCALA_GRAFICA;
+
+        panel.setSize(sf::Vector2f(HISTORIAL_FRAMES * anchoBarra, alto));
+        panel.setPosition(x0, yBase - alto);
+        window.draw(panel);
+
+        for (int i=0;i<HISTORIAL_FRAMES;++i){
+            float x = x0 + (HISTORIAL_FRAMES - 1 - i) * anchoBarra;
+            float y = yBase;
+            const MuestraFrame *m = (i < llenos) ? &muestra(i) : nullptr;
+            for (int s=0;s<NUM_SECCIONES;++s){
+                float h = m ? std::min(m->seccionMs[s] * ESCALA_GRAFICA, y - (yBase - alto)) : 0.f;
+                sf::Vertex *q = &barras[(i*NUM_SECCIONES + s) * 4];
+                q[0].position = sf::Vector2f(x, y);
+                q[1].position = sf::Vector2f(x + anchoBarra - 1.f, y);
+                q[2].position = sf::Vector2f(x + anchoBarra - 1.f, y - h);
+                q[3].position = sf::Vector2f(x, y - h);
+                for (int v=0;v<4;++v) q[v].color = colores[s];
+                y -= h;
+            }
+        }
+        window.draw(barras);
+
+        lineaObjetivo.setSize(sf::Vector2f(HISTORIAL_FRAMES * anchoBarra, 1.f));
+        lineaObjetivo.setPosition(x0, yBase - MS_OBJETIVO * ESCALA_GRAFICA);
+        window.draw(lineaObjetivo);
+    }
+
+    // ---------------------- Grabación ----------------------
+    void alternarGrabacion(){
+        FueraDePresupuesto f;
+        if (!grabando){
+            grabacion.clear();
+            grabacion.reserve(60 * 60);
+            grabando = true;
+        } else {
+            grabando = false;
+            volcar("perfil.csv", "perfil.json");
+        }
+    }
+
+    void volcar(const std::string &rutaCsv, const std::string &rutaJson) const {
+        std::ofstream csv(rutaCsv);
+        csv << "inicio_us,frame_ms,cpu_ms";
+        for (int s=0;s<NUM_SECCIONES;++s) csv << "," << nombreSeccion(s) << "_ms";
+        csv << ",movimientoLegal,dejaReyEnJaqueSimulado,asignaciones\n";
+        for (const MuestraFrame &m : grabacion){
+            csv << (long long)m.inicioUs << "," << m.frameMs << "," << m.cpuMs;
+            for (int s=0;s<NUM_SECCIONES;++s) csv << "," << m.seccionMs[s];
+            csv << "," << m.movimientoLegal << "," << m.dejaReyEnJaque << "," << m.asignaciones << "\n";
+        }
+
+        // Chrome trace: un evento "X" por frame y por sección, y un contador de llamadas
+        std::ofstream js(rutaJson);
+        js << "{\"traceEvents\":[\n";
+        bool primero = true;
+        auto coma = [&](){ if (!primero) js << ",\n"; primero = false; };
+        for (const MuestraFrame &m : grabacion){
+            coma();
+            js << "{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << (long long)m.inicioUs
+               << ",\"dur\":" << (long long)(m.frameMs * 1000.0f) << "}";
+            for (int s=0;s<NUM_SECCIONES;++s){
+                if (m.seccionInicioUs[s] < 0) continue;
+                coma();
+                js << "{\"name\":\"" << nombreSeccion(s) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+                   << (long long)m.seccionInicioUs[s] << ",\"dur\":" << (long long)(m.seccionMs[s] * 1000.0f) << "}";
+            }
+            coma();
+            js << "{\"name\":\"llamadas\",\"ph\":\"C\",\"pid\":1,\"ts\":" << (long long)m.inicioUs
+               << ",\"args\":{\"movimientoLegal\":" << m.movimientoLegal
+               << ",\"dejaReyEnJaqueSimulado\":" << m.dejaReyEnJaque << "}}";
+        }
+        js << "\n]}\n";
+        std::cout << "Perfil guardado en " << rutaCsv << " y " << rutaJson
+                  << " (" << grabacion.size() << " frames)\n";
+    }
+
+    // Percentiles de tiempo y CPU por frame y media de cada sección, de toda la grabación
+    void resumen(std::ostream &out, double segundos) const {
+        size_t n = grabacion.size();
+        if (n == 0){ out << "sin frames\n"; return; }
+        std::vector<float> t(n), cpu(n);
+        double mediaSeccion[NUM_SECCIONES] = {};
+        for (size_t i=0;i<n;++i){
+            t[i] = grabacion[i].frameMs;
+            cpu[i] = grabacion[i].cpuMs;
+            for (int s=0;s<NUM_SECCIONES;++s) mediaSeccion[s] += grabacion[i].seccionMs[s] / n;
+        }
+        std::sort(t.begin(), t.end());
+        std::sort(cpu.begin(), cpu.end());
+        auto p = [&](const std::vector<float> &v, double q){ return v[std::min(n-1, (size_t)(q * (n-1) + 0.5))]; };
+        char buf[320];
+        std::snprintf(buf, sizeof(buf),
+            "%zu frames en %.3f s (%.0f frames/s)\nframe ms: p50 %.3f p95 %.3f p99 %.3f max %.3f\ncpu ms:   p50 %.3f p95 %.3f p99 %.3f max %.3f\n",
+            n, segundos, n / segundos, p(t,0.50), p(t,0.95), p(t,0.99), t[n-1], p(cpu,0.50), p(cpu,0.95), p(cpu,0.99), cpu[n-1]);
+        out << buf << "media por frame:";
+        for (int s=0;s<NUM_SECCIONES;++s){
+            std::snprintf(buf, sizeof(buf), " %s %.3f", nombreSeccion(s), mediaSeccion[s]);
+            out << buf;
+        }
+        out << " ms\n";
+        if (CONTANDO_ASIGNACIONES){
+            unsigned long total = 0;
+            unsigned maximoFrame = 0;
+            for (size_t i=FRAMES_ARRANQUE;i<n;++i){
+                total += grabacion[i].asignaciones;
+                maximoFrame = std::max(maximoFrame, grabacion[i].asignaciones);
+            }
+            out << "asignaciones tras el arranque: " << total << " (máximo " << maximoFrame << " en un frame)\n";
+        }
+    }
+};
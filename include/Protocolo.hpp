@@ -0,0 +1,344 @@
+#pragma once
+#include "Reglas.hpp"
+#include "Tablas.hpp"
+#include <string>
+#include <cstring>
+#include <cctype>
+#include <cstdlib>
+
+// ---------------------- Protocolo de red ----------------------
+// Texto, una orden por línea ("\n"). El servidor empareja las conexiones de dos en dos:
+//   servidor -> cliente   PARTIDA <id> BLANCAS|NEGRAS     empieza la partida
+//                         JUGADA <jugada>                 jugada del rival
+//                         OK                              tu jugada es legal y ya está aplicada
+//                         ILEGAL <jugada>                 tu jugada se ha rechazado (la posición no cambia)
+//                         FIN <motivo>                    MATE_BLANCAS, MATE_NEGRAS, AHOGADO, TABLAS_REPETICION,
+//                                                         TABLAS_50, TABLAS_MATERIAL, ABANDONO
+//   cliente -> servidor   JUGADA <jugada>
+// Una jugada es origen y destino ("e2e4"), la pieza de promoción opcional (d, t, a, c) y la
+// casilla protegida con la guardia opcional tras '*' ("e2e4*e2", "b7b8d").
+
+const int PUERTO_POR_DEFECTO = 5555;
+const size_t MAX_LINEA = 64;          // líneas más largas cierran la conexión
+
+// fila 0 es la octava (las negras empiezan arriba)
+inline string casillaATexto(int idx){
+    string s = "a1";
+    s[0] = (char)('a' + idx % COLS);
+    s[1] = (char)('0' + (FILAS - idx / COLS));
+    return s;
+}
+
+inline int textoACasilla(const char* t){
+    if (t[0] < 'a' || t[0] > 'h' || t[1] < '1' || t[1] > '8') return -1;
+    return indiceCasilla(FILAS - (t[1] - '0'), t[0] - 'a');
+}
+
+inline char letraPromocion(uint8_t promocion){
+    switch(promocion){
+        case 1 + (int)TipoPieza::Queen:  return 'd';
+        case 1 + (int)TipoPieza::Rook:   return 't';
+        case 1 + (int)TipoPieza::Bishop: return 'a';
+        case 1 + (int)TipoPieza::Knight: return 'c';
+    }
+    return 0;
+}
+
+inline string jugadaATexto(const Jugada& j){
+    string s = casillaATexto(j.origen) + casillaATexto(j.destino);
+    if (char l = letraPromocion(j.promocion)) s += l;
+    if (j.guardia != SIN_CASILLA) s += "*" + casillaATexto(j.guardia);
+    return s;
+}
+
+inline bool textoAJugada(const string& s, Jugada& j){
+    j = Jugada();
+    if (s.size() < 4) return false;
+    int o = textoACasilla(s.c_str()), d = textoACasilla(s.c_str() + 2);
+    if (o < 0 || d < 0) return false;
+    j.origen = (uint8_t)o;
+    j.destino = (uint8_t)d;
+    size_t k = 4;
+    if (k < s.size() && s[k] != '*'){
+        switch(s[k]){
+            case 'd': j.promocion = 1 + (int)TipoPieza::Queen; break;
+            case 't': j.promocion = 1 + (int)TipoPieza::Rook; break;
+            case 'a': j.promocion = 1 + (int)TipoPieza::Bishop; break;
+            case 'c': j.promocion = 1 + (int)TipoPieza::Knight; break;
+            default: return false;
+        }
+        ++k;
+    }
+    if (k < s.size()){
+        if (s[k] != '*' || s.size() != k + 3) return false;
+        int g = textoACasilla(s.c_str() + k + 1);
+        if (g < 0) return false;
+        j.guardia = (uint8_t)g;
+    }
+    return true;
+}
+
+// ---------------------- Partida aparte ----------------------
+// Estado completo de una partida (servidor, clientes de red, herramientas)
+struct EstadoPartida {
+    vector<Pieza> piezas;
+    Tablero tablero;
+    ReglasFlags flagsBlanco, flagsNegro;
+    ColorPieza turno = ColorPieza::White;
+    int jugadas = 0;
+    SeguimientoTablas tablas;
+
+    void iniciar(){
+        colocarPosicionInicial(piezas, tablero);
+        flagsBlanco = ReglasFlags();
+        flagsNegro = ReglasFlags();
+        turno = ColorPieza::White;
+        jugadas = 0;
+        tablas.iniciar(piezas, tablero, flagsBlanco, flagsNegro, turno);
+    }
+
+    // ¿Es legal la jugada del bando al que le toca? Reglas de la pieza y no dejar al rey en jaque
+    // (destinoLegal), la guardia y la pieza de promoción (sin elegir vale: será dama). Es lo que
+    // comprueba validarLote (Lote.hpp) para muchas jugadas a la vez.
+    template <class Variante = ReglasAlmate>
+    bool esValida(const Jugada &j) const {
+        if (j.origen >= FILAS*COLS || j.destino >= FILAS*COLS) return false;
+        int oF = j.origen / COLS, oC = j.origen % COLS;
+        int dF = j.destino / COLS, dC = j.destino % COLS;
+        int idx = tablero[oF][oC];
+        if (idx == -1 || piezas[idx].color != turno) return false;
+        if (!destinoLegal<Variante>(piezas, tablero, idx, dF, dC, flagsBlanco, flagsNegro)) return false;
+
+        // Regla 1: la guardia es sobre una pieza propia y una vez por partida
+        if (j.guardia != SIN_CASILLA){
+            if (!Variante::guardia || j.guardia >= FILAS*COLS) return false;
+            const ReglasFlags &propios = (turno==ColorPieza::White)? flagsBlanco : flagsNegro;
+            int g = tablero[j.guardia / COLS][j.guardia % COLS];
+            if (propios.guardiaUsado || g == -1 || piezas[g].color != turno) return false;
+        }
+
+        // Regla 3: promoción
+        bool ultima = (turno==ColorPieza::White)? (dF==0) : (dF==FILAS-1);
+        if (piezas[idx].tipo == TipoPieza::Pawn && ultima){
+            if (j.promocion == 0) return true;
+            if (j.promocion < 1 + (int)TipoPieza::Rook || j.promocion > 1 + (int)TipoPieza::Queen) return false;
+        } else if (j.promocion != 0){
+            return false;
+        }
+        return true;
+    }
+
+    // Valida la jugada del bando al que le toca y, si es legal, la aplica. Sin pieza de
+    // promoción elegida se promociona a dama (y queda anotado en 'j'). En 'efecto', las piezas
+    // que cambiaron (para animarlas).
+    bool jugar(Jugada &j, EfectoJugada *efecto = nullptr){
+        if (!esValida(j)) return false;
+        if (j.promocion == 0 && piezas[tablero[j.origen / COLS][j.origen % COLS]].tipo == TipoPieza::Pawn){
+            int dF = j.destino / COLS;
+            if (dF == ((turno==ColorPieza::White)? 0 : FILAS-1)) j.promocion = 1 + (int)TipoPieza::Queen;
+        }
+
+        EfectoJugada ef = aplicar(j);
+        if (efecto) *efecto = ef;
+        return true;
+    }
+
+    // Aplica una jugada ya validada (la de otro que ya la comprobó: difusión, partidas guardadas)
+    EfectoJugada aplicar(const Jugada &j){
+        RegistroDeshacer reg;
+        EfectoJugada ef = aplicarJugada(piezas, tablero, j, flagsBlanco, flagsNegro, turno, &reg);
+        tablas.registrar(piezas, tablero, j, reg, flagsBlanco, flagsNegro, turno);
+        jugadas++;
+        return ef;
+    }
+
+    // Movimientos legales del bando al que le toca (y jaque / mate)
+    void movimientos(MovimientosTurno &mt){
+        calcularMovimientosTurno(mt, piezas, tablero, turno, flagsBlanco, flagsNegro);
+    }
+
+    // Mate, ahogado, tablas o EnJuego; 'mt' son los movimientos de la posición actual
+    ResultadoPartida resultado(const MovimientosTurno &mt) const {
+        return tablas.resultado(mt, turno);
+    }
+};
+
+// ---------------------- Posiciones en texto ----------------------
+// FEN ("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1") con un séptimo campo
+// opcional para lo que solo tiene Almate: G/g guardia ya usada por blancas/negras, X/x enroque
+// extendido ya usado, y *<casilla> la pieza protegida con la guardia durante este turno (es del
+// bando que no mueve) ("-" o ausente: nada).
+// Los derechos de enroque (K, Q, k, q) valen también para el enroque extendido de ese lado.
+
+inline char letraPieza(TipoPieza tipo, ColorPieza color){
+    static const char LETRAS[6] = { 'p', 'r', 'n', 'b', 'q', 'k' };
+    char l = LETRAS[(int)tipo];
+    return (color == ColorPieza::White) ? (char)(l - 'a' + 'A') : l;
+}
+
+inline string posicionATexto(const EstadoPartida &e){
+    string s;
+    for (int f=0; f<FILAS; ++f){
+        int vacias = 0;
+        for (int c=0; c<COLS; ++c){
+            int i = e.tablero[f][c];
+            if (i == -1){ vacias++; continue; }
+            if (vacias){ s += (char)('0' + vacias); vacias = 0; }
+            s += letraPieza(e.piezas[i].tipo, e.piezas[i].color);
+        }
+        if (vacias) s += (char)('0' + vacias);
+        if (f < FILAS-1) s += '/';
+    }
+    s += (e.turno == ColorPieza::White) ? " w " : " b ";
+
+    auto sinMover = [&](int f, int c, TipoPieza tipo, ColorPieza color){
+        int i = e.tablero[f][c];
+        return i != -1 && e.piezas[i].tipo == tipo && e.piezas[i].color == color && !e.piezas[i].hasMoved;
+    };
+    string enroques;
+    if (sinMover(FILAS-1, 4, TipoPieza::King, ColorPieza::White)){
+        if (sinMover(FILAS-1, 7, TipoPieza::Rook, ColorPieza::White)) enroques += 'K';
+        if (sinMover(FILAS-1, 0, TipoPieza::Rook, ColorPieza::White)) enroques += 'Q';
+    }
+    if (sinMover(0, 4, TipoPieza::King, ColorPieza::Black)){
+        if (sinMover(0, 7, TipoPieza::Rook, ColorPieza::Black)) enroques += 'k';
+        if (sinMover(0, 0, TipoPieza::Rook, ColorPieza::Black)) enroques += 'q';
+    }
+    s += enroques.empty() ? "-" : enroques;
+
+    const ReglasFlags &rival = (e.turno == ColorPieza::White) ? e.flagsNegro : e.flagsBlanco;
+    s += " " + (rival.alPaso >= 0 ? casillaATexto(rival.alPaso) : string("-"));
+    s += " " + to_string(e.tablas.relojCincuenta()) + " " + to_string(e.jugadas / 2 + 1);
+
+    string almate;
+    if (e.flagsBlanco.guardiaUsado) almate += 'G';
+    if (e.flagsNegro.guardiaUsado) almate += 'g';
+    if (e.flagsBlanco.enroque3Usado) almate += 'X';
+    if (e.flagsNegro.enroque3Usado) almate += 'x';
+    const ReglasFlags &protector = (e.turno == ColorPieza::White) ? e.flagsNegro : e.flagsBlanco;
+    if (protector.proteccionActiva && protector.guardiaIdx >= 0 && e.piezas[protector.guardiaIdx].alive){
+        const Pieza &g = e.piezas[protector.guardiaIdx];
+        almate += "*" + casillaATexto(indiceCasilla(g.fila, g.col));
+    }
+    if (!almate.empty()) s += " " + almate;
+    return s;
+}
+
+// Deja en 'e' la posición escrita en 'texto'; si no es válida devuelve false y el motivo en 'error'
+inline bool textoAPosicion(const string &texto, EstadoPartida &e, string &error){
+    string campos[7] = { "", "", "-", "-", "0", "1", "-" };
+    int n = 0;
+    for (size_t k = 0; k < texto.size() && n <= 7; ){
+        while (k < texto.size() && (texto[k] == ' ' || texto[k] == '\t' || texto[k] == '\r')) ++k;
+        if (k >= texto.size()) break;
+        size_t fin = k;
+        while (fin < texto.size() && texto[fin] != ' ' && texto[fin] != '\t' && texto[fin] != '\r') ++fin;
+        if (n == 7){ error = "sobran campos"; return false; }
+        campos[n++] = texto.substr(k, fin - k);
+        k = fin;
+    }
+    if (n < 2){ error = "faltan el tablero o el turno"; return false; }
+
+    e.piezas.clear();
+    e.tablero.vaciar();
+    e.flagsBlanco = ReglasFlags();
+    e.flagsNegro = ReglasFlags();
+
+    // tablero: de la octava fila a la primera
+    int f = 0, c = 0, reyes[2] = { 0, 0 }, porBando[2] = { 0, 0 };
+    for (char ch : campos[0]){
+        if (ch == '/'){
+            if (c != COLS || ++f >= FILAS){ error = "tablero mal formado"; return false; }
+            c = 0;
+            continue;
+        }
+        if (ch >= '1' && ch <= '8'){ c += ch - '0'; if (c > COLS){ error = "fila demasiado larga"; return false; } continue; }
+        const char *LETRAS = "prnbqk";
+        const char *l = strchr(LETRAS, tolower((unsigned char)ch));
+        if (!l || c >= COLS){ error = "pieza no válida"; return false; }
+        Pieza p;
+        p.tipo = (TipoPieza)(l - LETRAS);
+        p.color = isupper((unsigned char)ch) ? ColorPieza::White : ColorPieza::Black;
+        p.fila = (int8_t)f;
+        p.col = (int8_t)c;
+        if (p.tipo == TipoPieza::Pawn && (f == 0 || f == FILAS-1)){ error = "peón en la primera u octava fila"; return false; }
+        bool inicioPeon = (p.color == ColorPieza::White) ? (f == FILAS-2) : (f == 1);
+        p.hasMoved = !(p.tipo == TipoPieza::Pawn && inicioPeon);     // torres y rey: según los enroques
+        if (p.tipo == TipoPieza::King) reyes[(int)p.color]++;
+        if (++porBando[(int)p.color] > 16){ error = "más de 16 piezas de un bando"; return false; }
+        e.tablero[f][c] = (int)e.piezas.size();
+        e.piezas.push_back(p);
+        c++;
+    }
+    if (f != FILAS-1 || c != COLS){ error = "tablero incompleto"; return false; }
+    if (reyes[0] != 1 || reyes[1] != 1){ error = "cada bando necesita exactamente un rey"; return false; }
+
+    if (campos[1] == "w") e.turno = ColorPieza::White;
+    else if (campos[1] == "b") e.turno = ColorPieza::Black;
+    else { error = "turno no válido"; return false; }
+
+    // enroques: el rey y la torre de ese lado no se han movido
+    if (campos[2] != "-"){
+        for (char ch : campos[2]){
+            ColorPieza color = isupper((unsigned char)ch) ? ColorPieza::White : ColorPieza::Black;
+            int fila = (color == ColorPieza::White) ? FILAS-1 : 0;
+            char l = (char)tolower((unsigned char)ch);
+            if (l != 'k' && l != 'q'){ error = "enroque no válido"; return false; }
+            int rey = e.tablero[fila][4], torre = e.tablero[fila][(l == 'k') ? 7 : 0];
+            if (rey == -1 || e.piezas[rey].tipo != TipoPieza::King || e.piezas[rey].color != color ||
+                torre == -1 || e.piezas[torre].tipo != TipoPieza::Rook || e.piezas[torre].color != color){
+                error = "enroque sin rey o torre en su casilla";
+                return false;
+            }
+            e.piezas[rey].hasMoved = false;
+            e.piezas[torre].hasMoved = false;
+        }
+    }
+
+    // al paso: lo abrió el bando que acaba de mover
+    if (campos[3] != "-"){
+        int casilla = (campos[3].size() == 2) ? textoACasilla(campos[3].c_str()) : -1;
+        int filaEsperada = (e.turno == ColorPieza::White) ? 2 : FILAS-3;
+        if (casilla < 0 || casilla / COLS != filaEsperada){ error = "casilla al paso no válida"; return false; }
+        ReglasFlags &rival = (e.turno == ColorPieza::White) ? e.flagsNegro : e.flagsBlanco;
+        rival.alPaso = casilla;
+    }
+
+    char *fin = nullptr;
+    long reloj50 = strtol(campos[4].c_str(), &fin, 10);
+    if (*fin || reloj50 < 0 || reloj50 > 1000){ error = "contador de medias jugadas no válido"; return false; }
+    long numero = strtol(campos[5].c_str(), &fin, 10);
+    if (*fin || numero < 1 || numero > 100000){ error = "número de jugada no válido"; return false; }
+    e.jugadas = (int)(2 * (numero - 1) + (e.turno == ColorPieza::Black ? 1 : 0));
+
+    if (campos[6] != "-"){
+        const string &a = campos[6];
+        for (size_t k = 0; k < a.size(); ++k){
+            switch (a[k]){
+                case 'G': e.flagsBlanco.guardiaUsado = true; break;
+                case 'g': e.flagsNegro.guardiaUsado = true; break;
+                case 'X': e.flagsBlanco.enroque3Usado = true; break;
+                case 'x': e.flagsNegro.enroque3Usado = true; break;
+                case '*': {
+                    int casilla = (k + 2 < a.size()) ? textoACasilla(a.c_str() + k + 1) : -1;
+                    int g = (casilla >= 0) ? e.tablero[casilla / COLS][casilla % COLS] : -1;
+                    if (g == -1 || e.piezas[g].color == e.turno){ error = "pieza protegida no válida"; return false; }
+                    ReglasFlags &protector = (e.turno == ColorPieza::White) ? e.flagsNegro : e.flagsBlanco;
+                    protector.guardiaUsado = true;
+                    protector.guardiaIdx = g;
+                    protector.proteccionActiva = true;
+                    protector.proteccionTurnoDe = e.piezas[g].color;
+                    e.piezas[g].protegido = true;
+                    k += 2;
+                    break;
+                }
+                default: error = "campo de Almate no válido"; return false;
+            }
+        }
+    }
+
+    ColorPieza rival = (e.turno == ColorPieza::White) ? ColorPieza::Black : ColorPieza::White;
+    if (estaEnJaque(e.piezas, e.tablero, rival)){ error = "el bando que no mueve está en jaque"; return false; }
+    e.tablas.iniciar(e.piezas, e.tablero, e.flagsBlanco, e.flagsNegro, e.turno, (int)reloj50);
+    return true;
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include <SFML/Network.hpp>
+#include <atomic>
+#include <thread>
+#include <array>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include "Protocolo.hpp"
+
+// ---------------------- Partida en red (cliente) ----------------------
+// El socket vive en su propio hilo. El bucle de dibujo solo mete jugadas en una cola y saca
+// mensajes de otra, ninguna de las dos bloquea, así que una conexión lenta nunca frena un frame.
+
+// Cola de tamaño fijo para un productor y un consumidor, sin cerrojos ni reservas de memoria
+template <typename T, size_t N>
+class ColaSPSC {
+public:
+    bool meter(const T &v){
+        size_t c = cola.load(std::memory_order_relaxed);
+        size_t sig = (c + 1) % N;
+        if (sig == cabeza.load(std::memory_order_acquire)) return false;   // llena
+        datos[c] = v;
+        cola.store(sig, std::memory_order_release);
+        return true;
+    }
+
+    bool sacar(T &v){
+        size_t h = cabeza.load(std::memory_order_relaxed);
+        if (h == cola.load(std::memory_order_acquire)) return false;       // vacía
+        v = datos[h];
+        cabeza.store((h + 1) % N, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, N> datos;
+    std::atomic<size_t> cabeza{0};   // siguiente a leer (consumidor)
+    std::atomic<size_t> cola{0};     // siguiente a escribir (productor)
+};
+
+enum class TipoMensajeRed { Partida, Jugada, Ok, Ilegal, Fin, Desconectado };
+
+struct MensajeRed {
+    TipoMensajeRed tipo = TipoMensajeRed::Desconectado;
+    Jugada jugada;                   // Jugada / Ilegal
+    int lado = -1;                   // Partida: 0 = blancas, 1 = negras
+    char motivo[24] = {};            // Fin
+};
+
+const int CAPACIDAD_COLA_RED = 64;
+
+class ClienteRed {
+public:
+    ClienteRed(const std::string &host, unsigned short puerto) : host(host), puerto(puerto) {
+        hilo = std::thread([this]{ bucle(); });
+    }
+
+    ~ClienteRed(){
+        terminar = true;
+        hilo.join();
+    }
+
+    ClienteRed(const ClienteRed&) = delete;
+    ClienteRed& operator=(const ClienteRed&) = delete;
+
+    // Desde el bucle de dibujo
+    bool enviarJugada(const Jugada &j){ return salida.meter(j); }
+    bool recibir(MensajeRed &m){ return entrada.sacar(m); }
+
+private:
+    std::string host;
+    unsigned short puerto;
+    std::thread hilo;
+    std::atomic<bool> terminar{false};
+    ColaSPSC<Jugada, CAPACIDAD_COLA_RED> salida;
+    ColaSPSC<MensajeRed, CAPACIDAD_COLA_RED> entrada;
+
+    // Si el bucle de dibujo va atrasado se espera aquí, nunca allí
+    void avisar(const MensajeRed &m){
+        while (!entrada.meter(m) && !terminar) sf::sleep(sf::milliseconds(1));
+    }
+
+    void desconectado(){
+        MensajeRed m;
+        m.tipo = TipoMensajeRed::Desconectado;
+        avisar(m);
+    }
+
+    void interpretar(const std::string &linea){
+        MensajeRed m;
+        if (linea.compare(0, 8, "PARTIDA ") == 0){
+            m.tipo = TipoMensajeRed::Partida;
+            m.lado = (linea.find("BLANCAS") != std::string::npos) ? 0 : 1;
+        } else if (linea.compare(0, 7, "JUGADA ") == 0){
+            m.tipo = TipoMensajeRed::Jugada;
+            if (!textoAJugada(linea.substr(7), m.jugada)) return;
+        } else if (linea == "OK"){
+            m.tipo = TipoMensajeRed::Ok;
+        } else if (linea.compare(0, 7, "ILEGAL ") == 0){
+            m.tipo = TipoMensajeRed::Ilegal;
+            textoAJugada(linea.substr(7), m.jugada);
+        } else if (linea.compare(0, 4, "FIN ") == 0){
+            m.tipo = TipoMensajeRed::Fin;
+            std::strncpy(m.motivo, linea.c_str() + 4, sizeof(m.motivo) - 1);
+        } else {
+            return;
+        }
+        avisar(m);
+    }
+
+    void bucle(){
+        sf::TcpSocket socket;
+        if (socket.connect(sf::IpAddress(host), puerto, sf::seconds(5)) != sf::Socket::Done){
+            desconectado();
+            return;
+        }
+        sf::SocketSelector selector;
+        selector.add(socket);
+        std::string linea;
+        char buf[512];
+
+        while (!terminar){
+            Jugada j;
+            while (salida.sacar(j)){
+                std::string txt = "JUGADA " + jugadaATexto(j) + "\n";
+                if (socket.send(txt.data(), txt.size()) != sf::Socket::Done){
+                    desconectado();
+                    return;
+                }
+            }
+
+            // espera corta: las jugadas propias no tardan más de 2 ms en salir
+            if (!selector.wait(sf::milliseconds(2))) continue;
+            std::size_t n = 0;
+            if (socket.receive(buf, sizeof(buf), n) != sf::Socket::Done){
+                desconectado();
+                return;
+            }
+            for (std::size_t i=0; i<n; ++i){
+                if (buf[i] == '\n'){
+                    if (!linea.empty() && linea.back() == '\r') linea.pop_back();
+                    interpretar(linea);
+                    linea.clear();
+                } else if (linea.size() < MAX_LINEA){
+                    linea += buf[i];
+                }
+            }
+        }
+    }
+};
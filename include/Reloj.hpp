@@ -0,0 +1,226 @@
+#pragma once
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include <string>
+#include <cstdlib>
+
+// ---------------------- Reloj de ajedrez ----------------------
+// Un reloj por bando medido con steady_clock (no depende de los FPS ni de cuándo se redibuja).
+// Un hilo vigilante duerme hasta el instante exacto en que cae la bandera del bando activo,
+// así la caída se detecta al milisegundo aunque la ventana no esté pintando.
+// Lados: 0 = blancas, 1 = negras (mismo orden que ColorPieza).
+
+enum class ModoReloj {
+    Incremento,   // Fischer: se suma 'extra' tras cada jugada
+    Retardo,      // retardo simple: el reloj no baja durante los primeros 'extra' de cada turno
+    Bronstein     // se devuelve lo gastado en la jugada, como mucho 'extra'
+};
+
+struct ConfigReloj {
+    int64_t inicialMs = 10 * 60 * 1000;
+    int64_t extraMs = 5 * 1000;
+    ModoReloj modo = ModoReloj::Incremento;
+};
+
+// Lee "minutos+segundos" con sufijo opcional i (incremento), d (retardo) o b (Bronstein), p.ej. "5+3", "3+2d"
+inline bool leerConfigReloj(const std::string &txt, ConfigReloj &cfg){
+    size_t mas = txt.find('+');
+    if (mas == std::string::npos) return false;
+    double minutos = std::atof(txt.substr(0, mas).c_str());
+    std::string resto = txt.substr(mas + 1);
+    if (minutos <= 0 || resto.empty()) return false;
+    char sufijo = resto.back();
+    if (sufijo == 'i' || sufijo == 'd' || sufijo == 'b') resto.pop_back();
+    else sufijo = 'i';
+    cfg.inicialMs = (int64_t)(minutos * 60.0 * 1000.0);
+    cfg.extraMs = (int64_t)(std::atof(resto.c_str()) * 1000.0);
+    cfg.modo = (sufijo == 'd') ? ModoReloj::Retardo : (sufijo == 'b') ? ModoReloj::Bronstein : ModoReloj::Incremento;
+    return true;
+}
+
+class RelojAjedrez {
+public:
+    typedef std::chrono::steady_clock Reloj;
+    typedef std::chrono::microseconds Us;
+
+    explicit RelojAjedrez(const ConfigReloj &c) : cfg(c) {
+        restanteUs[0] = restanteUs[1] = cfg.inicialMs * 1000;
+        vigilante = std::thread([this]{ vigilar(); });
+    }
+
+    ~RelojAjedrez(){
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            terminar = true;
+        }
+        cv.notify_all();
+        vigilante.join();
+    }
+
+    RelojAjedrez(const RelojAjedrez&) = delete;
+    RelojAjedrez& operator=(const RelojAjedrez&) = delete;
+
+    // Se llama desde otro hilo (el vigilante) en el momento de la caída
+    void alCaerBandera(std::function<void(int)> f){
+        std::lock_guard<std::mutex> lk(mtx);
+        callback = std::move(f);
+    }
+
+    // 'lado' acaba de jugar: cobra su tiempo, aplica la bonificación y arranca el del rival.
+    // La primera pulsación pone el reloj en marcha.
+    void pulsar(int lado){
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            if (bandera != -1) return;
+            Reloj::time_point ahora = Reloj::now();
+            if (corriendo && activo == lado){
+                int64_t transcurrido = std::chrono::duration_cast<Us>(ahora - inicioTurno).count();
+                restanteUs[lado] -= consumo(transcurrido);
+                if (cfg.modo == ModoReloj::Incremento) restanteUs[lado] += cfg.extraMs * 1000;
+                if (cfg.modo == ModoReloj::Bronstein) restanteUs[lado] += std::min(transcurrido, cfg.extraMs * 1000);
+            }
+            activo = 1 - lado;
+            inicioTurno = ahora;
+            corriendo = !pausado;
+        }
+        cv.notify_all();
+    }
+
+    // Cambia el bando que corre sin bonificaciones (al deshacer/rehacer)
+    void activar(int lado){
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            if (bandera != -1 || activo == -1 || activo == lado) return;
+            cobrar(Reloj::now());
+            activo = lado;
+        }
+        cv.notify_all();
+    }
+
+    void pausar(){
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            pausado = true;
+            if (!corriendo) return;
+            cobrar(Reloj::now());
+            corriendo = false;
+        }
+        cv.notify_all();
+    }
+
+    void reanudar(){
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            pausado = false;
+            if (corriendo || activo == -1 || bandera != -1) return;
+            inicioTurno = Reloj::now();
+            corriendo = true;
+        }
+        cv.notify_all();
+    }
+
+    // Detiene el reloj definitivamente (fin de partida)
+    void detener(){
+        pausar();
+    }
+
+    // Vuelve a poner los tiempos de una partida reanudada (diario). El reloj queda parado hasta
+    // la siguiente jugada, así el tiempo que el juego estuvo cerrado no se cobra a nadie.
+    void restaurar(int64_t msBlancas, int64_t msNegras){
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            if (bandera != -1) return;
+            restanteUs[0] = msBlancas * 1000;
+            restanteUs[1] = msNegras * 1000;
+            activo = -1;
+            corriendo = false;
+        }
+        cv.notify_all();
+    }
+
+    int64_t restanteMs(int lado) const {
+        std::lock_guard<std::mutex> lk(mtx);
+        int64_t r = restanteUs[lado];
+        if (corriendo && activo == lado){
+            int64_t transcurrido = std::chrono::duration_cast<Us>(Reloj::now() - inicioTurno).count();
+            r -= consumo(transcurrido);
+        }
+        return r > 0 ? r / 1000 : 0;
+    }
+
+    int ladoActivo() const { std::lock_guard<std::mutex> lk(mtx); return corriendo ? activo : -1; }
+
+    // -1 mientras nadie se haya quedado sin tiempo
+    int banderaCaida() const { return bandera.load(); }
+
+    // Retraso entre el instante teórico de caída y su detección (para comprobar la precisión)
+    int64_t retrasoDeteccionUs() const { std::lock_guard<std::mutex> lk(mtx); return retrasoUs; }
+
+private:
+    ConfigReloj cfg;
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::thread vigilante;
+    std::function<void(int)> callback;
+
+    int64_t restanteUs[2];
+    int activo = -1;
+    bool corriendo = false;
+    bool pausado = false;
+    bool terminar = false;
+    Reloj::time_point inicioTurno;
+    std::atomic<int> bandera{-1};
+    int64_t retrasoUs = 0;
+
+    // tiempo que realmente se descuenta tras 'transcurrido' µs de turno
+    int64_t consumo(int64_t transcurrido) const {
+        if (cfg.modo == ModoReloj::Retardo){
+            int64_t r = transcurrido - cfg.extraMs * 1000;
+            return r > 0 ? r : 0;
+        }
+        return transcurrido;
+    }
+
+    // pasa lo consumido en el turno en curso a restanteUs (con mtx tomado)
+    void cobrar(Reloj::time_point ahora){
+        if (!corriendo || activo == -1) return;
+        int64_t transcurrido = std::chrono::duration_cast<Us>(ahora - inicioTurno).count();
+        restanteUs[activo] -= consumo(transcurrido);
+        inicioTurno = ahora;
+    }
+
+    void vigilar(){
+        std::unique_lock<std::mutex> lk(mtx);
+        while (!terminar){
+            if (!corriendo || bandera != -1){
+                cv.wait(lk);
+                continue;
+            }
+            int64_t margen = restanteUs[activo];
+            if (cfg.modo == ModoReloj::Retardo) margen += cfg.extraMs * 1000;
+            Reloj::time_point limite = inicioTurno + Us(margen);
+            if (Reloj::now() < limite){
+                cv.wait_until(lk, limite);
+                continue;   // volver a evaluar: puede haber cambiado el turno
+            }
+            // bandera
+            Reloj::time_point ahora = Reloj::now();
+            retrasoUs = std::chrono::duration_cast<Us>(ahora - limite).count();
+            int lado = activo;
+            restanteUs[lado] = 0;
+            corriendo = false;
+            bandera = lado;
+            if (callback){
+                std::function<void(int)> f = callback;
+                lk.unlock();
+                f(lado);
+                lk.lock();
+            }
+        }
+    }
+};
@@ -0,0 +1,175 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdint>
+
+// ---------------------- Sesiones grabadas ----------------------
+// Graba los eventos que llegan al bucle principal (ratón y teclado) junto con la duración de cada
+// frame, y los vuelve a dar en el mismo orden y en el mismo frame para repetir la sesión sin nadie
+// delante: la partida, los arrastres, la guardia, la promoción y las animaciones salen iguales.
+//
+// Formato de texto, una línea por frame: "<dt en us> <evento> <evento> ..." con
+//   C                 ventana cerrada
+//   K<tecla>:<mods>   tecla pulsada (sf::Keyboard::Key; mods: 1 ctrl, 2 alt, 4 mayús, 8 sistema)
+//   k<tecla>:<mods>   tecla soltada
+//   B<botón>:<x>:<y>  botón del ratón pulsado (sf::Mouse::Button, píxeles de la ventana)
+//   b<botón>:<x>:<y>  botón soltado
+//   M<x>:<y>          ratón movido
+// Las líneas que empiezan por '#' son comentarios. F4 (grabar el perfil) no se graba: al repetir,
+// el perfil lo lleva la propia repetición.
+
+class GrabadorSesion {
+public:
+    bool abrir(const std::string &ruta){
+        out.open(ruta);
+        if (!out) return false;
+        out << "# sesion Almate: <dt_us> <eventos>\n";
+        return true;
+    }
+
+    bool activo() const { return out.is_open(); }
+
+    void evento(const sf::Event &ev){
+        char buf[48];
+        switch (ev.type){
+            case sf::Event::Closed:
+                linea += " C";
+                return;
+            case sf::Event::KeyPressed:
+            case sf::Event::KeyReleased:
+                if (ev.key.code == sf::Keyboard::F4) return;
+                std::snprintf(buf, sizeof(buf), " %c%d:%d", ev.type == sf::Event::KeyPressed ? 'K' : 'k', (int)ev.key.code,
+                              (ev.key.control ? 1 : 0) | (ev.key.alt ? 2 : 0) | (ev.key.shift ? 4 : 0) | (ev.key.system ? 8 : 0));
+                break;
+            case sf::Event::MouseButtonPressed:
+            case sf::Event::MouseButtonReleased:
+                std::snprintf(buf, sizeof(buf), " %c%d:%d:%d", ev.type == sf::Event::MouseButtonPressed ? 'B' : 'b',
+                              (int)ev.mouseButton.button, ev.mouseButton.x, ev.mouseButton.y);
+                break;
+            case sf::Event::MouseMoved:
+                std::snprintf(buf, sizeof(buf), " M%d:%d", ev.mouseMove.x, ev.mouseMove.y);
+                break;
+            default:
+                return;
+        }
+        linea += buf;
+    }
+
+    // Cierra el frame: su duración y los eventos que llegaron en él
+    void terminarFrame(float dtSegundos){
+        out << (long long)(dtSegundos * 1e6f + 0.5f) << linea << '\n';
+        linea.clear();
+        frames++;
+    }
+
+    long frames = 0;
+
+private:
+    std::ofstream out;
+    std::string linea;
+};
+
+class ReproductorSesion {
+public:
+    bool cargar(const std::string &ruta){
+        std::ifstream in(ruta);
+        if (!in) return false;
+        std::string texto;
+        while (std::getline(in, texto)){
+            if (texto.empty() || texto[0] == '#') continue;
+            std::istringstream ss(texto);
+            FrameGrabado f;
+            long long dt = 0;
+            if (!(ss >> dt)) return false;
+            f.dtSegundos = (float)(dt / 1e6);
+            f.primerEvento = eventos.size();
+            std::string tok;
+            while (ss >> tok){
+                sf::Event ev;
+                if (!leerEvento(tok, ev)) return false;
+                eventos.push_back(ev);
+            }
+            f.numEventos = eventos.size() - f.primerEvento;
+            frames.push_back(f);
+        }
+        return true;
+    }
+
+    // Pasa al frame siguiente; false cuando ya no quedan
+    bool siguienteFrame(){
+        if (frameActual + 1 >= (long)frames.size()) return false;
+        frameActual++;
+        eventoActual = 0;
+        return true;
+    }
+
+    // Como pollEvent: los eventos del frame actual, en orden
+    bool siguienteEvento(sf::Event &ev){
+        const FrameGrabado &f = frames[frameActual];
+        if (eventoActual >= f.numEventos) return false;
+        ev = eventos[f.primerEvento + eventoActual++];
+        return true;
+    }
+
+    float dt() const { return frames[frameActual].dtSegundos; }
+    long numFrames() const { return (long)frames.size(); }
+    size_t numEventos() const { return eventos.size(); }
+
+    // Tiempo que duró la sesión al grabarla
+    double segundosGrabados() const {
+        double t = 0;
+        for (const FrameGrabado &f : frames) t += f.dtSegundos;
+        return t;
+    }
+
+private:
+    struct FrameGrabado {
+        float dtSegundos = 0;
+        size_t primerEvento = 0;
+        size_t numEventos = 0;
+    };
+
+    static bool leerEvento(const std::string &tok, sf::Event &ev){
+        int a = 0, b = 0, c = 0;
+        const char *s = tok.c_str() + 1;
+        switch (tok[0]){
+            case 'C':
+                ev.type = sf::Event::Closed;
+                return true;
+            case 'K':
+            case 'k':
+                if (std::sscanf(s, "%d:%d", &a, &b) != 2) return false;
+                ev.type = (tok[0] == 'K') ? sf::Event::KeyPressed : sf::Event::KeyReleased;
+                ev.key.code = (sf::Keyboard::Key)a;
+                ev.key.control = (b & 1) != 0;
+                ev.key.alt = (b & 2) != 0;
+                ev.key.shift = (b & 4) != 0;
+                ev.key.system = (b & 8) != 0;
+                return true;
+            case 'B':
+            case 'b':
+                if (std::sscanf(s, "%d:%d:%d", &a, &b, &c) != 3) return false;
+                ev.type = (tok[0] == 'B') ? sf::Event::MouseButtonPressed : sf::Event::MouseButtonReleased;
+                ev.mouseButton.button = (sf::Mouse::Button)a;
+                ev.mouseButton.x = b;
+                ev.mouseButton.y = c;
+                return true;
+            case 'M':
+                if (std::sscanf(s, "%d:%d", &a, &b) != 2) return false;
+                ev.type = sf::Event::MouseMoved;
+                ev.mouseMove.x = a;
+                ev.mouseMove.y = b;
+                return true;
+        }
+        return false;
+    }
+
+    std::vector<FrameGrabado> frames;
+    std::vector<sf::Event> eventos;
+    long frameActual = -1;
+    size_t eventoActual = 0;
+};
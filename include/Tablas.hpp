@@ -0,0 +1,68 @@
+#pragma once
+#include "Reglas.hpp"
+#include <vector>
+#include <cstdint>
+
+// ---------------------- Fin de partida ----------------------
+// Mate, ahogado y tablas por triple repetición, regla de las 50 jugadas y material insuficiente.
+// SeguimientoTablas se actualiza con cada jugada comprometida a partir de su RegistroDeshacer:
+// el hash Zobrist y el material cambian solo en lo que toca la jugada, y la repetición solo mira
+// las posiciones desde la última captura o jugada de peón (como mucho 50 del mismo bando),
+// así que el coste por jugada no crece con la longitud de la partida.
+
+enum class ResultadoPartida { EnJuego, MateBlancas, MateNegras, Ahogado, Repeticion, Regla50, MaterialInsuficiente };
+
+// Motivo para el protocolo de red (FIN <motivo>)
+const char* motivoResultado(ResultadoPartida r);
+// Texto para el título de la ventana
+const char* descripcionResultado(ResultadoPartida r);
+
+// Piezas de cada bando por tipo; los alfiles, además, por color de casilla
+struct FirmaMaterial {
+    uint8_t piezas[2][6] = {};
+    uint8_t alfiles[2][2] = {};      // [bando][casilla clara = 0, oscura = 1]
+
+    void anadir(ColorPieza color, TipoPieza tipo, int casilla, int signo);
+};
+
+bool materialInsuficiente(const FirmaMaterial &m);
+
+// Hash Zobrist de la posición completa (piezas, turno, enroques, al paso y flags de Almate)
+uint64_t hashPosicion(const vector<Pieza>& piezas, const Tablero& tablero, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro, ColorPieza turno);
+
+class SeguimientoTablas {
+public:
+    // Posición de partida (borra la historia); 'reloj50' si viene de una posición escrita
+    void iniciar(const vector<Pieza>& piezas, const Tablero& tablero, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro, ColorPieza turno,
+                 int reloj50 = 0);
+
+    // Tras aplicarJugada: 'reg' es su registro y el resto, el estado ya actualizado
+    void registrar(const vector<Pieza>& piezas, const Tablero& tablero, const Jugada& j, const RegistroDeshacer& reg,
+                   const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro, ColorPieza turno);
+
+    // La última jugada se deshizo
+    void deshacer(){ if (pila.size() > 1) pila.pop_back(); }
+
+    // Sitio para 'posiciones' sin volver a pedir memoria al registrar jugadas
+    void reservar(size_t posiciones){ pila.reserve(posiciones); }
+
+    // Se eligió la pieza de promoción después de registrar la jugada (interfaz del juego)
+    void promocionar(int casilla, ColorPieza color, TipoPieza nuevoTipo);
+
+    // Resultado de la posición actual; 'mt' son los movimientos del bando al que le toca
+    ResultadoPartida resultado(const MovimientosTurno& mt, ColorPieza turno) const;
+
+    uint64_t hash() const { return pila.back().hash; }
+    int relojCincuenta() const { return pila.back().reloj50; }
+    uint64_t derechosPosicion() const { return pila.back().derechos; }   // lo que cuenta además de las piezas y el turno
+    int vecesRepetida() const;       // apariciones de la posición actual (1 = nueva)
+
+private:
+    struct Entrada {
+        uint64_t hash = 0;
+        uint64_t derechos = 0;       // enroques, al paso y flags de Almate empaquetados
+        uint16_t reloj50 = 0;        // medias jugadas sin captura ni movimiento de peón
+        FirmaMaterial material;
+    };
+    std::vector<Entrada> pila = std::vector<Entrada>(1);   // una por posición; [0] = la inicial
+};
@@ -1,47 +1,43 @@
 #pragma once
-#include <SFML/Graphics.hpp>
 #include <string>
-#include <cmath>
+#include <cstdint>
 using namespace std;
 
-// ---------------------- Configuración ----------------------
-const int TAM_CASILLA = 70;
-const int TABLERO_X   = 381; // coordenada X del tablero (sin márgenes)
-const int TABLERO_Y   = 50;  // coordenada Y del tablero (sin márgenes)
+// ---------------------- Tablero ----------------------
 const int FILAS = 8;
 const int COLS  = 8;
 
-// tolerancia (px) para aceptar un "drop" en la casilla más cercana
-const float RADIO_ACEPTACION = 40.0f;
-
-// animación captura
-const float DURACION_ANIMACION_CAPTURA = 0.30f; // segundos
-
-// dot color
-const sf::Color DOT_COLOR(200, 200, 255, 220);
-
 // ---------------------- Tipos ----------------------
-enum class TipoPieza { Pawn, Rook, Knight, Bishop, Queen, King };
-enum class ColorPieza { White, Black };
+enum class TipoPieza : uint8_t { Pawn, Rook, Knight, Bishop, Queen, King };
+enum class ColorPieza : uint8_t { White, Black };
 
+// Estado lógico de una pieza (7 bytes): se copia en cada simulación de las reglas y en cada
+// foto del historial. No depende de SFML: lo comparten el juego, el servidor y las herramientas.
+// Lo que se dibuja (sprite, escala, animación) está en SpritePieza (Graficos.hpp), con el mismo
+// índice; el nombre de la pieza sale de su tipo y color cuando hace falta (nombrePieza, Reglas.hpp).
 struct Pieza {
-    std::string id;           // id único
-    TipoPieza tipo;
-    ColorPieza color;
-    int fila, col;       // posición lógica (-1,-1 si fuera)
-    sf::Sprite sprite;
-
-    // para animaciones / restaurar escala
-    float baseSx = 1.0f;
-    float baseSy = 1.0f;
+    TipoPieza tipo = TipoPieza::Pawn;
+    ColorPieza color = ColorPieza::White;
+    int8_t fila = -1, col = -1;   // posición lógica (-1,-1 si fuera)
 
     bool alive = true;
-    bool animandoCaptura = false;
-    sf::Clock animClock;
 
-    // nuevo: si la pieza ya se movió (importante para enroque)
+    // si la pieza ya se movió (importante para enroque)
     bool hasMoved = false;
+
+    // protección "guardia": si true, no puede ser capturada durante el turno de protección activo
+    bool protegido = false;
 };
 
-// tablero lógico: índice de vector piezas, o -1 si vacío
-extern int tableroLogico[FILAS][COLS];
+// Tablero lógico: índice en el vector de piezas, o -1 si vacío. Cada partida (o análisis)
+// tiene el suyo y las reglas lo reciben como parámetro: no hay estado global.
+struct Tablero {
+    int casillas[FILAS][COLS];
+
+    int* operator[](int f){ return casillas[f]; }
+    const int* operator[](int f) const { return casillas[f]; }
+
+    void vaciar(){
+        for(int r=0;r<FILAS;r++) for(int c=0;c<COLS;c++) casillas[r][c] = -1;
+    }
+};
@@ -0,0 +1,343 @@
+// Analisis.cpp
+// Análisis de posiciones por lotes con las reglas de libalmate (sin SFML). Lee un archivo con
+// una posición por línea (FEN con el campo opcional de Almate, ver Protocolo.hpp) y escribe,
+// en el mismo orden y una línea por cada una:
+//   <movimientos legales> <estado> [<mejor jugada> <valor>]
+// separados por tabuladores. Estado: juego, jaque, mate, ahogado, tablas_50, tablas_material o
+// "error <motivo>". Las líneas vacías o que empiezan por '#' salen vacías.
+// Un hilo lee bloques de líneas, varios los analizan y otro los escribe en orden. Como mucho hay
+// --en-vuelo bloques en memoria, así que el archivo puede ser de cualquier tamaño.
+// Con --cache, los resultados se guardan en disco por posición (CacheAnalisis.hpp) y las
+// posiciones ya analizadas, en esta ejecución, en otra anterior o en otro proceso a la vez,
+// no se vuelven a calcular.
+// Uso: Analisis.exe [entrada|-] [--salida archivo|-] [--hilos N] [--mejor 0] [--bloque 4096] [--en-vuelo 64]
+//                   [--cache archivo]
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include "Protocolo.hpp"
+#include "CacheAnalisis.hpp"
+using namespace std;
+
+typedef chrono::steady_clock Reloj;
+
+// ---------------------- Mejor jugada ----------------------
+// Negamax con poda alfa-beta hasta 'profundidad' medias jugadas; valor = material del bando que
+// mueve (centipeones) y mates. Sin guardia y promocionando solo a dama.
+const int VALOR_MATE = 100000;
+const int VALOR_PIEZA[6] = { 100, 500, 320, 330, 900, 0 };    // en el orden de TipoPieza
+
+struct BuscadorMejor {
+    EstadoPartida *e = nullptr;
+    vector<MovimientosTurno> mts;
+    vector<vector<Jugada>> listas;
+    long nodos = 0;
+
+    int material() const {
+        int v = 0;
+        for (const Pieza &p : e->piezas){
+            if (!p.alive) continue;
+            v += (p.color == e->turno) ? VALOR_PIEZA[(int)p.tipo] : -VALOR_PIEZA[(int)p.tipo];
+        }
+        return v;
+    }
+
+    // capturas primero (la víctima más valiosa antes)
+    void jugadas(const MovimientosTurno &mt, vector<Jugada> &out) const {
+        out.clear();
+        for (int o=0; o<FILAS*COLS; ++o){
+            if (!mt.destinos[o]) continue;
+            const Pieza &p = e->piezas[e->tablero[o / COLS][o % COLS]];
+            for (uint64_t m = mt.destinos[o]; m; m &= m - 1){
+                Jugada j;
+                j.origen = (uint8_t)o;
+                j.destino = (uint8_t)__builtin_ctzll(m);
+                int fila = j.destino / COLS;
+                if (p.tipo == TipoPieza::Pawn && (fila == 0 || fila == FILAS-1)) j.promocion = 1 + (int)TipoPieza::Queen;
+                out.push_back(j);
+            }
+        }
+        auto valorCaptura = [&](const Jugada &j){
+            int v = e->tablero[j.destino / COLS][j.destino % COLS];
+            return v == -1 ? 0 : VALOR_PIEZA[(int)e->piezas[v].tipo];
+        };
+        stable_sort(out.begin(), out.end(), [&](const Jugada &a, const Jugada &b){ return valorCaptura(a) > valorCaptura(b); });
+    }
+
+    int negamax(int prof, int alfa, int beta, int ply, Jugada *mejor){
+        MovimientosTurno &mt = mts[ply];
+        calcularMovimientosTurno(mt, e->piezas, e->tablero, e->turno, e->flagsBlanco, e->flagsNegro);
+        nodos++;
+        if (mt.total == 0){
+            bool enJaque = (e->turno == ColorPieza::White) ? mt.blancoEnJaque : mt.negroEnJaque;
+            return enJaque ? -(VALOR_MATE - ply) : 0;
+        }
+        if (prof == 0) return material();
+
+        vector<Jugada> &lista = listas[ply];
+        jugadas(mt, lista);
+        int mejorValor = -VALOR_MATE - 1;
+        for (const Jugada &j : lista){
+            RegistroDeshacer reg;
+            aplicarJugada(e->piezas, e->tablero, j, e->flagsBlanco, e->flagsNegro, e->turno, &reg);
+            int v = -negamax(prof - 1, -beta, -alfa, ply + 1, nullptr);
+            deshacerJugada(e->piezas, e->tablero, j, reg, e->flagsBlanco, e->flagsNegro, e->turno);
+            if (v > mejorValor){
+                mejorValor = v;
+                if (mejor) *mejor = j;
+            }
+            if (v > alfa) alfa = v;
+            if (alfa >= beta) break;
+        }
+        return mejorValor;
+    }
+
+    int buscar(EstadoPartida &estado, int profundidad, Jugada &mejor){
+        e = &estado;
+        mts.resize(profundidad + 1);
+        listas.resize(profundidad + 1);
+        return negamax(profundidad, -VALOR_MATE - 1, VALOR_MATE + 1, 0, &mejor);
+    }
+};
+
+// ---------------------- Una línea ----------------------
+const char* const NOMBRE_ESTADO[] = { "juego", "jaque", "mate", "ahogado", "tablas_50", "tablas_material", "tablas_repeticion" };
+
+ValorAnalisis analizarPosicion(EstadoPartida &e, int profundidad, BuscadorMejor &buscador){
+    ValorAnalisis v;
+    MovimientosTurno mt;
+    e.movimientos(mt);
+    bool enJaque = (e.turno == ColorPieza::White) ? mt.blancoEnJaque : mt.negroEnJaque;
+    switch (e.resultado(mt)){
+        case ResultadoPartida::MateBlancas:
+        case ResultadoPartida::MateNegras:           v.estado = EstadoAnalisis::Mate; break;
+        case ResultadoPartida::Ahogado:              v.estado = EstadoAnalisis::Ahogado; break;
+        case ResultadoPartida::Regla50:              v.estado = EstadoAnalisis::Tablas50; break;
+        case ResultadoPartida::MaterialInsuficiente: v.estado = EstadoAnalisis::TablasMaterial; break;
+        case ResultadoPartida::Repeticion:           v.estado = EstadoAnalisis::TablasRepeticion; break;
+        case ResultadoPartida::EnJuego:              v.estado = enJaque ? EstadoAnalisis::Jaque : EstadoAnalisis::Juego; break;
+    }
+    v.movimientos = (uint16_t)mt.total;
+    if (profundidad > 0 && mt.total > 0){
+        v.conMejor = true;
+        v.valor = buscador.buscar(e, profundidad, v.mejor);
+    }
+    return v;
+}
+
+// Lo de cada hilo: su buscador, su posición y lo analizado de nuevo para la caché (aún sin
+// guardar: 'pendientes' lo encuentra si la posición se repite en el mismo bloque)
+struct Analizador {
+    BuscadorMejor buscador;
+    EstadoPartida e;
+    vector<NuevoAnalisis> nuevos;
+    unordered_map<ClaveAnalisis, size_t, HashClaveAnalisis> pendientes;   // índice en 'nuevos'
+    long aciertos = 0, guardados = 0;
+};
+
+void analizarLinea(const string &linea, int profundidad, CacheAnalisis *cache, Analizador &a, string &out){
+    if (linea.empty() || linea[0] == '#' || linea == "\r"){ out += '\n'; return; }
+    string error;
+    if (!textoAPosicion(linea, a.e, error)){
+        out += "0\terror ";
+        out += error;
+        out += '\n';
+        return;
+    }
+    ValorAnalisis v;
+    ClaveAnalisis clave;
+    bool conClave = cache && claveAnalisis(a.e, profundidad, clave);
+    auto pendiente = conClave ? a.pendientes.find(clave) : a.pendientes.end();
+    if (pendiente != a.pendientes.end()){
+        v = a.nuevos[pendiente->second].valor;
+        a.aciertos++;
+    } else if (conClave && cache->buscar(clave, v)){
+        a.aciertos++;
+    } else {
+        v = analizarPosicion(a.e, profundidad, a.buscador);
+        if (conClave){
+            a.pendientes.emplace(clave, a.nuevos.size());
+            a.nuevos.push_back({ clave, v });
+        }
+    }
+    out += to_string(v.movimientos);
+    out += '\t';
+    out += NOMBRE_ESTADO[(int)v.estado];
+    if (profundidad > 0){
+        if (!v.conMejor){
+            out += "\t-\t-";
+        } else {
+            out += '\t';
+            out += jugadaATexto(v.mejor);
+            out += '\t';
+            if (v.valor >= VALOR_MATE - 1000) out += "mate" + to_string((VALOR_MATE - v.valor + 1) / 2);
+            else if (v.valor <= -VALOR_MATE + 1000) out += "-mate" + to_string((VALOR_MATE + v.valor) / 2);
+            else out += to_string(v.valor);
+        }
+    }
+    out += '\n';
+}
+
+// ---------------------- Tubería ----------------------
+// Ranuras en anillo: el bloque k usa la ranura k % enVuelo. El lector espera a que la ranura
+// esté libre (k - escritos < enVuelo), los trabajadores toman los bloques leídos en orden y el
+// escritor saca el siguiente en cuanto está hecho.
+struct Bloque {
+    vector<string> lineas;
+    size_t numLineas = 0;
+    string salida;
+    bool hecho = false;
+};
+
+int main(int argc, char** argv){
+    string entrada = "-", salida = "-";
+    int hilos = (int)thread::hardware_concurrency(), profundidad = 0;
+    size_t tamBloque = 4096, enVuelo = 64;
+    string rutaCache;
+    for (int i=1; i<argc; ++i){
+        string arg = argv[i];
+        if (arg == "--salida" && i+1 < argc) salida = argv[++i];
+        else if (arg == "--hilos" && i+1 < argc) hilos = atoi(argv[++i]);
+        else if (arg == "--mejor" && i+1 < argc) profundidad = atoi(argv[++i]);
+        else if (arg == "--bloque" && i+1 < argc) tamBloque = (size_t)atol(argv[++i]);
+        else if (arg == "--en-vuelo" && i+1 < argc) enVuelo = (size_t)atol(argv[++i]);
+        else if (arg == "--cache" && i+1 < argc) rutaCache = argv[++i];
+        else entrada = arg;
+    }
+    if (hilos < 1) hilos = 1;
+    if (tamBloque < 1) tamBloque = 1;
+    if (enVuelo < 2) enVuelo = 2;
+    if (profundidad < 0) profundidad = 0;
+
+    static char bufEntrada[1 << 20];
+    ifstream archivoEntrada;
+    istream *in = &cin;
+    if (entrada != "-"){
+        archivoEntrada.rdbuf()->pubsetbuf(bufEntrada, sizeof(bufEntrada));
+        archivoEntrada.open(entrada, ios::binary);
+        if (!archivoEntrada){ cerr << "No se puede abrir " << entrada << "\n"; return 1; }
+        in = &archivoEntrada;
+    }
+    FILE *out = (salida == "-") ? stdout : fopen(salida.c_str(), "wb");
+    if (!out){ cerr << "No se puede escribir " << salida << "\n"; return 1; }
+
+    CacheAnalisis cacheDisco;
+    CacheAnalisis *cache = nullptr;
+    if (!rutaCache.empty()){
+        if (cacheDisco.abrir(rutaCache)) cache = &cacheDisco;
+        else cerr << "No se puede abrir la caché " << rutaCache << ", se analiza todo\n";
+    }
+    size_t entradasAntes = cache ? cache->numEntradas() : 0;
+    long aciertos = 0, guardados = 0;
+
+    vector<Bloque> ranuras(enVuelo);
+    mutex m;
+    condition_variable cv;
+    size_t leidos = 0, tomados = 0, escritos = 0, totalLineas = 0;
+    bool finLectura = false;
+    Reloj::time_point t0 = Reloj::now();
+
+    vector<thread> trabajadores;
+    for (int h=0; h<hilos; ++h){
+        trabajadores.emplace_back([&](){
+            Analizador a;
+            for (;;){
+                size_t k;
+                {
+                    unique_lock<mutex> lock(m);
+                    cv.wait(lock, [&]{ return tomados < leidos || finLectura; });
+                    if (tomados == leidos){
+                        aciertos += a.aciertos;
+                        guardados += a.guardados;
+                        return;
+                    }
+                    k = tomados++;
+                }
+                Bloque &b = ranuras[k % enVuelo];
+                b.salida.clear();
+                // lo que hayan guardado los demás hilos y procesos; lo nuevo, en un solo write
+                if (cache) cache->ponerAlDia();
+                for (size_t i=0; i<b.numLineas; ++i) analizarLinea(b.lineas[i], profundidad, cache, a, b.salida);
+                if (cache && !a.nuevos.empty()){
+                    a.guardados += (long)cache->guardar(a.nuevos);
+                    a.nuevos.clear();
+                    a.pendientes.clear();
+                }
+                {
+                    lock_guard<mutex> lock(m);
+                    b.hecho = true;
+                }
+                cv.notify_all();
+            }
+        });
+    }
+
+    thread escritor([&](){
+        for (;;){
+            Bloque *b;
+            {
+                unique_lock<mutex> lock(m);
+                cv.wait(lock, [&]{ return ranuras[escritos % enVuelo].hecho || (finLectura && escritos == leidos); });
+                if (!ranuras[escritos % enVuelo].hecho) return;
+                b = &ranuras[escritos % enVuelo];
+            }
+            fwrite(b->salida.data(), 1, b->salida.size(), out);
+            {
+                lock_guard<mutex> lock(m);
+                b->hecho = false;
+                escritos++;
+            }
+            cv.notify_all();
+        }
+    });
+
+    // lector (este hilo): llena la ranura libre sin el cerrojo; nadie más la toca hasta publicarla
+    for (bool quedan = true; quedan; ){
+        Bloque *b;
+        {
+            unique_lock<mutex> lock(m);
+            cv.wait(lock, [&]{ return leidos - escritos < enVuelo; });
+            b = &ranuras[leidos % enVuelo];
+        }
+        if (b->lineas.size() < tamBloque) b->lineas.resize(tamBloque);
+        b->numLineas = 0;
+        while (b->numLineas < tamBloque && getline(*in, b->lineas[b->numLineas])) b->numLineas++;
+        quedan = b->numLineas == tamBloque;
+        {
+            lock_guard<mutex> lock(m);
+            if (b->numLineas > 0) leidos++;
+            totalLineas += b->numLineas;
+            if (!quedan) finLectura = true;
+        }
+        cv.notify_all();
+    }
+
+    for (thread &t : trabajadores) t.join();
+    escritor.join();
+    if (out != stdout) fclose(out);
+    else fflush(out);
+
+    double segundos = chrono::duration<double>(Reloj::now() - t0).count();
+    cerr << totalLineas << " posiciones en " << segundos << " s (" << totalLineas / segundos << "/s), "
+         << hilos << " hilos, bloques de " << tamBloque << " líneas, " << enVuelo << " en vuelo\n";
+    if (cache){
+        // más de la mitad repetido (procesos que analizaron lo mismo a la vez): compactar
+        size_t entradas = cache->numEntradas(), registros = cache->numRegistros();
+        cerr << "caché " << rutaCache << ": " << aciertos << " aciertos, " << guardados << " guardadas, "
+             << entradas << " posiciones (" << entradas - entradasAntes << " nuevas), " << registros << " registros\n";
+        if (registros >= 4096 && registros > 2 * entradas){
+            if (cache->compactar()) cerr << "caché compactada: " << cache->numRegistros() << " registros\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,292 @@
+// BancoDifusion.cpp
+// Banco de pruebas de la difusión a espectadores (Difusion.hpp) sin servidor ni red externa:
+// un hilo juega una partida al azar y la difunde por TCP local a N espectadores; otro hilo los
+// lee todos con epoll y reconstruye la partida de cada uno. Una parte de los espectadores entra
+// a mitad de partida y otra no lee nada hasta el final (lentos) para forzar los saltos a foto.
+// Muestra el coste de cada publicación, la latencia jugada -> espectador y comprueba que todos
+// acaban con la misma posición que el emisor.
+// Requisitos: Linux (epoll).
+// Uso: BancoDifusion.exe [--espectadores 1000] [--jugadas 1000] [--intervalo 10] [--tardios 10] [--lentos 5]
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "Reglas.hpp"
+#include "Protocolo.hpp"
+#include "Difusion.hpp"
+using namespace std;
+
+typedef chrono::steady_clock Reloj;
+
+const int BUFFER_LENTO = 1024;              // el núcleo lo sube al mínimo que admita
+
+struct Espectador {
+    int cliente = -1;                       // lado que lee
+    int servidor = -1;                      // lado en el que escribe el difusor
+    bool lento = false;
+    bool tardio = false;
+    LectorDifusion lector;
+};
+
+inline long long ahoraNs(){
+    return chrono::duration_cast<chrono::nanoseconds>(Reloj::now().time_since_epoch()).count();
+}
+
+inline float percentil(vector<float> &v, float q){
+    if (v.empty()) return 0.f;
+    return v[std::min(v.size()-1, (size_t)(q * (v.size()-1)))];
+}
+
+// Jugada legal al azar del bando al que le toca (a veces con guardia); false si no hay ninguna
+bool jugadaAlAzar(EstadoPartida &e, mt19937 &azar, Jugada &jug){
+    MovimientosTurno mt;
+    e.movimientos(mt);
+    if (mt.total == 0) return false;
+    int k = (int)(azar() % (unsigned)mt.total);
+    jug = Jugada();
+    for (int o=0; o<FILAS*COLS && jug.origen == SIN_CASILLA; ++o){
+        for (uint64_t m = mt.destinos[o]; m; m &= m - 1){
+            if (k-- == 0){
+                jug.origen = (uint8_t)o;
+                jug.destino = (uint8_t)__builtin_ctzll(m);
+                break;
+            }
+        }
+    }
+    const ReglasFlags &propios = (e.turno == ColorPieza::White) ? e.flagsBlanco : e.flagsNegro;
+    if (!propios.guardiaUsado && azar() % 20 == 0) jug.guardia = jug.origen;
+    return true;
+}
+
+int main(int argc, char** argv){
+    int n = 1000, maxJugadas = 1000, intervaloMs = 10, pctTardios = 10, pctLentos = 5;
+    for (int i=1; i+1<argc; ++i){
+        string arg = argv[i];
+        if (arg == "--espectadores") n = atoi(argv[++i]);
+        else if (arg == "--jugadas") maxJugadas = atoi(argv[++i]);
+        else if (arg == "--intervalo") intervaloMs = atoi(argv[++i]);
+        else if (arg == "--tardios") pctTardios = atoi(argv[++i]);
+        else if (arg == "--lentos") pctLentos = atoi(argv[++i]);
+    }
+    if (n < 1) n = 1;
+    if (maxJugadas < 1) maxJugadas = 1;
+
+    signal(SIGPIPE, SIG_IGN);
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0){
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+        if ((rlim_t)(2 * n + 16) > lim.rlim_cur){
+            cerr << "El límite de descriptores (" << lim.rlim_cur << ") no llega para " << n << " espectadores\n";
+            return 1;
+        }
+    }
+
+    // escucha en un puerto libre de 127.0.0.1
+    int escucha = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in dir{};
+    dir.sin_family = AF_INET;
+    dir.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t largo = sizeof(dir);
+    if (bind(escucha, (sockaddr*)&dir, sizeof(dir)) != 0 || listen(escucha, 4096) != 0
+        || getsockname(escucha, (sockaddr*)&dir, &largo) != 0){
+        perror("escucha");
+        return 1;
+    }
+
+    vector<Espectador> esp(n);
+    int si = 1;
+    Reloj::time_point inicio = Reloj::now();
+    for (int i=0; i<n; ++i){
+        Espectador &e = esp[i];
+        e.lento = pctLentos > 0 && i % 100 < pctLentos;
+        e.tardio = !e.lento && pctTardios > 0 && (i * 37) % 100 < pctTardios;
+        e.cliente = socket(AF_INET, SOCK_STREAM, 0);
+        if (e.lento){
+            int b = BUFFER_LENTO;
+            setsockopt(e.cliente, SOL_SOCKET, SO_RCVBUF, &b, sizeof(b));
+        }
+        if (connect(e.cliente, (sockaddr*)&dir, sizeof(dir)) != 0 || (e.servidor = accept(escucha, nullptr, nullptr)) < 0){
+            cerr << "No se pudo conectar el espectador " << i << ": " << strerror(errno) << "\n";
+            return 1;
+        }
+        int b = 8 * 1024;
+        setsockopt(e.servidor, SOL_SOCKET, SO_SNDBUF, &b, sizeof(b));
+        setsockopt(e.servidor, IPPROTO_TCP, TCP_NODELAY, &si, sizeof(si));
+        fcntl(e.servidor, F_SETFL, fcntl(e.servidor, F_GETFL, 0) | O_NONBLOCK);
+        fcntl(e.cliente, F_SETFL, fcntl(e.cliente, F_GETFL, 0) | O_NONBLOCK);
+    }
+    cout << n << " espectadores conectados en "
+         << chrono::duration<float, milli>(Reloj::now() - inicio).count() << " ms\n";
+
+    // publicadaEn[ply]: cuándo se difundió (ns); el lector mide contra esto
+    unique_ptr<atomic<long long>[]> publicadaEn(new atomic<long long>[maxJugadas]);
+    for (int i=0; i<maxJugadas; ++i) publicadaEn[i] = 0;
+    atomic<int> jugadasHechas{0};
+    atomic<bool> emisorTermino{false};              // ya no hay más jugadas
+    atomic<bool> lectoresTerminaron{false};
+    EstadoPartida final_;
+    vector<float> costePublicarUs;
+    long saltosAFoto = 0;
+
+    // ---------------------- Emisor ----------------------
+    thread emisor([&]{
+        EstadoPartida estado;
+        estado.iniciar();
+        Difusor difusor(estado);
+        mt19937 azar(2024);
+        int ep = epoll_create1(0);
+        auto suscribir = [&](int i){
+            epoll_event ev{};
+            ev.events = EPOLLOUT | EPOLLET;
+            ev.data.u32 = (uint32_t)i;
+            epoll_ctl(ep, EPOLL_CTL_ADD, esp[i].servidor, &ev);
+            difusor.suscribir(esp[i].servidor);
+        };
+        for (int i=0; i<n; ++i) if (!esp[i].tardio) suscribir(i);
+        bool tardiosDentro = false;
+        auto suscribirTardios = [&]{
+            if (tardiosDentro) return;
+            tardiosDentro = true;
+            for (int i=0; i<n; ++i) if (esp[i].tardio) suscribir(i);
+        };
+
+        costePublicarUs.reserve(maxJugadas);
+        epoll_event eventos[256];
+        Reloj::time_point siguiente = Reloj::now();
+        for (int ply=0; ply<maxJugadas; ){
+            int espera = (int)std::max<long long>(0, chrono::duration_cast<chrono::milliseconds>(siguiente - Reloj::now()).count());
+            int k = epoll_wait(ep, eventos, 256, espera);
+            for (int e=0; e<k; ++e) difusor.sePuedeEscribir(esp[eventos[e].data.u32].servidor);
+            if (Reloj::now() < siguiente) continue;
+            siguiente += chrono::milliseconds(intervaloMs);
+
+            if (ply == maxJugadas / 2) suscribirTardios();
+
+            Jugada j;
+            if (!jugadaAlAzar(estado, azar, j)) break;     // mate o ahogado
+            DeltaJugada d = crearDelta(estado, j);
+            if (!estado.jugar(j)){ cerr << "jugada ilegal generada\n"; break; }
+            publicadaEn[ply].store(ahoraNs(), memory_order_release);
+            Reloj::time_point t0 = Reloj::now();
+            difusor.publicar(d, estado);
+            costePublicarUs.push_back(chrono::duration<float, micro>(Reloj::now() - t0).count());
+            jugadasHechas.store(++ply, memory_order_release);
+        }
+
+        suscribirTardios();                         // por si la partida acabó antes de la mitad
+        final_ = estado;
+        emisorTermino = true;
+
+        // seguir vaciando a los que quedaron atascados hasta que los lectores acaben
+        while (!lectoresTerminaron.load()){
+            int k = epoll_wait(ep, eventos, 256, 20);
+            for (int e=0; e<k; ++e) difusor.sePuedeEscribir(esp[eventos[e].data.u32].servidor);
+        }
+        saltosAFoto = difusor.saltosAFoto;
+        close(ep);
+    });
+
+    // ---------------------- Espectadores ----------------------
+    vector<float> latenciasMs;                      // espectadores normales
+    vector<long long> ultimaLlegada(maxJugadas, 0); // por jugada: el último normal que la recibió
+    latenciasMs.reserve((size_t)n * maxJugadas / 4);
+    int ep = epoll_create1(0);
+    for (int i=0; i<n; ++i){
+        if (esp[i].lento) continue;                 // no leen nada hasta que acaba la partida
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = (uint32_t)i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, esp[i].cliente, &ev);
+    }
+    auto leer = [&](int i){
+        Espectador &e = esp[i];
+        uint8_t buf[4096];
+        for (;;){
+            ssize_t r = recv(e.cliente, buf, sizeof(buf), 0);
+            if (r <= 0) return;
+            long long t = ahoraNs();
+            e.lector.consumir(buf, (size_t)r,
+                [&](const DeltaJugada &d){
+                    if (e.lento || d.ply >= maxJugadas) return;
+                    if (e.tardio && d.ply < maxJugadas / 2) return;     // cola de la foto: ya era vieja
+                    long long p = publicadaEn[d.ply].load(memory_order_acquire);
+                    latenciasMs.push_back((float)((t - p) / 1e6));
+                    ultimaLlegada[d.ply] = std::max(ultimaLlegada[d.ply], t);
+                },
+                []{});
+        }
+    };
+    auto todosAlDia = [&]{
+        if (!emisorTermino.load()) return false;
+        int total = jugadasHechas.load();
+        for (Espectador &e : esp) if (!e.lector.conFoto || e.lector.estado.jugadas != total) return false;
+        return true;
+    };
+
+    epoll_event eventos[256];
+    Reloj::time_point limite = Reloj::time_point::max();    // 10 s desde la última jugada
+    while (!todosAlDia() && Reloj::now() < limite){
+        if (emisorTermino.load() && limite == Reloj::time_point::max()) limite = Reloj::now() + chrono::seconds(10);
+        int k = epoll_wait(ep, eventos, 256, 20);
+        for (int e=0; e<k; ++e) leer((int)eventos[e].data.u32);
+        if (emisorTermino.load())
+            for (int i=0; i<n; ++i) if (esp[i].lento) leer(i);
+    }
+    lectoresTerminaron = true;
+    emisor.join();
+
+    // ---------------------- Resultados ----------------------
+    int total = jugadasHechas.load();
+    int distintos = 0, incompletos = 0;
+    long desfases = 0, fotos = 0;
+    for (Espectador &e : esp){
+        desfases += e.lector.desfases;
+        fotos += e.lector.fotos;
+        if (!e.lector.conFoto || e.lector.estado.jugadas != total){ incompletos++; continue; }
+        if (memcmp(&e.lector.estado.tablero, &final_.tablero, sizeof(Tablero)) != 0) distintos++;
+    }
+
+    vector<float> abanico;                          // jugada -> último espectador normal
+    for (int p=0; p<total; ++p)
+        if (ultimaLlegada[p]) abanico.push_back((float)((ultimaLlegada[p] - publicadaEn[p].load()) / 1e6));
+    sort(latenciasMs.begin(), latenciasMs.end());
+    sort(abanico.begin(), abanico.end());
+    sort(costePublicarUs.begin(), costePublicarUs.end());
+
+    int lentos = 0, tardios = 0;
+    for (Espectador &e : esp){ lentos += e.lento; tardios += e.tardio; }
+    cout << "espectadores " << n << " (tardíos " << tardios << ", lentos " << lentos << ")"
+         << " | jugadas " << total << " | " << TAM_DELTA << " B/delta, " << TAM_FOTO << " B/foto\n"
+         << "publicar (us): p50 " << percentil(costePublicarUs, 0.5f) << " p99 " << percentil(costePublicarUs, 0.99f)
+         << " max " << (costePublicarUs.empty() ? 0.f : costePublicarUs.back()) << "\n"
+         << "jugada -> espectador (ms): p50 " << percentil(latenciasMs, 0.5f) << " p99 " << percentil(latenciasMs, 0.99f)
+         << " max " << (latenciasMs.empty() ? 0.f : latenciasMs.back()) << "\n"
+         << "jugada -> todos (ms): p50 " << percentil(abanico, 0.5f) << " p99 " << percentil(abanico, 0.99f)
+         << " max " << (abanico.empty() ? 0.f : abanico.back()) << "\n"
+         << "fotos enviadas " << fotos << " | saltos a foto " << saltosAFoto << " | desfases " << desfases << "\n"
+         << "posición final distinta " << distintos << " | sin terminar " << incompletos << "\n";
+
+    for (Espectador &e : esp){ close(e.cliente); close(e.servidor); }
+    close(ep);
+    close(escucha);
+    return (distintos == 0 && incompletos == 0 && desfases == 0) ? 0 : 2;
+}
@@ -0,0 +1,461 @@
+// BancoReglas.cpp
+// Compara las dos variantes de reglas compiladas desde el mismo código (Reglas.hpp):
+// ajedrez estándar y Almate. Genera posiciones jugando partidas al azar y mide, para cada
+// variante, el cálculo completo de movimientos del turno y movimientoLegal sobre todas las
+// casillas de destino. También cuenta en cuántas posiciones difieren (solo puede ser por el
+// enroque extendido, porque estas partidas no usan la guardia). El cálculo antiguo (cada destino
+// con movimientoLegal y una simulación de la jugada) se mide también como referencia y se
+// comprueba que da exactamente los mismos movimientos que el generador de Reglas.cpp.
+// Por último, el mapa de control (Control.hpp) actualizado jugada a jugada a lo largo de las
+// partidas, contra calcularlo desde cero en cada posición y contra puedeAtacar.
+// Y la validación por lotes (Lote.hpp) de jugadas legales y al azar, en partidas que sí usan la
+// guardia, contra validarlas una a una como el servidor y con la simulación antigua.
+// Y el historial del juego (deshacer, rehacer e ir a una jugada) en partidas con guardia.
+// Uso: BancoReglas.exe [--posiciones 2000] [--repeticiones 5] [--semilla 7]
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include "Reglas.hpp"
+#include "Protocolo.hpp"
+#include "Control.hpp"
+#include "Lote.hpp"
+#include "Historial.hpp"
+using namespace std;
+
+typedef chrono::steady_clock Reloj;
+
+// Una de las jugadas legales de 'mt' al azar; con 'guardia', a veces (si le queda) sobre una
+// pieza cualquiera del bando que mueve
+Jugada jugadaAlAzar(const EstadoPartida &e, const MovimientosTurno &mt, mt19937 &azar, bool guardia){
+    int k = (int)(azar() % (unsigned)mt.total);
+    Jugada j;
+    for (int o=0; o<FILAS*COLS && j.origen == SIN_CASILLA; ++o){
+        for (uint64_t m = mt.destinos[o]; m; m &= m - 1){
+            if (k-- == 0){
+                j.origen = (uint8_t)o;
+                j.destino = (uint8_t)__builtin_ctzll(m);
+                break;
+            }
+        }
+    }
+    const ReglasFlags &propios = (e.turno == ColorPieza::White) ? e.flagsBlanco : e.flagsNegro;
+    if (guardia && !propios.guardiaUsado && azar() % 8 == 0){
+        int g = (int)(azar() % (FILAS*COLS));
+        while (e.tablero[g / COLS][g % COLS] == -1 || e.piezas[e.tablero[g / COLS][g % COLS]].color != e.turno) g = (g + 1) % (FILAS*COLS);
+        j.guardia = (uint8_t)g;
+    }
+    return j;
+}
+
+// Posiciones de partidas al azar, una por jugada; con 'guardia', cada bando la usa alguna vez
+// sobre una pieza cualquiera suya
+vector<EstadoPartida> generarPosiciones(int cuantas, unsigned semilla, bool guardia = false){
+    vector<EstadoPartida> pos;
+    pos.reserve(cuantas);
+    mt19937 azar(semilla);
+    EstadoPartida e;
+    e.iniciar();
+    while ((int)pos.size() < cuantas){
+        MovimientosTurno mt;
+        e.movimientos(mt);
+        if (mt.total == 0 || e.jugadas >= 200){
+            e.iniciar();
+            continue;
+        }
+        pos.push_back(e);
+        Jugada j = jugadaAlAzar(e, mt, azar, guardia);
+        e.jugar(j);
+    }
+    return pos;
+}
+
+// ---------------------- Historial ----------------------
+// Partidas al azar con guardia jugadas con el historial del juego (Historial.hpp). Cada jugada
+// con guardia se deshace y se rehace en el momento; al final se va a cada jugada con irA y se
+// deshace la partida entera. Todo se compara con la posición apuntada al jugar.
+bool mismaPosicion(const EstadoPartida &a, const EstadoPartida &b){
+    if (a.turno != b.turno || a.piezas.size() != b.piezas.size()) return false;
+    for (int f=0; f<FILAS; ++f)
+        for (int c=0; c<COLS; ++c)
+            if (a.tablero[f][c] != b.tablero[f][c]) return false;
+    for (size_t i=0; i<a.piezas.size(); ++i){
+        const Pieza &p = a.piezas[i], &q = b.piezas[i];
+        if (p.tipo != q.tipo || p.color != q.color || p.fila != q.fila || p.col != q.col || p.alive != q.alive
+            || p.hasMoved != q.hasMoved || p.protegido != q.protegido) return false;
+    }
+    const ReglasFlags *fa[2] = { &a.flagsBlanco, &a.flagsNegro }, *fb[2] = { &b.flagsBlanco, &b.flagsNegro };
+    for (int k=0; k<2; ++k){
+        const ReglasFlags &x = *fa[k], &y = *fb[k];
+        if (x.guardiaUsado != y.guardiaUsado || x.guardiaIdx != y.guardiaIdx || x.proteccionActiva != y.proteccionActiva
+            || x.proteccionTurnoDe != y.proteccionTurnoDe || x.enroque3Usado != y.enroque3Usado || x.alPaso != y.alPaso) return false;
+    }
+    return true;
+}
+
+struct ResultadoHistorial {
+    long jugadas = 0;
+    long guardias = 0;             // jugadas con guardia deshechas y rehechas al momento
+    long distintas = 0;            // comparaciones que no coinciden
+};
+
+ResultadoHistorial comprobarHistorial(int partidas, unsigned semilla){
+    ResultadoHistorial r;
+    mt19937 azar(semilla);
+    vector<EstadoPartida> vistas;
+    for (int p=0; p<partidas; ++p){
+        EstadoPartida e, x;
+        e.iniciar();
+        Historial h;
+        vistas.assign(1, e);
+        for (int n=0; n<200; ++n){
+            MovimientosTurno mt;
+            e.movimientos(mt);
+            if (mt.total == 0) break;
+            Jugada j = jugadaAlAzar(e, mt, azar, true);
+            const Pieza &m = e.piezas[e.tablero[j.origen / COLS][j.origen % COLS]];
+            if (m.tipo == TipoPieza::Pawn && (j.destino / COLS == 0 || j.destino / COLS == FILAS-1)) j.promocion = 1 + (uint8_t)TipoPieza::Queen;
+            h.jugar(j, e.piezas, e.tablero, e.flagsBlanco, e.flagsNegro, e.turno);
+            vistas.push_back(e);
+            r.jugadas++;
+            if (j.guardia != SIN_CASILLA){
+                r.guardias++;
+                h.deshacer(e.piezas, e.tablero, e.flagsBlanco, e.flagsNegro, e.turno);
+                r.distintas += !mismaPosicion(e, vistas[vistas.size() - 2]);
+                h.rehacer(e.piezas, e.tablero, e.flagsBlanco, e.flagsNegro, e.turno);
+                r.distintas += !mismaPosicion(e, vistas.back());
+            }
+        }
+        for (int k=0; k<(int)vistas.size(); ++k){
+            x = e;
+            h.irA(k, x.piezas, x.tablero, x.flagsBlanco, x.flagsNegro, x.turno);
+            r.distintas += !mismaPosicion(x, vistas[k]);
+        }
+        for (int k=(int)vistas.size() - 2; k >= 0; --k){
+            h.deshacer(e.piezas, e.tablero, e.flagsBlanco, e.flagsNegro, e.turno);
+            r.distintas += !mismaPosicion(e, vistas[k]);
+        }
+    }
+    return r;
+}
+
+// Referencia: movimientoLegal sobre cada destino y, si pasa, simular la jugada y buscar jaque
+template <class Variante>
+void movimientosSimulados(MovimientosTurno &mt, EstadoPartida &e){
+    mt = MovimientosTurno();
+    const ReglasFlags &propios = (e.turno == ColorPieza::White) ? e.flagsBlanco : e.flagsNegro;
+    for (int i=0; i<(int)e.piezas.size(); ++i){
+        const Pieza &p = e.piezas[i];
+        if (!p.alive || p.color != e.turno) continue;
+        for (int d=0; d<FILAS*COLS; ++d){
+            int f = d / COLS, c = d % COLS;
+            if (!movimientoLegal<Variante>(e.piezas, e.tablero, i, f, c, e.flagsBlanco, e.flagsNegro)) continue;
+            if (Variante::enroqueExtendido && p.tipo == TipoPieza::King && f == p.fila && abs(c - p.col) == 3 && propios.enroque3Usado) continue;
+            if (dejaReyEnJaqueSimulado<Variante>(e.piezas, e.tablero, i, f, c, e.flagsBlanco, e.flagsNegro)) continue;
+            mt.destinos[indiceCasilla(p.fila, p.col)] |= 1ULL << d;
+            mt.total++;
+        }
+    }
+}
+
+// ---------------------- Validación por lotes ----------------------
+// Lo que hacía el servidor antes de destinoLegal: movimientoLegal y simular la jugada para ver si
+// deja al rey en jaque, más la guardia y la promoción como en EstadoPartida::esValida
+template <class Variante>
+bool validarSimulando(EstadoPartida &e, const Jugada &j){
+    if (j.origen >= FILAS*COLS || j.destino >= FILAS*COLS) return false;
+    int idx = e.tablero[j.origen / COLS][j.origen % COLS];
+    if (idx == -1 || e.piezas[idx].color != e.turno) return false;
+    const Pieza &p = e.piezas[idx];
+    const ReglasFlags &propios = (e.turno == ColorPieza::White) ? e.flagsBlanco : e.flagsNegro;
+    int f = j.destino / COLS, c = j.destino % COLS;
+    if (!movimientoLegal<Variante>(e.piezas, e.tablero, idx, f, c, e.flagsBlanco, e.flagsNegro)) return false;
+    if (Variante::enroqueExtendido && p.tipo == TipoPieza::King && f == p.fila && abs(c - p.col) == 3 && propios.enroque3Usado) return false;
+    bool corona = p.tipo == TipoPieza::Pawn && f == ((e.turno == ColorPieza::White) ? 0 : FILAS-1);
+    if (dejaReyEnJaqueSimulado<Variante>(e.piezas, e.tablero, idx, f, c, e.flagsBlanco, e.flagsNegro)) return false;
+    if (j.guardia != SIN_CASILLA){
+        if (!Variante::guardia || j.guardia >= FILAS*COLS || propios.guardiaUsado) return false;
+        int g = e.tablero[j.guardia / COLS][j.guardia % COLS];
+        if (g == -1 || e.piezas[g].color != e.turno) return false;
+    }
+    if (j.promocion != 0 && (!corona || j.promocion < 1 + (int)TipoPieza::Rook || j.promocion > 1 + (int)TipoPieza::Queen)) return false;
+    return true;
+}
+
+struct ResultadoLote {
+    long jugadas = 0, legales = 0;
+    double nsSimulado = 0;         // validarSimulando por jugada
+    double nsUnaAUna = 0;          // EstadoPartida::esValida por jugada (el servidor)
+    double nsEscalar = 0;          // validarLote sin AVX2
+    double nsAvx2 = 0;             // validarLote con AVX2 (0 si no hay)
+    double nsConvertir = 0;        // posicionALote por posición
+    int distintasSimulado = 0, distintasEscalar = 0, distintasAvx2 = 0;    // contra esValida
+};
+
+// Por posición, todas sus jugadas legales (a veces con guardia o una pieza de promoción) y
+// otras tantas al azar desde una pieza propia (casi todas ilegales)
+void generarConsultas(vector<EstadoPartida> &pos, unsigned semilla, vector<int> &posicion, vector<Jugada> &jugadas){
+    mt19937 azar(semilla);
+    for (int k=0; k<(int)pos.size(); ++k){
+        EstadoPartida &e = pos[k];
+        MovimientosTurno mt;
+        e.movimientos(mt);
+        auto adornar = [&](Jugada &j){
+            if (azar() % 16 == 0) j.guardia = (uint8_t)(azar() % (FILAS*COLS));
+            if (azar() % 16 == 0) j.promocion = (uint8_t)(azar() % 7);
+        };
+        for (int o=0; o<FILAS*COLS; ++o){
+            for (uint64_t m = mt.destinos[o]; m; m &= m - 1){
+                Jugada j;
+                j.origen = (uint8_t)o;
+                j.destino = (uint8_t)__builtin_ctzll(m);
+                adornar(j);
+                posicion.push_back(k);
+                jugadas.push_back(j);
+            }
+        }
+        for (int n=0; n<mt.total; ++n){
+            int o = (int)(azar() % (FILAS*COLS));
+            while (e.tablero[o / COLS][o % COLS] == -1 || e.piezas[e.tablero[o / COLS][o % COLS]].color != e.turno) o = (o + 1) % (FILAS*COLS);
+            Jugada j;
+            j.origen = (uint8_t)o;
+            j.destino = (uint8_t)(azar() % (FILAS*COLS));
+            adornar(j);
+            posicion.push_back(k);
+            jugadas.push_back(j);
+        }
+    }
+}
+
+template <class Variante>
+ResultadoLote medirLote(vector<EstadoPartida> &pos, const vector<int> &posicion, const vector<Jugada> &jugadas, int repeticiones){
+    ResultadoLote r;
+    size_t n = jugadas.size();
+    r.jugadas = (long)n;
+    vector<uint8_t> ref(n), res(n);
+
+    Reloj::time_point t0 = Reloj::now();
+    for (int k=0; k<repeticiones; ++k)
+        for (size_t i=0; i<n; ++i) ref[i] = pos[posicion[i]].esValida<Variante>(jugadas[i]);
+    r.nsUnaAUna = chrono::duration<double, nano>(Reloj::now() - t0).count() / ((double)repeticiones * n);
+    for (size_t i=0; i<n; ++i) r.legales += ref[i];
+
+    t0 = Reloj::now();
+    for (int k=0; k<repeticiones; ++k)
+        for (size_t i=0; i<n; ++i) res[i] = validarSimulando<Variante>(pos[posicion[i]], jugadas[i]);
+    r.nsSimulado = chrono::duration<double, nano>(Reloj::now() - t0).count() / ((double)repeticiones * n);
+    for (size_t i=0; i<n; ++i) r.distintasSimulado += res[i] != ref[i];
+
+    // el lote lleva su copia de la posición con cada jugada (así la recibiría el servidor)
+    vector<PosicionLote> porPosicion(pos.size()), lote(n);
+    t0 = Reloj::now();
+    for (int k=0; k<repeticiones; ++k)
+        for (size_t i=0; i<pos.size(); ++i)
+            posicionALote(porPosicion[i], pos[i].piezas, pos[i].tablero, pos[i].flagsBlanco, pos[i].flagsNegro, pos[i].turno);
+    r.nsConvertir = chrono::duration<double, nano>(Reloj::now() - t0).count() / ((double)repeticiones * pos.size());
+    for (size_t i=0; i<n; ++i) lote[i] = porPosicion[posicion[i]];
+
+    t0 = Reloj::now();
+    for (int k=0; k<repeticiones; ++k) validarLote<Variante>(lote.data(), jugadas.data(), n, res.data(), NucleoLote::Escalar);
+    r.nsEscalar = chrono::duration<double, nano>(Reloj::now() - t0).count() / ((double)repeticiones * n);
+    for (size_t i=0; i<n; ++i) r.distintasEscalar += res[i] != ref[i];
+
+    if (avx2Disponible()){
+        t0 = Reloj::now();
+        for (int k=0; k<repeticiones; ++k) validarLote<Variante>(lote.data(), jugadas.data(), n, res.data(), NucleoLote::Avx2);
+        r.nsAvx2 = chrono::duration<double, nano>(Reloj::now() - t0).count() / ((double)repeticiones * n);
+        for (size_t i=0; i<n; ++i) r.distintasAvx2 += res[i] != ref[i];
+    }
+    return r;
+}
+
+template <class Variante>
+void mostrarLote(const ResultadoLote &r){
+    cout << "lote " << Variante::nombre << ":\t" << r.jugadas << " jugadas (" << r.legales << " legales)"
+         << "\tsimulando " << r.nsSimulado << " ns/jugada, una a una " << r.nsUnaAUna << " ns"
+         << ", lote escalar " << r.nsEscalar << " ns (" << r.nsUnaAUna / r.nsEscalar << "x)";
+    if (r.nsAvx2 > 0) cout << ", lote avx2 " << r.nsAvx2 << " ns (" << r.nsUnaAUna / r.nsAvx2 << "x, " << r.nsSimulado / r.nsAvx2 << "x simulando)";
+    else cout << ", sin avx2";
+    cout << "\n\tposicionALote " << r.nsConvertir << " ns/posición"
+         << ", no coinciden con una a una: simulando " << r.distintasSimulado << ", escalar " << r.distintasEscalar << ", avx2 " << r.distintasAvx2 << "\n";
+}
+
+// ---------------------- Mapa de control ----------------------
+struct ResultadoControl {
+    double nsIncremental = 0;      // actualizar por posición (las posiciones siguen las partidas)
+    double nsCompleto = 0;         // iniciar por posición
+    double piezasRecalculadas = 0; // media por actualización
+    int distintas = 0;             // posiciones en las que el incremental no cuadra con el completo
+    int ataquesDistintos = 0;      // piezas en las que casillasAtacadas no cuadra con puedeAtacar
+};
+
+ResultadoControl medirControl(vector<EstadoPartida> &pos, int repeticiones){
+    ResultadoControl r;
+    MapaControl mapa, completo;
+    long recalculadas = 0;
+
+    // copias seguidas en memoria: cada EstadoPartida arrastra su pila de tablas y medir sobre
+    // ellas sería medir fallos de caché
+    vector<vector<Pieza>> piezas;
+    vector<Tablero> tableros;
+    piezas.reserve(pos.size());
+    tableros.reserve(pos.size());
+    for (EstadoPartida &e : pos){
+        piezas.push_back(e.piezas);
+        tableros.push_back(e.tablero);
+    }
+
+    Reloj::time_point t0 = Reloj::now();
+    for (int k=0; k<repeticiones; ++k){
+        mapa.iniciar(piezas[0], tableros[0]);
+        for (size_t i=0; i<pos.size(); ++i){
+            int n = mapa.actualizar(piezas[i], tableros[i]);
+            if (k == 0) recalculadas += n;
+        }
+    }
+    r.nsIncremental = chrono::duration<double, nano>(Reloj::now() - t0).count() / ((double)repeticiones * pos.size());
+    r.piezasRecalculadas = (double)recalculadas / pos.size();
+
+    t0 = Reloj::now();
+    for (int k=0; k<repeticiones; ++k)
+        for (size_t i=0; i<pos.size(); ++i) completo.iniciar(piezas[i], tableros[i]);
+    r.nsCompleto = chrono::duration<double, nano>(Reloj::now() - t0).count() / ((double)repeticiones * pos.size());
+
+    mapa.iniciar(pos[0].piezas, pos[0].tablero);
+    for (EstadoPartida &e : pos){
+        mapa.actualizar(e.piezas, e.tablero);
+        completo.iniciar(e.piezas, e.tablero);
+        for (int s=0; s<FILAS*COLS; ++s){
+            if (mapa.cuentaBruta(ColorPieza::White, s) != completo.cuentaBruta(ColorPieza::White, s)
+                || mapa.cuentaBruta(ColorPieza::Black, s) != completo.cuentaBruta(ColorPieza::Black, s)){ r.distintas++; break; }
+        }
+        for (int i=0; i<(int)e.piezas.size(); ++i){
+            uint64_t ref = 0;
+            for (int s=0; s<FILAS*COLS; ++s)
+                if (s != indiceCasilla(e.piezas[i].fila, e.piezas[i].col) && puedeAtacar(e.piezas, e.tablero, i, s / COLS, s % COLS)) ref |= 1ULL << s;
+            if (ref != casillasAtacadas(e.piezas, e.tablero, i)) r.ataquesDistintos++;
+        }
+    }
+    return r;
+}
+
+struct ResultadoVariante {
+    double nsTurno = 0;            // calcularMovimientosTurno por posición
+    double nsSimulado = 0;         // el cálculo de referencia por posición
+    int distintas = 0;             // posiciones en las que los dos no coinciden
+    double nsLegal = 0;            // movimientoLegal por llamada
+    long movimientos = 0;          // suma de mt.total (para comprobar y para que no se optimice)
+    long pseudoLegales = 0;
+};
+
+template <class Variante>
+ResultadoVariante medir(vector<EstadoPartida> &pos, int repeticiones){
+    ResultadoVariante r;
+    MovimientosTurno mt;
+
+    Reloj::time_point t0 = Reloj::now();
+    for (int k=0; k<repeticiones; ++k){
+        for (EstadoPartida &e : pos){
+            calcularMovimientosTurno<Variante>(mt, e.piezas, e.tablero, e.turno, e.flagsBlanco, e.flagsNegro);
+            if (k == 0) r.movimientos += mt.total;
+        }
+    }
+    r.nsTurno = chrono::duration<double, nano>(Reloj::now() - t0).count() / ((double)repeticiones * pos.size());
+
+    MovimientosTurno ref;
+    t0 = Reloj::now();
+    for (int k=0; k<repeticiones; ++k){
+        for (EstadoPartida &e : pos){
+            movimientosSimulados<Variante>(ref, e);
+            if (k > 0) continue;
+            calcularMovimientosTurno<Variante>(mt, e.piezas, e.tablero, e.turno, e.flagsBlanco, e.flagsNegro);
+            for (int o=0; o<FILAS*COLS; ++o){
+                if (mt.destinos[o] != ref.destinos[o]){ r.distintas++; break; }
+            }
+        }
+    }
+    r.nsSimulado = chrono::duration<double, nano>(Reloj::now() - t0).count() / ((double)repeticiones * pos.size());
+
+    long llamadas = 0;
+    t0 = Reloj::now();
+    for (int k=0; k<repeticiones; ++k){
+        for (EstadoPartida &e : pos){
+            for (int i=0; i<(int)e.piezas.size(); ++i){
+                if (!e.piezas[i].alive || e.piezas[i].color != e.turno) continue;
+                for (int d=0; d<FILAS*COLS; ++d){
+                    bool ok = movimientoLegal<Variante>(e.piezas, e.tablero, i, d / COLS, d % COLS, e.flagsBlanco, e.flagsNegro);
+                    if (k == 0) r.pseudoLegales += ok;
+                    llamadas++;
+                }
+            }
+        }
+    }
+    r.nsLegal = chrono::duration<double, nano>(Reloj::now() - t0).count() / (double)llamadas;
+    return r;
+}
+
+template <class Variante>
+void mostrar(const ResultadoVariante &r){
+    cout << Variante::nombre << ":\t" << r.nsTurno / 1000.0 << " us/turno\t" << r.nsLegal << " ns/movimientoLegal"
+         << "\tmovimientos " << r.movimientos << "\tpseudolegales " << r.pseudoLegales << "\n"
+         << "\tsimulando cada destino: " << r.nsSimulado / 1000.0 << " us/turno (" << r.nsSimulado / r.nsTurno << "x)"
+         << ", posiciones que no coinciden " << r.distintas << "\n";
+}
+
+int main(int argc, char** argv){
+    int posiciones = 2000, repeticiones = 5;
+    unsigned semilla = 7;
+    for (int i=1; i+1<argc; ++i){
+        string arg = argv[i];
+        if (arg == "--posiciones") posiciones = atoi(argv[++i]);
+        else if (arg == "--repeticiones") repeticiones = atoi(argv[++i]);
+        else if (arg == "--semilla") semilla = (unsigned)atoi(argv[++i]);
+    }
+    if (posiciones < 1) posiciones = 1;
+    if (repeticiones < 1) repeticiones = 1;
+
+    vector<EstadoPartida> pos = generarPosiciones(posiciones, semilla);
+
+    // posiciones en las que las dos variantes no dan los mismos movimientos
+    int distintas = 0;
+    for (EstadoPartida &e : pos){
+        MovimientosTurno a, b;
+        calcularMovimientosTurno<ReglasEstandar>(a, e.piezas, e.tablero, e.turno, e.flagsBlanco, e.flagsNegro);
+        calcularMovimientosTurno<ReglasAlmate>(b, e.piezas, e.tablero, e.turno, e.flagsBlanco, e.flagsNegro);
+        for (int o=0; o<FILAS*COLS; ++o){
+            if (a.destinos[o] != b.destinos[o]){ distintas++; break; }
+        }
+    }
+
+    // calentar y medir alternando para no favorecer a ninguna
+    medir<ReglasAlmate>(pos, 1);
+    ResultadoVariante est = medir<ReglasEstandar>(pos, repeticiones);
+    ResultadoVariante alm = medir<ReglasAlmate>(pos, repeticiones);
+
+    cout << pos.size() << " posiciones x " << repeticiones << " repeticiones\n";
+    mostrar<ReglasEstandar>(est);
+    mostrar<ReglasAlmate>(alm);
+    cout << "almate / estandar: turno " << alm.nsTurno / est.nsTurno << "x, movimientoLegal " << alm.nsLegal / est.nsLegal << "x\n"
+         << "posiciones con movimientos distintos (enroque extendido): " << distintas << "\n";
+
+    ResultadoControl ctl = medirControl(pos, repeticiones);
+    cout << "mapa de control: incremental " << ctl.nsIncremental << " ns/jugada (" << ctl.piezasRecalculadas << " piezas recalculadas)"
+         << ", desde cero " << ctl.nsCompleto << " ns (" << ctl.nsCompleto / ctl.nsIncremental << "x)"
+         << ", no coinciden " << ctl.distintas << ", ataques distintos de puedeAtacar " << ctl.ataquesDistintos << "\n";
+
+    vector<EstadoPartida> conGuardia = generarPosiciones(posiciones, semilla + 1, true);
+    vector<int> posicion;
+    vector<Jugada> jugadas;
+    generarConsultas(conGuardia, semilla, posicion, jugadas);
+    medirLote<ReglasAlmate>(conGuardia, posicion, jugadas, 1);
+    mostrarLote<ReglasEstandar>(medirLote<ReglasEstandar>(conGuardia, posicion, jugadas, repeticiones));
+    mostrarLote<ReglasAlmate>(medirLote<ReglasAlmate>(conGuardia, posicion, jugadas, repeticiones));
+
+    ResultadoHistorial hist = comprobarHistorial(posiciones / 50 + 1, semilla);
+    cout << "historial: " << hist.jugadas << " jugadas (" << hist.guardias << " con guardia deshechas y rehechas)"
+         << ", posiciones que no coinciden al deshacer, rehacer e ir a cada jugada " << hist.distintas << "\n";
+    return 0;
+}
@@ -0,0 +1,333 @@
+// Carga.cpp
+// Cliente de prueba de carga para Servidor.exe: abre 2*N conexiones (N partidas simultáneas) y
+// cada jugador simulado juega jugadas legales al azar cada cierto tiempo. Cuando una partida
+// acaba se abre otra para mantener N en juego. Al final muestra jugadas/s y la latencia
+// jugada -> OK (p50/p99/máx).
+// Con --comprobar-espectadores solo envía peticiones "VER" no válidas al puerto de espectadores
+// (--puerto + 1) y comprueba que el servidor las cierra enseguida, sin esperar a su plazo.
+// Requisitos: Linux (epoll).
+// Uso: Carga.exe [--host 127.0.0.1] [--puerto 5555] [--partidas 1000] [--intervalo 500]
+//                [--max-jugadas 120] [--duracion 30] [--comprobar-espectadores]
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <queue>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "Reglas.hpp"
+#include "Protocolo.hpp"
+using namespace std;
+
+typedef chrono::steady_clock Reloj;
+
+struct Jugador {
+    int fd = -1;
+    int lado = -1;                    // -1 hasta recibir PARTIDA
+    EstadoPartida estado;
+    string entrada;
+    string salida;
+    Jugada enviada;                   // esperando OK
+    bool esperandoOk = false;
+    Reloj::time_point enviadaEn;
+    int generacion = 0;               // invalida temporizadores de una conexión anterior
+};
+
+struct Temporizador {
+    Reloj::time_point cuando;
+    int jugador;
+    int generacion;
+    bool operator>(const Temporizador &o) const { return cuando > o.cuando; }
+};
+
+struct Carga {
+    sockaddr_in destino{};
+    int ep = -1;
+    int intervaloMs = 500;
+    int maxJugadas = 120;
+    vector<Jugador> jugadores;
+    priority_queue<Temporizador, vector<Temporizador>, greater<Temporizador>> temporizadores;
+    mt19937 azar{12345};
+
+    vector<float> latenciasMs;
+    long jugadas = 0, ilegales = 0, partidasTerminadas = 0, errores = 0;
+
+    bool conectar(int i){
+        Jugador &j = jugadores[i];
+        j.fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (j.fd < 0){ errores++; return false; }
+        if (connect(j.fd, (sockaddr*)&destino, sizeof(destino)) != 0){
+            close(j.fd); j.fd = -1; errores++;
+            return false;
+        }
+        int si = 1;
+        setsockopt(j.fd, IPPROTO_TCP, TCP_NODELAY, &si, sizeof(si));
+        fcntl(j.fd, F_SETFL, fcntl(j.fd, F_GETFL, 0) | O_NONBLOCK);
+        j.lado = -1;
+        j.entrada.clear();
+        j.salida.clear();
+        j.esperandoOk = false;
+        j.generacion++;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = (uint32_t)i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, j.fd, &ev);
+        return true;
+    }
+
+    void cerrar(int i){
+        Jugador &j = jugadores[i];
+        if (j.fd == -1) return;
+        epoll_ctl(ep, EPOLL_CTL_DEL, j.fd, nullptr);
+        close(j.fd);
+        j.fd = -1;
+    }
+
+    void enviar(int i, const string &linea){
+        Jugador &j = jugadores[i];
+        if (j.fd == -1) return;
+        j.salida += linea;
+        while (!j.salida.empty()){
+            ssize_t n = send(j.fd, j.salida.data(), j.salida.size(), MSG_NOSIGNAL);
+            if (n <= 0) break;
+            j.salida.erase(0, (size_t)n);
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN | (j.salida.empty() ? 0u : (uint32_t)EPOLLOUT);
+        ev.data.u32 = (uint32_t)i;
+        epoll_ctl(ep, EPOLL_CTL_MOD, j.fd, &ev);
+    }
+
+    void programar(int i){
+        int espera = intervaloMs / 2 + (int)(azar() % (unsigned)(intervaloMs + 1));
+        temporizadores.push({ Reloj::now() + chrono::milliseconds(espera), i, jugadores[i].generacion });
+    }
+
+    // Elige una jugada legal al azar (a veces con guardia) y la envía
+    void jugar(int i){
+        Jugador &j = jugadores[i];
+        if (j.fd == -1 || j.lado != (int)j.estado.turno || j.esperandoOk) return;
+        if (j.estado.jugadas >= maxJugadas){
+            cerrar(i);                // se da la partida por jugada; el servidor avisa al rival
+            partidasTerminadas++;
+            conectar(i);
+            return;
+        }
+        MovimientosTurno mt;
+        j.estado.movimientos(mt);
+        if (j.estado.resultado(mt) != ResultadoPartida::EnJuego) return;    // el servidor enviará FIN
+        int k = (int)(azar() % (unsigned)mt.total);
+        Jugada jug;
+        for (int o=0; o<FILAS*COLS && jug.origen == SIN_CASILLA; ++o){
+            for (uint64_t m = mt.destinos[o]; m; m &= m - 1){
+                if (k-- == 0){
+                    jug.origen = (uint8_t)o;
+                    jug.destino = (uint8_t)__builtin_ctzll(m);
+                    break;
+                }
+            }
+        }
+        const ReglasFlags &propios = (j.estado.turno == ColorPieza::White) ? j.estado.flagsBlanco : j.estado.flagsNegro;
+        if (!propios.guardiaUsado && azar() % 20 == 0) jug.guardia = jug.origen;
+        j.enviada = jug;
+        j.esperandoOk = true;
+        j.enviadaEn = Reloj::now();
+        enviar(i, "JUGADA " + jugadaATexto(jug) + "\n");
+    }
+
+    void procesarLinea(int i, const string &linea){
+        Jugador &j = jugadores[i];
+        if (linea.compare(0, 8, "PARTIDA ") == 0){
+            j.lado = (linea.find("BLANCAS") != string::npos) ? 0 : 1;
+            j.estado.iniciar();
+            if (j.lado == 0) programar(i);
+        } else if (linea == "OK"){
+            float ms = chrono::duration<float, milli>(Reloj::now() - j.enviadaEn).count();
+            latenciasMs.push_back(ms);
+            j.esperandoOk = false;
+            if (!j.estado.jugar(j.enviada)) errores++;   // el servidor y el cliente no coinciden
+            jugadas++;
+        } else if (linea.compare(0, 7, "ILEGAL ") == 0){
+            ilegales++;
+            j.esperandoOk = false;
+            programar(i);
+        } else if (linea.compare(0, 7, "JUGADA ") == 0){
+            Jugada rival;
+            if (!textoAJugada(linea.substr(7), rival) || !j.estado.jugar(rival)){ errores++; return; }
+            programar(i);
+        } else if (linea.compare(0, 4, "FIN ") == 0){
+            if (linea != "FIN ABANDONO" && j.lado == 0) partidasTerminadas++;   // mate o ahogado
+            cerrar(i);
+            conectar(i);
+        }
+    }
+
+    void leer(int i){
+        char buf[4096];
+        for (;;){
+            Jugador &j = jugadores[i];
+            if (j.fd == -1) return;
+            ssize_t n = recv(j.fd, buf, sizeof(buf), 0);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            if (n <= 0){
+                // el servidor cerró: la partida se abandonó (el rival llegó al límite de jugadas)
+                cerrar(i);
+                conectar(i);
+                return;
+            }
+            int gen = j.generacion;
+            for (ssize_t k=0; k<n; ++k){
+                if (buf[k] == '\n'){
+                    procesarLinea(i, jugadores[i].entrada);
+                    if (jugadores[i].generacion != gen) return;   // se reconectó
+                    jugadores[i].entrada.clear();
+                } else {
+                    jugadores[i].entrada += buf[k];
+                }
+            }
+        }
+    }
+
+    void ejecutar(int segundos){
+        Reloj::time_point fin = Reloj::now() + chrono::seconds(segundos);
+        epoll_event eventos[256];
+        while (Reloj::now() < fin){
+            int espera = 50;
+            if (!temporizadores.empty()){
+                auto falta = chrono::duration_cast<chrono::milliseconds>(temporizadores.top().cuando - Reloj::now()).count();
+                espera = (int)std::max<long long>(0, std::min<long long>(espera, falta));
+            }
+            int n = epoll_wait(ep, eventos, 256, espera);
+            for (int e=0; e<n; ++e){
+                int i = (int)eventos[e].data.u32;
+                if (eventos[e].events & EPOLLOUT) enviar(i, "");
+                if (eventos[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) leer(i);
+            }
+            Reloj::time_point ahora = Reloj::now();
+            while (!temporizadores.empty() && temporizadores.top().cuando <= ahora){
+                Temporizador t = temporizadores.top();
+                temporizadores.pop();
+                if (jugadores[t.jugador].generacion == t.generacion) jugar(t.jugador);
+            }
+        }
+    }
+};
+
+// ---------------------- Peticiones de espectador no válidas ----------------------
+// El servidor da 2 s para enviar "VER <id>"; una línea completa que no lo es debe cerrarse ya.
+const int CIERRE_MAXIMO_MS = 500;
+
+// Milisegundos hasta que el servidor cierra tras recibir la línea; -1 si no cierra a tiempo
+int esperarCierre(const sockaddr_in &destino, const string &linea){
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (const sockaddr*)&destino, sizeof(destino)) != 0){ close(fd); return -1; }
+    timeval limite{1, 500000};            // menos que el plazo del servidor: cerrar por él no vale
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite));
+    Reloj::time_point inicio = Reloj::now();
+    int ms = -1;
+    if (send(fd, linea.data(), linea.size(), 0) == (ssize_t)linea.size()){
+        char buf[256];
+        for (;;){
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n > 0) continue;
+            if (n == 0 || errno == ECONNRESET)
+                ms = (int)chrono::duration_cast<chrono::milliseconds>(Reloj::now() - inicio).count();
+            break;
+        }
+    }
+    close(fd);
+    return ms;
+}
+
+int comprobarEspectadores(sockaddr_in destino){
+    destino.sin_port = htons((uint16_t)(ntohs(destino.sin_port) + 1));
+    const char* lineas[] = { "HOLA\n", "VER\n", "VER x\n", "VER 0\n", "VER -3\r\n" };
+    int fallos = 0;
+    for (const char* l : lineas){
+        string linea = l;
+        int ms = esperarCierre(destino, linea);
+        bool bien = ms >= 0 && ms < CIERRE_MAXIMO_MS;
+        if (!bien) fallos++;
+        linea.erase(linea.find_last_not_of("\r\n") + 1);
+        cout << "\"" << linea << "\": " << (ms < 0 ? string("no cerrada") : "cerrada en " + to_string(ms) + " ms")
+             << (bien ? "" : "  <-- FALLO") << "\n";
+    }
+    cout << "peticiones no válidas sin cerrar a tiempo: " << fallos << "\n";
+    return fallos ? 2 : 0;
+}
+
+int main(int argc, char** argv){
+    string host = "127.0.0.1";
+    int puerto = PUERTO_POR_DEFECTO;
+    int partidas = 1000, duracion = 30;
+    bool soloEspectadores = false;
+    Carga carga;
+    for (int i=1; i<argc; ++i){
+        string arg = argv[i];
+        if (arg == "--comprobar-espectadores"){ soloEspectadores = true; continue; }
+        if (i+1 >= argc) break;
+        if (arg == "--host") host = argv[++i];
+        else if (arg == "--puerto") puerto = atoi(argv[++i]);
+        else if (arg == "--partidas") partidas = atoi(argv[++i]);
+        else if (arg == "--intervalo") carga.intervaloMs = atoi(argv[++i]);
+        else if (arg == "--max-jugadas") carga.maxJugadas = atoi(argv[++i]);
+        else if (arg == "--duracion") duracion = atoi(argv[++i]);
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0){
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+        if ((rlim_t)(2 * partidas + 16) > lim.rlim_cur)
+            cerr << "Aviso: el límite de descriptores (" << lim.rlim_cur << ") no llega para " << partidas << " partidas\n";
+    }
+
+    carga.destino.sin_family = AF_INET;
+    carga.destino.sin_port = htons((uint16_t)puerto);
+    if (inet_pton(AF_INET, host.c_str(), &carga.destino.sin_addr) != 1){
+        cerr << "Dirección no válida: " << host << "\n";
+        return 1;
+    }
+    if (soloEspectadores) return comprobarEspectadores(carga.destino);
+    carga.ep = epoll_create1(0);
+    carga.jugadores.resize(2 * partidas);
+    carga.latenciasMs.reserve(1 << 20);
+
+    Reloj::time_point inicio = Reloj::now();
+    for (int i=0; i<2*partidas; ++i){
+        if (!carga.conectar(i)){
+            cerr << "No se pudo conectar el jugador " << i << ": " << strerror(errno) << "\n";
+            return 1;
+        }
+    }
+    float msConexion = chrono::duration<float, milli>(Reloj::now() - inicio).count();
+    cout << 2*partidas << " conexiones abiertas en " << msConexion << " ms\n";
+
+    carga.ejecutar(duracion);
+
+    vector<float> &l = carga.latenciasMs;
+    sort(l.begin(), l.end());
+    auto percentil = [&](float q){ return l.empty() ? 0.f : l[std::min(l.size()-1, (size_t)(q * (l.size()-1)))]; };
+    cout << "partidas simultáneas " << partidas << " | terminadas " << carga.partidasTerminadas << "\n"
+         << "jugadas " << carga.jugadas << " (" << carga.jugadas / std::max(1, duracion) << "/s)"
+         << " | ilegales " << carga.ilegales << " | errores " << carga.errores << "\n"
+         << "latencia jugada->OK ms: p50 " << percentil(0.50f) << " p99 " << percentil(0.99f)
+         << " max " << (l.empty() ? 0.f : l.back()) << "\n";
+    return (carga.ilegales == 0 && carga.errores == 0) ? 0 : 2;
+}
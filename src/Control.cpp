@@ -0,0 +1,165 @@
+// Control.cpp
+// Mapa de control incremental (libalmate): atacantes de cada bando por casilla. Ver Control.hpp.
+
+#include "Control.hpp"
+#include <cstring>
+
+// suma de 'casillas' (1 en cada una) a las cuentas en planos de bits, con acarreo
+void MapaControl::sumar(ColorPieza lado, uint64_t casillas){
+    uint64_t *p = planos[(int)lado];
+    for (int b=0; b<BITS_CUENTA && casillas; ++b){
+        uint64_t acarreo = p[b] & casillas;
+        p[b] ^= casillas;
+        casillas = acarreo;
+    }
+}
+
+void MapaControl::restar(ColorPieza lado, uint64_t casillas){
+    uint64_t *p = planos[(int)lado];
+    for (int b=0; b<BITS_CUENTA && casillas; ++b){
+        uint64_t prestamo = ~p[b] & casillas;
+        p[b] ^= casillas;
+        casillas = prestamo;
+    }
+}
+
+// Rayos de las deslizantes en el orden de Reglas.cpp: 0-3 de torre, 4-7 de alfil
+static const int DIRECCIONES[8][2] = { {-1,0}, {1,0}, {0,-1}, {0,1}, {-1,-1}, {-1,1}, {1,-1}, {1,1} };
+
+// RAYOS[s][d]: las casillas desde s (sin ella) hasta el borde en la dirección d
+struct Rayos {
+    uint64_t r[FILAS*COLS][8] = {};
+    Rayos(){
+        for (int s=0; s<FILAS*COLS; ++s)
+            for (int d=0; d<8; ++d)
+                for (int f = s / COLS + DIRECCIONES[d][0], c = s % COLS + DIRECCIONES[d][1]; dentroTablero(f,c);
+                     f += DIRECCIONES[d][0], c += DIRECCIONES[d][1]) r[s][d] |= bitCasilla(f,c);
+    }
+};
+static const Rayos RAYOS;
+
+// Lo que ataca el rayo d desde s con estas casillas ocupadas: hasta la primera, incluida. En las
+// direcciones hacia índices mayores es el bit más bajo de las ocupadas del rayo, y al revés.
+static uint64_t rayo(int s, int d, uint64_t ocupadas){
+    uint64_t r = RAYOS.r[s][d], tope = r & ocupadas;
+    if (!tope) return r;
+    bool crece = DIRECCIONES[d][0] * COLS + DIRECCIONES[d][1] > 0;
+    int t = crece ? __builtin_ctzll(tope) : 63 - __builtin_clzll(tope);
+    return r & ~RAYOS.r[t][d];
+}
+
+// 64 bytes a 0 o 1 a un bit por casilla, de 8 en 8: la multiplicación lleva el byte j al bit 56+j
+// (memoria little endian, como en x86 y ARM)
+static uint64_t aBits(const uint8_t *b){
+    uint64_t r = 0;
+    for (int k=0; k<8; ++k){
+        uint64_t x;
+        memcpy(&x, b + 8*k, 8);
+        r |= ((x * 0x0102040810204080ULL) >> 56) << (8*k);
+    }
+    return r;
+}
+
+static bool esDeslizante(TipoPieza t){
+    return t == TipoPieza::Rook || t == TipoPieza::Bishop || t == TipoPieza::Queen;
+}
+
+void MapaControl::iniciar(const vector<Pieza>& piezas, const Tablero& tablero){
+    anterior = tablero;
+    for (int lado=0; lado<2; ++lado)
+        for (int b=0; b<BITS_CUENTA; ++b) planos[lado][b] = 0;
+    ataques.assign(piezas.size(), 0);
+    tipoPieza.assign(piezas.size(), 0);
+    deslizantes = coronables = 0;
+    int peones[2] = {0, 0};
+    for (int i=0; i<(int)piezas.size(); ++i){
+        const Pieza &p = piezas[i];
+        tipoPieza[i] = (uint8_t)p.tipo;
+        if (p.tipo == TipoPieza::Pawn) peones[(int)p.color]++;
+        if (!p.alive) continue;
+        ataques[i] = casillasAtacadas(piezas, tablero, i);
+        sumar(p.color, ataques[i]);
+        if (i < 64 && esDeslizante(p.tipo)) deslizantes |= 1ULL << i;
+    }
+    // con menos de 8 peones de un bando, cualquiera de sus piezas (menos el rey) puede ser uno coronado
+    for (int i=0; i<(int)piezas.size() && i<64; ++i){
+        const Pieza &p = piezas[i];
+        if (p.tipo == TipoPieza::Pawn || (peones[(int)p.color] < 8 && p.tipo != TipoPieza::King)) coronables |= 1ULL << i;
+    }
+}
+
+// Solo las casillas que dejó de atacar o empezó a atacar
+void MapaControl::cambiar(ColorPieza lado, int i, uint64_t nuevos){
+    restar(lado, ataques[i] & ~nuevos);
+    sumar(lado, nuevos & ~ataques[i]);
+    ataques[i] = nuevos;
+}
+
+void MapaControl::recalcular(const vector<Pieza>& piezas, const Tablero& tablero, int i){
+    const Pieza &p = piezas[i];
+    cambiar(p.color, i, casillasAtacadas(piezas, tablero, i));
+    tipoPieza[i] = (uint8_t)p.tipo;
+    if (i >= 64) return;
+    deslizantes = (deslizantes & ~(1ULL << i)) | ((uint64_t)(p.alive && esDeslizante(p.tipo)) << i);
+    coronables |= (uint64_t)(p.tipo == TipoPieza::Pawn) << i;
+}
+
+// Un rayo que después de la jugada cruza una casilla cambiada ya alcanzaba antes la primera de
+// ellas (las de delante no cambiaron y siguen vacías), así que basta con mirar los ataques
+// guardados de las deslizantes, y de cada una solo se rehacen esos rayos. Peones, caballos y
+// reyes atacan lo mismo mientras no se muevan. Las piezas que se movieron, salieron o volvieron
+// salen de las casillas cambiadas, sin recorrer las 32. El tipo solo puede cambiar sin moverse
+// (una coronación deshecha y rehecha con otra pieza mientras la capa estaba oculta) en lo que
+// puede haber sido un peón y sigue en el tablero: una pieza en el tablero siempre ataca alguna
+// casilla.
+int MapaControl::actualizar(const vector<Pieza>& piezas, const Tablero& tablero){
+    if (ataques.size() != piezas.size() || piezas.size() > 64){
+        iniciar(piezas, tablero);
+        return (int)piezas.size();
+    }
+
+    const int *ahora = &tablero.casillas[0][0], *antes = &anterior.casillas[0][0];
+    uint8_t distinta[FILAS*COLS], llena[FILAS*COLS];
+    for (int s=0; s<FILAS*COLS; ++s){
+        distinta[s] = ahora[s] != antes[s];
+        llena[s] = ahora[s] != -1;
+    }
+    uint64_t cambiadas = aBits(distinta), ocupadas = aBits(llena);
+
+    uint64_t movidas = 0;
+    for (uint64_t m = cambiadas; m; m &= m - 1){
+        int s = __builtin_ctzll(m);
+        if (antes[s] >= 0) movidas |= 1ULL << antes[s];
+        if (ahora[s] >= 0) movidas |= 1ULL << ahora[s];
+    }
+    anterior = tablero;
+    for (uint64_t m = coronables & ~movidas; m; m &= m - 1){
+        int i = __builtin_ctzll(m);
+        if (ataques[i] && tipoPieza[i] != (uint8_t)piezas[i].tipo) movidas |= 1ULL << i;
+    }
+
+    int recalculadas = 0;
+    for (uint64_t m = movidas; m; m &= m - 1){
+        recalcular(piezas, tablero, __builtin_ctzll(m));
+        recalculadas++;
+    }
+    for (uint64_t m = deslizantes & ~movidas; m; m &= m - 1){
+        int i = __builtin_ctzll(m);
+        if (!(ataques[i] & cambiadas)) continue;
+        const Pieza &p = piezas[i];
+        int s = indiceCasilla(p.fila, p.col);
+        int d0 = (p.tipo == TipoPieza::Bishop) ? 4 : 0, d1 = (p.tipo == TipoPieza::Rook) ? 4 : 8;
+        uint64_t nuevos = ataques[i];
+        for (int d=d0; d<d1; ++d)
+            if (ataques[i] & RAYOS.r[s][d] & cambiadas) nuevos = (nuevos & ~RAYOS.r[s][d]) | rayo(s, d, ocupadas);
+        cambiar(p.color, i, nuevos);
+        recalculadas++;
+    }
+    return recalculadas;
+}
+
+int MapaControl::atacantes(const vector<Pieza>& piezas, ColorPieza lado, int casilla) const {
+    int i = anterior[casilla / COLS][casilla % COLS];
+    if (i != -1 && piezas[i].protegido && piezas[i].color != lado) return 0;
+    return cuentaBruta(lado, casilla);
+}
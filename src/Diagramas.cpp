@@ -0,0 +1,212 @@
+// Diagramas.cpp
+// Dibuja posiciones en PNG sin ventana visible (sf::RenderTexture), con las mismas texturas y la
+// misma colocación que el juego (Graficos.hpp): sirve para las miniaturas de la galería y los
+// diagramas de cada partida. Este hilo dibuja y lee los píxeles de la textura; varios hilos
+// comprimen y escriben los PNG, así que el dibujo de una posición se solapa con la compresión
+// de las anteriores. Como mucho hay --en-vuelo imágenes esperando.
+// Entrada: una posición por línea (FEN con el campo opcional de Almate, ver Protocolo.hpp) o,
+// con --partidas, una partida por línea en la notación del protocolo ("e2e4 e7e5 ..."), de la
+// que se dibuja la posición final. Cada línea válida da <salida>/<número de línea>.png.
+// Uso: Diagramas.exe [posiciones.txt | --partidas partidas.txt] [--salida diagramas] [--tam 280]
+//                    [--hilos N] [--en-vuelo 32]
+
+#include <SFML/Graphics.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <filesystem>
+#include <cstdio>
+#include <cstdlib>
+#include "Protocolo.hpp"
+#include "Graficos.hpp"
+using namespace std;
+
+typedef chrono::steady_clock Reloj;
+
+// ---------------------- Entrada ----------------------
+// Posición final de una partida en la notación del protocolo; false si alguna jugada no es legal
+bool jugarPartida(const string &linea, EstadoPartida &e, string &error){
+    e.iniciar();
+    istringstream in(linea);
+    string txt;
+    while (in >> txt){
+        Jugada j;
+        if (!textoAJugada(txt, j) || !e.jugar(j)){ error = "jugada no válida: " + txt; return false; }
+    }
+    return true;
+}
+
+// ---------------------- Dibujo ----------------------
+// Una textura de tam x tam con la vista puesta sobre el tablero: las coordenadas son las de la
+// ventana del juego, así que centrarYescalar coloca las piezas igual que allí.
+struct Dibujante {
+    map<string, sf::Texture> tex;
+    sf::Sprite tablero;
+    map<string, sf::Sprite> piezas;
+    sf::RenderTexture lienzo;
+
+    bool iniciar(unsigned tam){
+        const char* nombres[] = { "PeonB","PeonR","TorreB","TorreR","CaballoB","CaballoR",
+                                  "AlfilB","AlfilR","DamaB","DamaR","ReyB","ReyR","Tablero" };
+        for (const char* n : nombres){
+            if (!cargarTxt(tex[n], string("assets/images/") + n + ".png")) return false;
+            tex[n].setSmooth(true);
+        }
+        inicializarTablero(tablero, tex);
+
+        for (auto &t : tex){
+            if (t.first == "Tablero") continue;
+            sf::Sprite &s = piezas[t.first];
+            s.setTexture(t.second);
+            s.setScale((float)TAM_CASILLA / (float)t.second.getSize().x, (float)TAM_CASILLA / (float)t.second.getSize().y);
+        }
+
+        if (!lienzo.create(tam, tam)) return false;
+        lienzo.setSmooth(true);
+        lienzo.setView(sf::View(sf::FloatRect((float)TABLERO_X, (float)TABLERO_Y, 8.0f * TAM_CASILLA, 8.0f * TAM_CASILLA)));
+        return true;
+    }
+
+    void dibujar(const EstadoPartida &e, sf::Image &imagen){
+        lienzo.clear();
+        lienzo.draw(tablero);
+        for (const Pieza &p : e.piezas){
+            if (!p.alive) continue;
+            sf::Sprite &s = piezas[claveTextura(p.tipo, p.color)];
+            centrarYescalar(s, p.fila, p.col);
+            lienzo.draw(s);
+        }
+        lienzo.display();
+        imagen = lienzo.getTexture().copyToImage();
+    }
+};
+
+// ---------------------- Compresión ----------------------
+// Ranuras con la imagen leída y su ruta: este hilo llena las libres y los trabajadores
+// comprimen las llenas y las devuelven.
+struct Ranura {
+    sf::Image imagen;
+    string ruta;
+};
+
+int main(int argc, char** argv){
+    string entrada, salida = "diagramas";
+    bool partidas = false;
+    unsigned tam = 280;
+    int hilos = (int)thread::hardware_concurrency();
+    int enVuelo = 32;
+    for (int i=1; i<argc; ++i){
+        string arg = argv[i];
+        if (arg == "--partidas" && i+1 < argc){ entrada = argv[++i]; partidas = true; }
+        else if (arg == "--salida" && i+1 < argc) salida = argv[++i];
+        else if (arg == "--tam" && i+1 < argc) tam = (unsigned)atoi(argv[++i]);
+        else if (arg == "--hilos" && i+1 < argc) hilos = atoi(argv[++i]);
+        else if (arg == "--en-vuelo" && i+1 < argc) enVuelo = atoi(argv[++i]);
+        else entrada = arg;
+    }
+    if (hilos < 1) hilos = 1;
+    if (enVuelo < 1) enVuelo = 1;
+    if (tam < 16) tam = 16;
+    if (entrada.empty()){ cerr << "Uso: Diagramas.exe [posiciones.txt | --partidas partidas.txt] [--salida dir] [--tam 280] [--hilos N]\n"; return 1; }
+
+    ifstream in(entrada);
+    if (!in){ cerr << "No se puede abrir " << entrada << "\n"; return 1; }
+    std::error_code ec;
+    filesystem::create_directories(salida, ec);
+
+    Dibujante dibujante;
+    if (!dibujante.iniciar(tam)){ cerr << "No se pudo preparar el dibujo\n"; return 1; }
+
+    vector<Ranura> ranuras(enVuelo);
+    deque<int> libres, llenas;
+    for (int k=0; k<enVuelo; ++k) libres.push_back(k);
+    mutex m;
+    condition_variable cv;
+    bool fin = false;
+    long escritas = 0, fallidas = 0;
+
+    vector<thread> trabajadores;
+    for (int h=0; h<hilos; ++h){
+        trabajadores.emplace_back([&](){
+            for (;;){
+                int k;
+                {
+                    unique_lock<mutex> lock(m);
+                    cv.wait(lock, [&]{ return !llenas.empty() || fin; });
+                    if (llenas.empty()) return;
+                    k = llenas.front();
+                    llenas.pop_front();
+                }
+                bool ok = ranuras[k].imagen.saveToFile(ranuras[k].ruta);
+                {
+                    lock_guard<mutex> lock(m);
+                    if (ok) escritas++;
+                    else fallidas++;
+                    libres.push_back(k);
+                }
+                cv.notify_all();
+            }
+        });
+    }
+
+    // dibujar (y leer la textura) en este hilo: el contexto de OpenGL es suyo
+    Reloj::time_point t0 = Reloj::now();
+    double segundosDibujo = 0, segundosEspera = 0;
+    long numLinea = 0, malas = 0;
+    EstadoPartida e;
+    string linea, error;
+    char nombre[32];
+    while (getline(in, linea)){
+        numLinea++;
+        if (!linea.empty() && linea.back() == '\r') linea.pop_back();
+        if (linea.empty() || linea[0] == '#') continue;
+        bool ok = partidas ? jugarPartida(linea, e, error) : textoAPosicion(linea, e, error);
+        if (!ok){
+            if (malas++ < 10) cerr << "línea " << numLinea << ": " << error << "\n";
+            continue;
+        }
+
+        Reloj::time_point t1 = Reloj::now();
+        int k;
+        {
+            unique_lock<mutex> lock(m);
+            cv.wait(lock, [&]{ return !libres.empty(); });
+            k = libres.front();
+            libres.pop_front();
+        }
+        Reloj::time_point t2 = Reloj::now();
+        dibujante.dibujar(e, ranuras[k].imagen);
+        snprintf(nombre, sizeof(nombre), "/%06ld.png", numLinea);
+        ranuras[k].ruta = salida + nombre;
+        segundosEspera += chrono::duration<double>(t2 - t1).count();
+        segundosDibujo += chrono::duration<double>(Reloj::now() - t2).count();
+        {
+            lock_guard<mutex> lock(m);
+            llenas.push_back(k);
+        }
+        cv.notify_all();
+    }
+    {
+        lock_guard<mutex> lock(m);
+        fin = true;
+    }
+    cv.notify_all();
+    for (thread &t : trabajadores) t.join();
+
+    double segundos = chrono::duration<double>(Reloj::now() - t0).count();
+    cout << escritas << " diagramas de " << tam << "x" << tam << " en " << salida << "/ en " << segundos << " s ("
+         << escritas / segundos << "/s), " << hilos << " hilos de compresión\n"
+         << "dibujo y lectura " << segundosDibujo << " s | esperando ranura libre " << segundosEspera << " s";
+    if (malas) cout << " | líneas no válidas " << malas;
+    if (fallidas) cout << " | no se pudieron escribir " << fallidas;
+    cout << "\n";
+    return fallidas ? 1 : 0;
+}
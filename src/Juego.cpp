@@ -9,392 +9,129 @@
 #include <map>
 #include <string>
 #include <cmath>
+#include <cstdint>
+#include "Reglas.hpp"
+#include "Tablas.hpp"
+#include "Historial.hpp"
+#include "Graficos.hpp"
+#include "Perfil.hpp"      // incluye Asignaciones.hpp
+#include "Sesion.hpp"
+#include "Animaciones.hpp"
+#include "CapaControl.hpp"
+#include "Reloj.hpp"
+#include "MarcadorReloj.hpp"
+#include "Red.hpp"
+#include "Diario.hpp"
 using namespace std;
 
-// ---------------------- Configuración ----------------------
-const int TAM_CASILLA = 70;
-const int TABLERO_X   = 381; // coordenada X del tablero (sin márgenes)
-const int TABLERO_Y   = 50;  // coordenada Y del tablero (sin márgenes)
-const int FILAS = 8;
-const int COLS  = 8;
+// medias jugadas con memoria reservada de antemano en el historial
+const int JUGADAS_RESERVADAS = 1024;
 
-// tolerancia (px) para aceptar un "drop" en la casilla más cercana
-const float RADIO_ACEPTACION = 40.0f;
-
-// animación captura
-const float DURACION_ANIMACION_CAPTURA = 0.30f; // segundos
-
-// dot color
-const sf::Color DOT_COLOR(200, 200, 255, 220);
-
-// ---------------------- Tipos ----------------------
-enum class TipoPieza { Pawn, Rook, Knight, Bishop, Queen, King };
-enum class ColorPieza { White, Black };
-
-struct Pieza {
-    string id;           // id único
-    TipoPieza tipo;
-    ColorPieza color;
-    int fila, col;       // posición lógica (-1,-1 si fuera)
-    sf::Sprite sprite;
-
-    // para animaciones / restaurar escala
-    float baseSx = 1.0f;
-    float baseSy = 1.0f;
-
-    bool alive = true;
-    bool animandoCaptura = false;
-    sf::Clock animClock;
-
-    // si la pieza ya se movió (importante para enroque)
-    bool hasMoved = false;
-
-    // protección "guardia": si true, no puede ser capturada durante el turno de protección activo
-    bool protegido = false;
-};
-
-// tablero lógico: índice de vector piezas, o -1 si vacío
-int tableroLogico[FILAS][COLS];
-
-// ---------------------- Helpers ----------------------
-bool dentroTablero(int f,int c){ return f>=0 && f<FILAS && c>=0 && c<COLS; }
-
-sf::Vector2f centroCasilla(int fila,int col){
-    float x = TABLERO_X + col * TAM_CASILLA + TAM_CASILLA / 2.0f;
-    float y = TABLERO_Y + fila * TAM_CASILLA + TAM_CASILLA / 2.0f;
-    return {x,y};
-}
-
-pair<int,int> casillaMasCercana(float px, float py){
-    float fx = (px - TABLERO_X) / (float)TAM_CASILLA;
-    float fy = (py - TABLERO_Y) / (float)TAM_CASILLA;
-    int c = (int)floor(fx + 0.5f);
-    int r = (int)floor(fy + 0.5f);
-    if (r<0) r=0; if (r>FILAS-1) r=FILAS-1;
-    if (c<0) c=0; if (c>COLS-1) c=COLS-1;
-    return {r,c};
-}
-
-bool cargarTxt(sf::Texture &t, const string &ruta){
-    if(!t.loadFromFile(ruta)){
-        cerr << "No se pudo cargar: " << ruta << "\n";
-        return false;
-    }
-    return true;
-}
-
-// ---------------------- Movimiento / reglas ----------------------
-bool lineaLibre(int f1,int c1,int f2,int c2){
-    int dx = (c2>c1)?1: (c2<c1)? -1: 0;
-    int dy = (f2>f1)?1: (f2<f1)? -1: 0;
-    int x = c1 + dx;
-    int y = f1 + dy;
-    while(x != c2 || y != f2){
-        if (!dentroTablero(y,x)) return false;
-        if (tableroLogico[y][x] != -1) return false;
-        x += dx; y += dy;
-    }
-    return true;
-}
-
-// Versión ligera para atacar (sin enroque)
-bool puedeAtacar(const vector<Pieza>& piezas, int attIdx, int f, int c){
-    if (attIdx < 0 || attIdx >= (int)piezas.size()) return false;
-    const Pieza &p = piezas[attIdx];
-    if (!p.alive) return false;
-    int sF = p.fila, sC = p.col;
-    if (!dentroTablero(sF,sC)) return false;
-    int dx = c - sC;
-    int dy = f - sF;
-    int adx = abs(dx), ady = abs(dy);
-
-    switch(p.tipo){
-        case TipoPieza::Pawn: {
-            int dir = (p.color == ColorPieza::White) ? -1 : 1;
-            if (ady==1 && adx==1 && dy==dir) return true;
-            return false;
-        }
-        case TipoPieza::Rook: {
-            if (dx!=0 && dy!=0) return false;
-            return lineaLibre(sF,sC,f,c);
-        }
-        case TipoPieza::Bishop: {
-            if (adx!=ady) return false;
-            return lineaLibre(sF,sC,f,c);
-        }
-        case TipoPieza::Queen: {
-            if (!((dx==0) || (dy==0) || (adx==ady))) return false;
-            return lineaLibre(sF,sC,f,c);
-        }
-        case TipoPieza::Knight: {
-            if ((adx==1 && ady==2) || (adx==2 && ady==1)) return true;
-            return false;
-        }
-        case TipoPieza::King: {
-            if (adx<=1 && ady<=1) return true;
-            return false;
-        }
-    }
-    return false;
-}
-
-bool estaCasillaAtacada(const vector<Pieza>& piezas, ColorPieza colorAtacante, int f, int c){
-    for (int i=0;i<(int)piezas.size();++i){
-        if (!piezas[i].alive) continue;
-        if (piezas[i].color != colorAtacante) continue;
-        if (puedeAtacar(piezas, i, f, c)) return true;
-    }
-    return false;
-}
-
-// Flags de reglas especiales por jugador
-struct ReglasFlags {
-    bool guardiaUsado = false;           // 1 vez por juego
-    int  guardiaIdx = -1;                // índice pieza protegida
-    bool proteccionActiva = false;       // protección corre durante el turno completo del rival
-    ColorPieza proteccionTurnoDe = ColorPieza::White; // quién está protegido este turno
-
-    bool enroque3Usado = false;          // 1 vez por juego (enroque extendido)
-};
-
-// Core: movimiento legal (incluye enroque normal y extendido, y bloquea captura de pieza protegida)
-bool movimientoLegal(const vector<Pieza>& piezas, int idx, int dstF, int dstC, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro){
-    if (!dentroTablero(dstF,dstC)) return false;
-    const Pieza &p = piezas[idx];
-    if (!p.alive) return false;
-    int sF = p.fila, sC = p.col;
-    if (sF==dstF && sC==dstC) return false;
-
-    // no capturar propia pieza
-    if (tableroLogico[dstF][dstC] != -1){
-        int occ = tableroLogico[dstF][dstC];
-        if (occ >= 0 && piezas[occ].color == p.color) return false;
-
-        // Regla 1: pieza protegida no puede ser capturada durante el turno de protección
-        const ReglasFlags& flagsOponente = (p.color == ColorPieza::White) ? flagsNegro : flagsBlanco;
-        if (flagsOponente.proteccionActiva && flagsOponente.guardiaIdx == occ){
-            // La captura se ignora este turno: el movimiento a casilla ocupada por protegido no es legal
-            return false;
-        }
-    }
-
-    int dx = dstC - sC;
-    int dy = dstF - sF;
-    int adx = abs(dx), ady = abs(dy);
-
-    switch(p.tipo){
-        case TipoPieza::Pawn: {
-            int dir = (p.color == ColorPieza::White) ? -1 : 1; // white sube (fila decrece)
-            if (dx==0 && dy==dir && tableroLogico[dstF][dstC]==-1) return true;
-            if (dx==0 && dy==2*dir){
-                bool inicio = (p.color==ColorPieza::White)? (sF==6) : (sF==1);
-                if (!inicio) return false;
-                int midF = sF + dir;
-                if (tableroLogico[midF][sC]==-1 && tableroLogico[dstF][dstC]==-1) return true;
-                return false;
-            }
-            if (abs(dx)==1 && dy==dir && tableroLogico[dstF][dstC]!=-1){
-                int occ = tableroLogico[dstF][dstC];
-                if (occ>=0 && piezas[occ].color != p.color){
-                    // también respeta protección del oponente (ya validado arriba)
-                    return true;
-                }
-            }
-            return false;
-        }
-        case TipoPieza::Rook: {
-            if (dx!=0 && dy!=0) return false;
-            if (!lineaLibre(sF,sC,dstF,dstC)) return false;
-            return true;
-        }
-        case TipoPieza::Bishop: {
-            if (adx!=ady) return false;
-            if (!lineaLibre(sF,sC,dstF,dstC)) return false;
-            return true;
-        }
-        case TipoPieza::Queen: {
-            if (!((dx==0) || (dy==0) || (adx==ady))) return false;
-            if (!lineaLibre(sF,sC,dstF,dstC)) return false;
-            return true;
-        }
-        case TipoPieza::Knight: {
-            if ((adx==1 && ady==2) || (adx==2 && ady==1)) return true;
-            return false;
-        }
-        case TipoPieza::King: {
-            // movimiento normal de 1 casilla
-            if (adx<=1 && ady<=1) return true;
-
-            // --- enroque normal (2 casillas) ---
-            if (ady==0 && (adx==2)){
-                if (p.hasMoved) return false;
-                int dir = (dx>0)? 1 : -1;
-                int rookCol = (dir>0) ? 7 : 0;
-                if (!dentroTablero(sF, rookCol)) return false;
-                int rookIdx = tableroLogico[sF][rookCol];
-                if (rookIdx == -1) return false;
-                const Pieza &r = piezas[rookIdx];
-                if (!r.alive || r.tipo != TipoPieza::Rook || r.color != p.color || r.hasMoved) return false;
-
-                // camino libre
-                for (int cc = (dir>0? sC+1 : rookCol+1); cc < (dir>0? rookCol : sC); ++cc){
-                    if (tableroLogico[sF][cc] != -1) return false;
-                }
-
-                // casillas del rey no deben estar atacadas
-                ColorPieza enemigo = (p.color==ColorPieza::White)? ColorPieza::Black : ColorPieza::White;
-                if (estaCasillaAtacada(piezas, enemigo, sF, sC)) return false;
-                int passC = sC + dir;
-                int finalC = sC + 2*dir;
-                if (estaCasillaAtacada(piezas, enemigo, sF, passC)) return false;
-                if (estaCasillaAtacada(piezas, enemigo, sF, finalC)) return false;
-                return true;
-            }
-
-            // --- Regla 2: enroque extendido (3 casillas) una vez por jugador ---
-            if (ady==0 && (adx==3)){
-                // Nota: validación de "una vez por partida" se hace antes de aplicar movimiento (no aquí),
-                // pero aquí comprobamos condiciones posicionales.
-                if (p.hasMoved) return false;
-                int dir = (dx>0)? 1 : -1;
-                // Se puede enrocar con CUALQUIER torre del lado escogido siempre que no se haya movido.
-                int rookCol = (dir>0) ? 7 : 0;
-                if (!dentroTablero(sF, rookCol)) return false;
-                int rookIdx = tableroLogico[sF][rookCol];
-                if (rookIdx == -1) return false;
-                const Pieza &r = piezas[rookIdx];
-                if (!r.alive || r.tipo != TipoPieza::Rook || r.color != p.color || r.hasMoved) return false;
-
-                // camino libre completo entre rey y torre
-                for (int cc = (dir>0? sC+1 : rookCol+1); cc < (dir>0? rookCol : sC); ++cc){
-                    if (tableroLogico[sF][cc] != -1) return false;
-                }
-
-                // casillas del rey no deben estar atacadas durante el paso
-                ColorPieza enemigo = (p.color==ColorPieza::White)? ColorPieza::Black : ColorPieza::White;
-                if (estaCasillaAtacada(piezas, enemigo, sF, sC)) return false;
-                int passC1 = sC + dir;
-                int passC2 = sC + 2*dir;
-                int finalC = sC + 3*dir;
-                if (estaCasillaAtacada(piezas, enemigo, sF, passC1)) return false;
-                if (estaCasillaAtacada(piezas, enemigo, sF, passC2)) return false;
-                if (estaCasillaAtacada(piezas, enemigo, sF, finalC)) return false;
-                return true;
+// ---------------------- MAIN ----------------------
+int main(int argc, char** argv){
+    // reloj: --reloj M+S[i|d|b] (incremento Fischer, retardo simple o Bronstein), por defecto 10+5
+    // red: --conectar host[:puerto] juega contra otro cliente a través de Servidor.exe
+    // sesiones: --grabar-sesion archivo guarda los eventos de ratón y teclado de cada frame;
+    // --reproducir archivo los repite lo más rápido posible sin mostrar nada (dibuja en una
+    // textura) y escribe el perfil de todos los frames en <informe>.csv / <informe>.json
+    // asignaciones: --presupuesto-asignaciones N por frame (0 por defecto en make asignaciones)
+    // diario: --diario archivo (por defecto partida.diario) guarda cada jugada y al arrancar
+    // reanuda la partida que quedó a medias; --nueva lo descarta y empieza desde el principio
+    ConfigReloj cfgReloj;
+    string hostRed, rutaGrabarSesion, rutaReproducir, informe = "reproduccion", rutaDiario = "partida.diario";
+    bool partidaNueva = false;
+    long presupuestoAsignaciones = CONTANDO_ASIGNACIONES ? 0 : -1;
+    unsigned short puertoRed = PUERTO_POR_DEFECTO;
+    for (int i=1; i<argc; ++i){
+        string arg = argv[i];
+        if (arg == "--reloj" && i+1 < argc){
+            if (!leerConfigReloj(argv[++i], cfgReloj)) cerr << "Formato de reloj no válido, se usa 10+5\n";
+        } else if (arg == "--conectar" && i+1 < argc){
+            hostRed = argv[++i];
+            size_t dosPuntos = hostRed.find(':');
+            if (dosPuntos != string::npos){
+                puertoRed = (unsigned short)atoi(hostRed.c_str() + dosPuntos + 1);
+                hostRed.resize(dosPuntos);
             }
-
-            return false;
+        } else if (arg == "--grabar-sesion" && i+1 < argc){
+            rutaGrabarSesion = argv[++i];
+        } else if (arg == "--reproducir" && i+1 < argc){
+            rutaReproducir = argv[++i];
+        } else if (arg == "--informe" && i+1 < argc){
+            informe = argv[++i];
+        } else if (arg == "--diario" && i+1 < argc){
+            rutaDiario = argv[++i];
+        } else if (arg == "--nueva"){
+            partidaNueva = true;
+        } else if (arg == "--presupuesto-asignaciones" && i+1 < argc){
+            presupuestoAsignaciones = atol(argv[++i]);
         }
     }
-    return false;
-}
-
-int encontrarIndiceRey(const vector<Pieza>& piezas, ColorPieza color){
-    for(int i=0;i<(int)piezas.size();++i){
-        if (piezas[i].alive && piezas[i].tipo==TipoPieza::King && piezas[i].color==color)
-            return i;
-    }
-    return -1;
-}
-
-bool estaEnJaque(const vector<Pieza>& piezas, ColorPieza color){
-    int reyIdx = encontrarIndiceRey(piezas, color);
-    if (reyIdx == -1) return false;
-    int reyF = piezas[reyIdx].fila, reyC = piezas[reyIdx].col;
-    if (!dentroTablero(reyF, reyC)) return false;
 
-    for(int i=0;i<(int)piezas.size();++i){
-        if (!piezas[i].alive) continue;
-        if (piezas[i].color == color) continue;
-        if (movimientoLegal(piezas, i, reyF, reyC, ReglasFlags{}, ReglasFlags{})) return true; // flags vacíos para ataque
+    // una sesión repetida no puede recibir las jugadas del rival: se juega en local
+    GrabadorSesion grabador;
+    ReproductorSesion reproductor;
+    bool reproduciendo = !rutaReproducir.empty();
+    if (reproduciendo){
+        if (!reproductor.cargar(rutaReproducir)){ cerr << "No se puede leer la sesión " << rutaReproducir << "\n"; return -1; }
+        hostRed.clear();
+    } else if (!rutaGrabarSesion.empty()){
+        if (!grabador.abrir(rutaGrabarSesion)) cerr << "No se puede escribir " << rutaGrabarSesion << "\n";
+        if (!hostRed.empty()) cerr << "Aviso: las jugadas del rival en red no se graban; la sesión no se podrá repetir igual\n";
     }
-    return false;
-}
 
-// Simulación (respeta protección y enroque extendido)
-bool dejaReyEnJaqueSimulado(vector<Pieza>& piezas, int moverIdx, int dstF, int dstC, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro){
-    int backupTab[FILAS][COLS];
-    for(int r=0;r<FILAS;r++) for(int c=0;c<COLS;c++) backupTab[r][c] = tableroLogico[r][c];
-    vector<Pieza> backupPiezas = piezas;
-
-    int srcF = piezas[moverIdx].fila;
-    int srcC = piezas[moverIdx].col;
-
-    // manejar captura si existe (bloqueada si protegido)
-    int victIdx = -1;
-    if (dentroTablero(dstF,dstC)) {
-        victIdx = tableroLogico[dstF][dstC];
-        if (victIdx != -1) {
-            const ReglasFlags& flagsOponente = (piezas[moverIdx].color == ColorPieza::White) ? flagsNegro : flagsBlanco;
-            if (flagsOponente.proteccionActiva && flagsOponente.guardiaIdx == victIdx) {
-                // captura bloqueada -> el movimiento a esa casilla no es válido realmente
-                piezas = backupPiezas;
-                for(int r=0;r<FILAS;r++) for(int c=0;c<COLS;c++) tableroLogico[r][c] = backupTab[r][c];
-                return true; // fuerza "en jaque" como consecuencia de movimiento inválido
-            }
-        }
-    }
+    const string tituloBase = "Ajedrez SFML - Jaque & Jaque Mate (con enroque + reglas especiales)";
+    string tituloVentana = tituloBase;
+    sf::RenderWindow window(sf::VideoMode(1000,700), tituloVentana);
+    window.setFramerateLimit(60);
 
-    if (dentroTablero(srcF,srcC)) tableroLogico[srcF][srcC] = -1;
+    // título = tituloBase + lo que se añada, en sitio reservado; SFML lo convierte a sf::String
+    // (eso pide memoria por dentro y queda fuera del presupuesto de asignaciones)
+    tituloVentana.reserve(256);
+    auto mostrarTitulo = [&](){
+        FueraDePresupuesto f;
+        window.setTitle(tituloVentana);
+    };
+    auto ponerTitulo = [&](const char *extra, const char *mas){
+        tituloVentana = tituloBase;
+        tituloVentana += extra;
+        tituloVentana += mas;
+        mostrarTitulo();
+    };
 
-    if (victIdx != -1){
-        piezas[victIdx].alive = false;
-        piezas[victIdx].fila = piezas[victIdx].col = -1;
-    }
-    piezas[moverIdx].fila = dstF;
-    piezas[moverIdx].col = dstC;
-    tableroLogico[dstF][dstC] = moverIdx;
-
-    // enroque normal y extendido en simulación
-    if (backupPiezas[moverIdx].tipo == TipoPieza::King && abs(dstC - srcC) >= 2){
-        int dir = (dstC - srcC) > 0 ? 1 : -1;
-        int rookCol = (dir>0)? 7 : 0;
-        int rookIdx = backupTab[srcF][rookCol];
-        if (rookIdx != -1){
-            int newRookCol = (abs(dstC - srcC) == 2) ? (srcC + dir) : (srcC + 2*dir); // extendido: torre cruza 2 casillas
-            if (dentroTablero(srcF, rookCol)) tableroLogico[srcF][rookCol] = -1;
-            tableroLogico[srcF][newRookCol] = rookIdx;
-            piezas[rookIdx].fila = srcF;
-            piezas[rookIdx].col = newRookCol;
-        }
+    // se dibuja en 'destino': la ventana o, al repetir una sesión, una textura del mismo tamaño
+    // (la ventana queda oculta y solo aporta el contexto de OpenGL; sin pantalla, con xvfb-run)
+    sf::RenderTexture lienzo;
+    if (reproduciendo){
+        window.setVisible(false);
+        window.setFramerateLimit(0);
+        if (!lienzo.create(1000, 700)){ cerr << "No se puede crear la textura de dibujo\n"; return -1; }
     }
-
-    ColorPieza colorMover = piezas[moverIdx].color;
-    bool enJaque = estaEnJaque(piezas, colorMover);
-
-    piezas = backupPiezas;
-    for(int r=0;r<FILAS;r++) for(int c=0;c<COLS;c++) tableroLogico[r][c] = backupTab[r][c];
-
-    return enJaque;
-}
-
-bool esJaqueMate(vector<Pieza>& piezas, ColorPieza color, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro){
-    if (!estaEnJaque(piezas, color)) return false;
-
-    for(int i=0;i<(int)piezas.size();++i){
-        if (!piezas[i].alive) continue;
-        if (piezas[i].color != color) continue;
-        for(int rf=0; rf<FILAS; ++rf){
-            for(int rc=0; rc<COLS; ++rc){
-                if (!movimientoLegal(piezas, i, rf, rc, flagsBlanco, flagsNegro)) continue;
-                if (!dejaReyEnJaqueSimulado(piezas, i, rf, rc, flagsBlanco, flagsNegro)) return false;
-            }
+    sf::RenderTarget &destino = reproduciendo ? (sf::RenderTarget&)lienzo : (sf::RenderTarget&)window;
+
+    // posición del ratón según los eventos (al repetir una sesión no hay ratón de verdad)
+    sf::Vector2i raton = reproduciendo ? sf::Vector2i(0, 0) : sf::Mouse::getPosition(window);
+    auto siguienteEvento = [&](sf::Event &ev){
+        if (reproduciendo){
+            if (!reproductor.siguienteEvento(ev)) return false;
+        } else {
+            FueraDePresupuesto f;         // la cola de eventos de SFML
+            if (!window.pollEvent(ev)) return false;
+            if (grabador.activo()) grabador.evento(ev);
         }
-    }
-    return true;
-}
+        if (ev.type == sf::Event::MouseMoved) raton = sf::Vector2i(ev.mouseMove.x, ev.mouseMove.y);
+        if (ev.type == sf::Event::MouseButtonPressed || ev.type == sf::Event::MouseButtonReleased)
+            raton = sf::Vector2i(ev.mouseButton.x, ev.mouseButton.y);
+        return true;
+    };
 
-// ---------------------- Centrar y escalar sprite ----------------------
-void centrarYescalar(sf::Sprite &s, int fila, int col){
-    sf::FloatRect b = s.getLocalBounds();
-    s.setOrigin(b.width/2.f, b.height/2.f);
-    sf::Vector2f centro = centroCasilla(fila,col);
-    s.setPosition(centro);
-}
+    // perfilador: F3 gráfica de tiempos, F4 grabar a perfil.csv / perfil.json
+    Perfilador perf;
+    perf.presupuestoAsignaciones = presupuestoAsignaciones;
 
-// ---------------------- MAIN ----------------------
-int main(){
-    sf::RenderWindow window(sf::VideoMode(1000,700), "Ajedrez SFML - Jaque & Jaque Mate (con enroque + reglas especiales)");
-    window.setFramerateLimit(60);
+    // animaciones de movimiento y captura (un solo reloj para todas)
+    PlanificadorAnimaciones animaciones;
+    sf::Clock relojFrame;
 
     // Cargar texturas
     map<string,sf::Texture> tex;
@@ -412,62 +149,35 @@ int main(){
         if(!cargarTxt(tex[p.first], p.second)) return -1;
     }
 
-    sf::Sprite fondo(tex["Fondo"]);
-    sf::Sprite tablero(tex["Tablero"]);
-    tablero.setPosition((float)TABLERO_X, (float)TABLERO_Y);
-    float escalaTab = (8.0f * TAM_CASILLA) / (float)tex["Tablero"].getSize().x;
-    tablero.setScale(escalaTab, escalaTab);
+    // reloj de cada bando y su marcador (dígitos y paneles "Reloj N")
+    RelojAjedrez reloj(cfgReloj);
+    MarcadorReloj marcador;
+    if (!marcador.cargar("assets/images/")) return -1;
 
-    // vector de piezas
+    sf::Sprite fondo, tablero;
+    inicializarTablero(fondo, tablero, tex);
+
+    // piezas (estado lógico) y sus sprites, con el mismo índice.
+    // 'graficos' no debe reubicarse: el planificador de animaciones apunta a sus sprites.
     vector<Pieza> piezas;
+    Tablero tableroLogico;
     piezas.reserve(32);
-    for(int r=0;r<FILAS;r++) for(int c=0;c<COLS;c++) tableroLogico[r][c] = -1;
-
-    auto idMaker = [&](const string &base, int n){ return base + "_" + to_string(n); };
-    int contadorId = 0;
+    colocarPosicionInicial(piezas, tableroLogico);
 
-    auto addPieza = [&](TipoPieza tipo, ColorPieza color, int fila, int col, const string &texKey, const string &baseKey){
-        Pieza p;
-        p.id = idMaker(baseKey, contadorId++);
-        p.tipo = tipo;
-        p.color = color;
-        p.fila = fila;
-        p.col = col;
-        p.sprite.setTexture(tex[texKey]);
+    vector<SpritePieza> graficos(piezas.size());
+    for(int i=0;i<(int)piezas.size();++i){
+        SpritePieza &g = graficos[i];
+        g.sprite.setTexture(tex[claveTextura(piezas[i].tipo, piezas[i].color)]);
 
-        const sf::Texture* t = p.sprite.getTexture();
+        const sf::Texture* t = g.sprite.getTexture();
         if (t){
-            p.baseSx = (float)TAM_CASILLA / (float)t->getSize().x;
-            p.baseSy = (float)TAM_CASILLA / (float)t->getSize().y;
-            p.sprite.setScale(p.baseSx, p.baseSy);
+            g.baseSx = (float)TAM_CASILLA / (float)t->getSize().x;
+            g.baseSy = (float)TAM_CASILLA / (float)t->getSize().y;
+            g.sprite.setScale(g.baseSx, g.baseSy);
         }
 
-        centrarYescalar(p.sprite, fila, col);
-        tableroLogico[fila][col] = (int)piezas.size();
-        piezas.push_back(move(p));
-    };
-
-    // Añadir piezas (blancas abajo)
-    for(int c=0;c<8;c++) addPieza(TipoPieza::Pawn, ColorPieza::White, 6, c, "PeonB", "PeonB");
-    addPieza(TipoPieza::Rook, ColorPieza::White, 7, 0, "TorreB", "TorreB");
-    addPieza(TipoPieza::Knight, ColorPieza::White, 7, 1, "CaballoB", "CaballoB");
-    addPieza(TipoPieza::Bishop, ColorPieza::White, 7, 2, "AlfilB", "AlfilB");
-    addPieza(TipoPieza::Queen, ColorPieza::White, 7, 3, "DamaB", "DamaB");
-    addPieza(TipoPieza::King, ColorPieza::White, 7, 4, "ReyB", "ReyB");
-    addPieza(TipoPieza::Bishop, ColorPieza::White, 7, 5, "AlfilB", "AlfilB");
-    addPieza(TipoPieza::Knight, ColorPieza::White, 7, 6, "CaballoB", "CaballoB");
-    addPieza(TipoPieza::Rook, ColorPieza::White, 7, 7, "TorreB", "TorreB");
-
-    // negras
-    for(int c=0;c<8;c++) addPieza(TipoPieza::Pawn, ColorPieza::Black, 1, c, "PeonR", "PeonR");
-    addPieza(TipoPieza::Rook, ColorPieza::Black, 0, 0, "TorreR", "TorreR");
-    addPieza(TipoPieza::Knight, ColorPieza::Black, 0, 1, "CaballoR", "CaballoR");
-    addPieza(TipoPieza::Bishop, ColorPieza::Black, 0, 2, "AlfilR", "AlfilR");
-    addPieza(TipoPieza::Queen, ColorPieza::Black, 0, 3, "DamaR", "DamaR");
-    addPieza(TipoPieza::King, ColorPieza::Black, 0, 4, "ReyR", "ReyR");
-    addPieza(TipoPieza::Bishop, ColorPieza::Black, 0, 5, "AlfilR", "AlfilR");
-    addPieza(TipoPieza::Knight, ColorPieza::Black, 0, 6, "CaballoR", "CaballoR");
-    addPieza(TipoPieza::Rook, ColorPieza::Black, 0, 7, "TorreR", "TorreR");
+        centrarYescalar(g.sprite, piezas[i].fila, piezas[i].col);
+    }
 
     // Flags por jugador
     ReglasFlags flagsBlanco, flagsNegro;
@@ -479,6 +189,24 @@ int main(){
     int origenF=-1, origenC=-1;
     ColorPieza turno = ColorPieza::White;
     vector<pair<int,int>> movimientosValidos;
+    movimientosValidos.reserve(32);
+
+    // movimientos legales del turno actual (se recalculan al cambiar de turno o tras una promoción)
+    MovimientosTurno movsTurno;
+    bool recalcularTurno = true;
+    ResultadoPartida resultado = ResultadoPartida::EnJuego;   // mate, ahogado o tablas de la posición actual
+
+    // capa de control (H): el mapa se pone al día con cada turno nuevo solo si se muestra
+    MapaControl mapaControl;
+    CapaControl capaControl;
+    bool mostrarControl = false;
+    mapaControl.iniciar(piezas, tableroLogico);
+
+    // resaltado de la casilla destino bajo el cursor mientras se arrastra
+    sf::RectangleShape resaltado(sf::Vector2f((float)TAM_CASILLA, (float)TAM_CASILLA));
+    resaltado.setFillColor(sf::Color(120, 200, 120, 70));
+    resaltado.setOutlineColor(sf::Color(120, 220, 120, 200));
+    resaltado.setOutlineThickness(-3.0f);
 
     // Estado de promoción (Regla 3)
     bool mostrandoPromocion = false;
@@ -524,47 +252,344 @@ int main(){
 
     };
 
+    // historial de la partida y modo repetición (R): flechas y barra bajo el tablero
+    Historial historial;
+    historial.reservar(JUGADAS_RESERVADAS);
+    historial.tablas.iniciar(piezas, tableroLogico, flagsBlanco, flagsNegro, turno);
+    uint8_t guardiaPendiente = SIN_CASILLA;   // G pulsada este turno, se guarda con la próxima jugada
+    DiarioPartida diario;                      // se abre después de reanudar la partida guardada
+
+    // partida en red: cada cliente mueve solo su color; deshacer/rehacer no existen en red
+    unique_ptr<ClienteRed> red;
+    if (!hostRed.empty()){
+        red.reset(new ClienteRed(hostRed, puertoRed));
+        ponerTitulo(" - esperando rival en ", hostRed.c_str());
+    }
+    int ladoRed = -1;               // color propio (0 blancas, 1 negras) cuando empieza la partida
+    bool finRed = false;
+
+    // premovimiento: jugada propia preparada durante el turno del rival; se valida y se
+    // envía en cuanto llega la jugada del rival (clic derecho la cancela)
+    bool hayPremov = false;
+    Jugada premov;
+    sf::RectangleShape marcaPremov(sf::Vector2f((float)TAM_CASILLA, (float)TAM_CASILLA));
+    marcaPremov.setFillColor(sf::Color(90, 140, 255, 90));
+    bool enRepeticion = false;
+    bool arrastrandoBarra = false;
+    int plyVista = 0;
+
+    const float BARRA_X = (float)TABLERO_X, BARRA_Y = (float)(TABLERO_Y + 8*TAM_CASILLA + 35);
+    const float BARRA_ANCHO = 8.0f * TAM_CASILLA;
+    sf::RectangleShape barraRepeticion(sf::Vector2f(BARRA_ANCHO, 6.f));
+    barraRepeticion.setPosition(BARRA_X, BARRA_Y - 3.f);
+    barraRepeticion.setFillColor(sf::Color(255,255,255,120));
+    sf::CircleShape cursorRepeticion(9.f);
+    cursorRepeticion.setOrigin(9.f, 9.f);
+    cursorRepeticion.setFillColor(sf::Color(255,210,60));
+
+    // botones táctiles de deshacer / rehacer, a la derecha del tablero
+    sf::CircleShape btnDeshacer(22.f, 3), btnRehacer(22.f, 3);
+    btnDeshacer.setOrigin(22.f, 22.f);
+    btnRehacer.setOrigin(22.f, 22.f);
+    btnDeshacer.setRotation(-90.f);
+    btnRehacer.setRotation(90.f);
+    btnDeshacer.setPosition((float)(TABLERO_X + 8*TAM_CASILLA) + 30.f, (float)(TABLERO_Y + 8*TAM_CASILLA) - 90.f);
+    btnRehacer.setPosition((float)(TABLERO_X + 8*TAM_CASILLA) + 30.f, (float)(TABLERO_Y + 8*TAM_CASILLA) - 30.f);
+
     // sombra para arrastre
     sf::CircleShape sombra((float)TAM_CASILLA * 0.45f);
     sombra.setFillColor(sf::Color(0,0,0,120));
     sombra.setOrigin(sombra.getRadius(), sombra.getRadius());
 
+    // formas que se dibujan cada frame, creadas una vez (una forma de SFML pide memoria al crearse)
+    sf::CircleShape puntoMovimiento((float)TAM_CASILLA * 0.12f);
+    puntoMovimiento.setOrigin(puntoMovimiento.getRadius(), puntoMovimiento.getRadius());
+    puntoMovimiento.setFillColor(DOT_COLOR);
+    sf::RectangleShape marcoJaque(sf::Vector2f((float)TAM_CASILLA, (float)TAM_CASILLA));
+    marcoJaque.setFillColor(sf::Color::Transparent);
+    marcoJaque.setOutlineColor(sf::Color::Red);
+    marcoJaque.setOutlineThickness(3.0f);
+    sf::RectangleShape marcoGuardia(sf::Vector2f((float)TAM_CASILLA - 8.f, (float)TAM_CASILLA - 8.f));
+    marcoGuardia.setFillColor(sf::Color::Transparent);
+    marcoGuardia.setOutlineColor(sf::Color(255, 200, 0));
+    marcoGuardia.setOutlineThickness(3.0f);
+    sf::RectangleShape veloPromocion(sf::Vector2f(1000.f, 700.f));
+    veloPromocion.setFillColor(sf::Color(0,0,0,150));
+
     auto aplicarPromocion = [&](TipoPieza nuevoTipo){
         if (idxPeonPromocion < 0 || idxPeonPromocion >= (int)piezas.size()) return;
         Pieza &peon = piezas[idxPeonPromocion];
         if (!peon.alive || peon.tipo != TipoPieza::Pawn) return;
 
-        // Cambiar tipo y textura
+        // Cambiar tipo y textura; la elección queda en la jugada para poder repetirla
         peon.tipo = nuevoTipo;
-        string texKey;
-        if (nuevoTipo == TipoPieza::Rook)   texKey = (peon.color==ColorPieza::White)?"TorreB":"TorreR";
-        if (nuevoTipo == TipoPieza::Knight) texKey = (peon.color==ColorPieza::White)?"CaballoB":"CaballoR";
-        if (nuevoTipo == TipoPieza::Bishop) texKey = (peon.color==ColorPieza::White)?"AlfilB":"AlfilR";
-        if (nuevoTipo == TipoPieza::Queen)  texKey = (peon.color==ColorPieza::White)?"DamaB":"DamaR";
-        peon.sprite.setTexture(tex[texKey]);
-
-        const sf::Texture* t = peon.sprite.getTexture();
+        historial.tablas.promocionar(indiceCasilla(peon.fila, peon.col), peon.color, nuevoTipo);
+        if (historial.actual > 0) historial.jugadas[historial.actual - 1].promocion = (uint8_t)(1 + (int)nuevoTipo);
+        SpritePieza &g = graficos[idxPeonPromocion];
+        animaciones.detener(g.sprite, true);
+        g.sprite.setTexture(tex[claveTextura(nuevoTipo, peon.color)]);
+
+        const sf::Texture* t = g.sprite.getTexture();
         if (t){
-            peon.baseSx = (float)TAM_CASILLA / (float)t->getSize().x;
-            peon.baseSy = (float)TAM_CASILLA / (float)t->getSize().y;
-            peon.sprite.setScale(peon.baseSx, peon.baseSy);
+            g.baseSx = (float)TAM_CASILLA / (float)t->getSize().x;
+            g.baseSy = (float)TAM_CASILLA / (float)t->getSize().y;
+            g.sprite.setScale(g.baseSx, g.baseSy);
         }
-        centrarYescalar(peon.sprite, peon.fila, peon.col);
+        centrarYescalar(g.sprite, peon.fila, peon.col);
+        if (red && historial.actual > 0) red->enviarJugada(historial.jugadas[historial.actual - 1]);
+        diario.promocion(nuevoTipo, reloj.restanteMs(0), reloj.restanteMs(1));
 
         mostrandoPromocion = false;
         idxPeonPromocion = -1;
+        recalcularTurno = true;
+    };
+
+    // Coloca el sprite de una pieza según su estado lógico, cortando cualquier animación
+    auto sincronizarPieza = [&](int i){
+        const Pieza &p = piezas[i];
+        SpritePieza &g = graficos[i];
+        animaciones.detener(g.sprite, true);
+        g.animandoCaptura = false;
+        g.sprite.setTexture(tex[claveTextura(p.tipo, p.color)]);
+        g.sprite.setScale(g.baseSx, g.baseSy);
+        g.sprite.setColor(sf::Color::White);
+        if (p.alive) centrarYescalar(g.sprite, p.fila, p.col);
+        else g.sprite.setPosition(-2000.f, -2000.f);
     };
 
+    // Todos los sprites (tras saltar de posición)
+    auto sincronizarSprites = [&](){
+        animaciones.completarTodas();
+        for (int i=0;i<(int)piezas.size();++i) sincronizarPieza(i);
+    };
+
+    // Anima los sprites afectados por una jugada recién aplicada
+    auto animarJugada = [&](const EfectoJugada &ef){
+        if (ef.victima != -1){
+            SpritePieza &v = graficos[ef.victima];
+            animaciones.capturar(v.sprite, v.baseSx, v.baseSy, DURACION_ANIMACION_CAPTURA, &v.animandoCaptura);
+        }
+        const Pieza &m = piezas[ef.mover];
+        graficos[ef.mover].sprite.setTexture(tex[claveTextura(m.tipo, m.color)]);
+        animaciones.mover(graficos[ef.mover].sprite, centroCasilla(m.fila, m.col), DURACION_ANIMACION_MOVIMIENTO);
+        if (ef.torre != -1){
+            const Pieza &t = piezas[ef.torre];
+            animaciones.mover(graficos[ef.torre].sprite, centroCasilla(t.fila, t.col),
+                              DURACION_ANIMACION_MOVIMIENTO * 2.0f, Suavizado::EntradaSalidaCubica);
+        }
+    };
+
+    // Juega una jugada ya validada: la soltada con el ratón, un premovimiento o la del rival en red.
+    // Las propias se envían al rival (las de promoción, cuando se elige la pieza).
+    auto comprometerJugada = [&](const Jugada &j, bool propia){
+        EfectoJugada ef = historial.jugar(j, piezas, tableroLogico, flagsBlanco, flagsNegro, turno);
+        animarJugada(ef);
+        reloj.pulsar((int)piezas[ef.mover].color);
+        diario.jugada(j, reloj.restanteMs(0), reloj.restanteMs(1));
+
+        // Regla 3: elegir pieza de promoción
+        if (ef.promocionPendiente){
+            mostrandoPromocion = true;
+            idxPeonPromocion = ef.mover;
+            configurarBotonesPromocion(piezas[ef.mover].color);
+        } else if (propia && red){
+            red->enviarJugada(j);
+        }
+        recalcularTurno = true;
+    };
+
+    // Deshacer / rehacer (Ctrl+Z / Ctrl+Y o los botones junto al tablero): solo se tocan las piezas afectadas
+    auto deshacerORehacer = [&](bool rehacer){
+        if (rehacer ? !historial.puedeRehacer() : !historial.puedeDeshacer()) return;
+        EfectoJugada ef = rehacer ? historial.rehacer(piezas, tableroLogico, flagsBlanco, flagsNegro, turno)
+                                  : historial.deshacer(piezas, tableroLogico, flagsBlanco, flagsNegro, turno);
+        mostrandoPromocion = false;
+        idxPeonPromocion = -1;
+        if (rehacer){
+            animarJugada(ef);
+            // se había deshecho con la elección de promoción pendiente
+            if (ef.promocionPendiente){
+                mostrandoPromocion = true;
+                idxPeonPromocion = ef.mover;
+                configurarBotonesPromocion(piezas[ef.mover].color);
+            }
+        } else {
+            if (ef.victima != -1) sincronizarPieza(ef.victima);
+            if (ef.torre != -1) sincronizarPieza(ef.torre);
+            sincronizarPieza(ef.mover);
+        }
+        guardiaPendiente = SIN_CASILLA;
+        movimientosValidos.clear();
+        recalcularTurno = true;
+
+        // el reloj no devuelve tiempo: solo pasa a correr el del bando al que le toca
+        reloj.activar((int)turno);
+        reloj.reanudar();
+        if (rehacer) diario.rehacer(reloj.restanteMs(0), reloj.restanteMs(1));
+        else diario.deshacer(reloj.restanteMs(0), reloj.restanteMs(1));
+    };
+
+    // Modo repetición: mostrar la posición tras 'ply' jugadas. Un paso adelante se anima;
+    // cualquier otro salto parte de la foto más cercana.
+    auto verJugada = [&](int ply){
+        if (ply < 0) ply = 0;
+        if (ply > historial.actual) ply = historial.actual;
+        if (ply == plyVista) return;
+        if (ply == plyVista + 1){
+            animarJugada(aplicarJugada(piezas, tableroLogico, historial.jugadas[plyVista], flagsBlanco, flagsNegro, turno));
+        } else {
+            historial.irA(ply, piezas, tableroLogico, flagsBlanco, flagsNegro, turno);
+            sincronizarSprites();
+        }
+        plyVista = ply;
+        recalcularTurno = true;
+    };
+
+    auto plyDesdeBarra = [&](float x){
+        float t = (x - BARRA_X) / BARRA_ANCHO;
+        if (t < 0.f) t = 0.f;
+        if (t > 1.f) t = 1.f;
+        return (int)std::lround(t * historial.actual);
+    };
+
+    // diario: se repite lo apuntado con las mismas funciones que al jugar (jugadas, deshacer,
+    // rehacer y promociones) y se sigue escribiendo a continuación. Cada jugada se comprueba
+    // antes de repetirla: lo que no cuadre, y todo lo que venga detrás, se descarta.
+    // No se usa en red ni con sesiones grabadas, que empiezan siempre desde el principio.
+    if (!red && !reproduciendo && rutaGrabarSesion.empty() && !rutaDiario.empty()){
+        Perfilador::Reloj::time_point t0 = Perfilador::Reloj::now();
+        vector<RegistroDiario> registros;
+        if (!partidaNueva) leerDiario(rutaDiario, registros);
+        size_t repetidos = 0;
+        for (const RegistroDiario &r : registros){
+            if (r.tipo == 'J'){
+                const Jugada &j = r.jugada;
+                if (mostrandoPromocion || j.origen >= FILAS*COLS || j.destino >= FILAS*COLS || j.promocion != 0) break;
+                calcularMovimientosTurno(movsTurno, piezas, tableroLogico, turno, flagsBlanco, flagsNegro);
+                if (!movsTurno.permitido(j.origen / COLS, j.origen % COLS, j.destino / COLS, j.destino % COLS)) break;
+                if (j.guardia != SIN_CASILLA){
+                    const ReglasFlags &propios = (turno==ColorPieza::White)? flagsBlanco : flagsNegro;
+                    int g = j.guardia < FILAS*COLS ? tableroLogico[j.guardia / COLS][j.guardia % COLS] : -1;
+                    if (propios.guardiaUsado || g == -1 || piezas[g].color != turno) break;
+                }
+                comprometerJugada(j, false);
+            } else if (r.tipo == 'P'){
+                TipoPieza t = (TipoPieza)(r.jugada.promocion - 1);
+                if (!mostrandoPromocion || r.jugada.promocion == 0 || t == TipoPieza::Pawn || t == TipoPieza::King) break;
+                aplicarPromocion(t);
+            } else {
+                bool rehacer = (r.tipo == 'R');
+                if (rehacer ? !historial.puedeRehacer() : !historial.puedeDeshacer()) break;
+                deshacerORehacer(rehacer);
+            }
+            repetidos++;
+        }
+        if (repetidos > 0){
+            sincronizarSprites();
+            reloj.restaurar(registros[repetidos - 1].msBlancas, registros[repetidos - 1].msNegras);
+            double ms = std::chrono::duration<double, std::milli>(Perfilador::Reloj::now() - t0).count();
+            cout << "Partida reanudada de " << rutaDiario << ": " << historial.actual << " jugadas (" << ms << " ms)\n";
+            if (repetidos < registros.size()) cerr << "Diario: se descartan " << registros.size() - repetidos << " registros no válidos\n";
+        }
+        if (!diario.abrir(rutaDiario, repetidos)) cerr << "No se puede escribir el diario " << rutaDiario << "\n";
+    }
+
+    // repetición de una sesión: se perfilan todos los frames
+    if (reproduciendo){
+        perf.grabacion.reserve(reproductor.numFrames());
+        perf.grabando = true;
+    }
+    Perfilador::Reloj::time_point inicioReproduccion = Perfilador::Reloj::now();
+
     // bucle principal
     while(window.isOpen()){
+        if (reproduciendo && !reproductor.siguienteFrame()){
+            window.close();
+            break;
+        }
+        perf.empezarFrame();
+        perf.seccion(SeccionPerfil::Eventos);
+
         sf::Event ev;
-        while(window.pollEvent(ev)){
-            if(ev.type==sf::Event::Closed) window.close();
+        while(siguienteEvento(ev)){
+            if(ev.type==sf::Event::Closed){
+                if (perf.grabando && !reproduciendo) perf.alternarGrabacion();
+                window.close();
+            }
+
+            // perfilador
+            if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::F3){
+                perf.visible = !perf.visible;
+                if (!perf.visible) mostrarTitulo();
+            }
+            if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::F4) perf.alternarGrabacion();
+
+            // capa de control: al mostrarla se pone al día con lo jugado mientras estaba oculta
+            if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::H){
+                mostrarControl = !mostrarControl;
+                if (mostrarControl){
+                    mapaControl.actualizar(piezas, tableroLogico);
+                    capaControl.construir(mapaControl, piezas);
+                }
+            }
+
+            // Modo repetición (R): entrar/salir; al salir se vuelve a la posición actual de la partida
+            if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::R && !mostrandoPromocion && !arrastrando
+                && historial.actual > 0){
+                enRepeticion = !enRepeticion;
+                if (enRepeticion){
+                    plyVista = historial.actual;
+                    reloj.pausar();
+                } else {
+                    verJugada(historial.actual);
+                    reloj.reanudar();
+                }
+                arrastrandoBarra = false;
+                continue;
+            }
+            if (enRepeticion){
+                if (ev.type == sf::Event::KeyPressed){
+                    if (ev.key.code == sf::Keyboard::Left)  verJugada(plyVista - 1);
+                    if (ev.key.code == sf::Keyboard::Right) verJugada(plyVista + 1);
+                    if (ev.key.code == sf::Keyboard::Down)  verJugada(plyVista - 10);
+                    if (ev.key.code == sf::Keyboard::Up)    verJugada(plyVista + 10);
+                    if (ev.key.code == sf::Keyboard::Home)  verJugada(0);
+                    if (ev.key.code == sf::Keyboard::End)   verJugada(historial.actual);
+                }
+                if (ev.type == sf::Event::MouseButtonPressed && ev.mouseButton.button == sf::Mouse::Left){
+                    sf::Vector2f m = destino.mapPixelToCoords(raton);
+                    if (m.x >= BARRA_X - 10.f && m.x <= BARRA_X + BARRA_ANCHO + 10.f && fabs(m.y - BARRA_Y) <= 15.f){
+                        arrastrandoBarra = true;
+                        verJugada(plyDesdeBarra(m.x));
+                    }
+                }
+                if (ev.type == sf::Event::MouseMoved && arrastrandoBarra){
+                    verJugada(plyDesdeBarra(destino.mapPixelToCoords(sf::Vector2i(ev.mouseMove.x, ev.mouseMove.y)).x));
+                }
+                if (ev.type == sf::Event::MouseButtonReleased && ev.mouseButton.button == sf::Mouse::Left){
+                    arrastrandoBarra = false;
+                }
+                // el tablero no acepta jugadas mientras se revisa la partida
+                continue;
+            }
+
+            // Deshacer / rehacer (también con la promoción abierta: deshace el avance del peón)
+            if (!arrastrando && !red){
+                if (reloj.banderaCaida() != -1){
+                    // sin tiempo: la partida ha terminado y no se puede deshacer
+                } else if (ev.type == sf::Event::KeyPressed && ev.key.control && ev.key.code == sf::Keyboard::Z){ deshacerORehacer(false); continue; }
+                else if (ev.type == sf::Event::KeyPressed && ev.key.control && ev.key.code == sf::Keyboard::Y){ deshacerORehacer(true); continue; }
+                else if (ev.type == sf::Event::MouseButtonPressed && ev.mouseButton.button == sf::Mouse::Left){
+                    sf::Vector2f m = destino.mapPixelToCoords(raton);
+                    if (btnDeshacer.getGlobalBounds().contains(m)){ deshacerORehacer(false); continue; }
+                    if (btnRehacer.getGlobalBounds().contains(m)){ deshacerORehacer(true); continue; }
+                }
+            }
 
             // Si se está mostrando la promoción, solo manejar clicks sobre los botones
             if (mostrandoPromocion){
                 if (ev.type == sf::Event::MouseButtonPressed && ev.mouseButton.button == sf::Mouse::Left){
-                    sf::Vector2f mpos = window.mapPixelToCoords(sf::Mouse::getPosition(window));
+                    sf::Vector2f mpos = destino.mapPixelToCoords(raton);
                     if (btnRook.getGlobalBounds().contains(mpos))   aplicarPromocion(TipoPieza::Rook);
                     else if (btnKnight.getGlobalBounds().contains(mpos)) aplicarPromocion(TipoPieza::Knight);
                     else if (btnBishop.getGlobalBounds().contains(mpos)) aplicarPromocion(TipoPieza::Bishop);
@@ -574,60 +599,59 @@ int main(){
                 continue;
             }
 
+            // con la bandera caída, mate o tablas (o la partida en red terminada) no se coge ninguna pieza más
+            bool sinJugar = reloj.banderaCaida() != -1 || resultado != ResultadoPartida::EnJuego || (red && (ladoRed == -1 || finRed));
+            if (sinJugar && ev.type != sf::Event::MouseButtonReleased) continue;
+
+            // clic derecho: cancelar el premovimiento
+            if (ev.type == sf::Event::MouseButtonPressed && ev.mouseButton.button == sf::Mouse::Right) hayPremov = false;
+
             // PRESionar
             if(ev.type==sf::Event::MouseButtonPressed && ev.mouseButton.button==sf::Mouse::Left){
-                sf::Vector2f mouse = window.mapPixelToCoords(sf::Mouse::getPosition(window));
+                sf::Vector2f mouse = destino.mapPixelToCoords(raton);
                 idxSeleccionado = -1;
                 for(int i=(int)piezas.size()-1;i>=0;--i){
                     if (!piezas[i].alive) continue;
-                    if (piezas[i].sprite.getGlobalBounds().contains(mouse)){
-                        // validar turno
-                        if ((turno == ColorPieza::White && piezas[i].color != ColorPieza::White) ||
-                            (turno == ColorPieza::Black && piezas[i].color != ColorPieza::Black)){
-                            idxSeleccionado = -1;
-                        } else {
-                            idxSeleccionado = i;
-                        }
+                    if (graficos[i].sprite.getGlobalBounds().contains(mouse)){
+                        // validar turno (en red: solo las piezas propias, también en el turno del rival para premover)
+                        bool propia = red ? ((int)piezas[i].color == ladoRed) : (piezas[i].color == turno);
+                        idxSeleccionado = propia ? i : -1;
                         break;
                     }
                 }
                 if (idxSeleccionado != -1){
                     arrastrando = true;
-                    difMouse = mouse - piezas[idxSeleccionado].sprite.getPosition();
+                    animaciones.detener(graficos[idxSeleccionado].sprite, false); // se toma desde donde esté
+                    difMouse = mouse - graficos[idxSeleccionado].sprite.getPosition();
                     origenF = piezas[idxSeleccionado].fila;
                     origenC = piezas[idxSeleccionado].col;
 
-                    // movimientos válidos (con reglas especiales)
+                    // movimientos válidos: ya calculados al empezar el turno
                     movimientosValidos.clear();
-                    for(int rf=0; rf<FILAS; ++rf){
-                        for(int rc=0; rc<COLS; ++rc){
-                            if (movimientoLegal(piezas, idxSeleccionado, rf, rc, flagsBlanco, flagsNegro))
-                                movimientosValidos.emplace_back(rf, rc);
-                        }
+                    uint64_t mascara = movsTurno.destinos[indiceCasilla(origenF, origenC)];
+                    for(int k=0; k<FILAS*COLS; ++k){
+                        if (mascara & (1ULL << k)) movimientosValidos.emplace_back(k / COLS, k % COLS);
                     }
 
                     // animación "levantar"
-                    piezas[idxSeleccionado].sprite.setScale(piezas[idxSeleccionado].baseSx * 1.15f,
-                                                           piezas[idxSeleccionado].baseSy * 1.15f);
+                    graficos[idxSeleccionado].sprite.setScale(graficos[idxSeleccionado].baseSx * 1.15f,
+                                                           graficos[idxSeleccionado].baseSy * 1.15f);
                 }
             }
 
             // Regla 1: activar "guardia" con tecla G sobre la pieza seleccionada (una vez por jugador)
-            if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::G && idxSeleccionado != -1){
-                ReglasFlags &flags = (turno==ColorPieza::White)? flagsBlanco : flagsNegro;
-                if (!flags.guardiaUsado){
-                    flags.guardiaUsado = true;
-                    flags.guardiaIdx = idxSeleccionado;
-                    piezas[idxSeleccionado].protegido = true;
-                    flags.proteccionActiva = true;
-                    flags.proteccionTurnoDe = turno;
-                }
+            if (ev.type == sf::Event::KeyPressed && ev.key.code == sf::Keyboard::G && idxSeleccionado != -1
+                && piezas[idxSeleccionado].color == turno){
+                // solo se anota: aplicarJugada la activa con la jugada (j.guardia), así el registro
+                // para deshacer y las fotos del historial la ven igual que al repetir o reanudar
+                const ReglasFlags &flags = (turno==ColorPieza::White)? flagsBlanco : flagsNegro;
+                if (!flags.guardiaUsado) guardiaPendiente = (uint8_t)indiceCasilla(origenF, origenC);
             }
 
             // SOLTAR
             if(ev.type==sf::Event::MouseButtonReleased && ev.mouseButton.button==sf::Mouse::Left && arrastrando && idxSeleccionado != -1){
                 arrastrando = false;
-                sf::Vector2f mouse = window.mapPixelToCoords(sf::Mouse::getPosition(window));
+                sf::Vector2f mouse = destino.mapPixelToCoords(raton);
                 auto [dstF, dstC] = casillaMasCercana(mouse.x, mouse.y);
 
                 // movimiento permitido por radio (tolerancia)
@@ -635,110 +659,31 @@ int main(){
                 float dist = hypotf(mouse.x - centro.x, mouse.y - centro.y);
 
                 bool dentroRadio = (dist <= RADIO_ACEPTACION);
-                bool legal = movimientoLegal(piezas, idxSeleccionado, dstF, dstC, flagsBlanco, flagsNegro);
+                bool legal = movsTurno.permitido(origenF, origenC, dstF, dstC) && reloj.banderaCaida() == -1;
 
                 // restaurar escala
-                piezas[idxSeleccionado].sprite.setScale(piezas[idxSeleccionado].baseSx, piezas[idxSeleccionado].baseSy);
-
-                if (dentroRadio && legal){
-                    if (!dejaReyEnJaqueSimulado(piezas, idxSeleccionado, dstF, dstC, flagsBlanco, flagsNegro)){
-                        // captura (si no protegido)
-                        if (tableroLogico[dstF][dstC] != -1){
-                            int victim = tableroLogico[dstF][dstC];
-                            const ReglasFlags& flagsOponente = (piezas[idxSeleccionado].color == ColorPieza::White)? flagsNegro : flagsBlanco;
-                            if (!(flagsOponente.proteccionActiva && flagsOponente.guardiaIdx == victim)){
-                                if (victim >= 0 && piezas[victim].alive && piezas[victim].color != piezas[idxSeleccionado].color){
-                                    piezas[victim].animandoCaptura = true;
-                                    piezas[victim].animClock.restart();
-                                }
-                            } else {
-                                // protegido: no capturamos (ya lo bloqueó movimientoLegal, seguridad adicional)
-                            }
-                        }
-
-                        bool fueEnroque = false;
-                        int moveCols = abs(dstC - origenC);
-
-                        if (piezas[idxSeleccionado].tipo == TipoPieza::King && (moveCols == 2 || moveCols == 3)){
-                            int dir = (dstC - origenC) > 0 ? 1 : -1;
-                            int rookCol = (dir>0)? 7 : 0;
-                            int rookIdx = tableroLogico[origenF][rookCol];
-                            if (rookIdx != -1){
-                                // borrar origen del rey
-                                if (dentroTablero(origenF,origenC)) tableroLogico[origenF][origenC] = -1;
-                                piezas[idxSeleccionado].fila = dstF; piezas[idxSeleccionado].col = dstC;
-                                centrarYescalar(piezas[idxSeleccionado].sprite, dstF, dstC);
-                                tableroLogico[dstF][dstC] = idxSeleccionado;
-                                piezas[idxSeleccionado].hasMoved = true;
-
-                                // mover torre
-                                int newRookCol = (moveCols==2) ? (origenC + dir) : (origenC + 2*dir);
-                                if (dentroTablero(origenF, rookCol)) tableroLogico[origenF][rookCol] = -1;
-                                piezas[rookIdx].fila = origenF;
-                                piezas[rookIdx].col = newRookCol;
-                                centrarYescalar(piezas[rookIdx].sprite, piezas[rookIdx].fila, piezas[rookIdx].col);
-                                tableroLogico[origenF][newRookCol] = rookIdx;
-                                piezas[rookIdx].hasMoved = true;
-
-                                fueEnroque = true;
-
-                                // Regla 2: registrar uso de enroque extendido
-                                if (moveCols == 3){
-                                    ReglasFlags &flags = (turno==ColorPieza::White)? flagsBlanco : flagsNegro;
-                                    flags.enroque3Usado = true;
-                                }
-                            }
-                        }
-
-                        if (!fueEnroque){
-                            // movimiento normal
-                            if (dentroTablero(origenF,origenC)) tableroLogico[origenF][origenC] = -1;
-                            piezas[idxSeleccionado].fila = dstF; piezas[idxSeleccionado].col = dstC;
-                            centrarYescalar(piezas[idxSeleccionado].sprite, dstF, dstC);
-                            tableroLogico[dstF][dstC] = idxSeleccionado;
-                            piezas[idxSeleccionado].hasMoved = true;
-                        }
-
-                        // Regla 3: promoción automática al llegar a última fila
-                        if (piezas[idxSeleccionado].tipo == TipoPieza::Pawn){
-                            bool llegoUltima = (piezas[idxSeleccionado].color==ColorPieza::White)? (dstF==0) : (dstF==7);
-                            if (llegoUltima){
-                                mostrandoPromocion = true;
-                                idxPeonPromocion = idxSeleccionado;
-                                configurarBotonesPromocion(piezas[idxSeleccionado].color);
-                            }
-                        }
-
-                        // Cambiar turno
-                        turno = (turno == ColorPieza::White) ? ColorPieza::Black : ColorPieza::White;
-
-                        // Regla 1: finalizar protección al cerrar el turno del protegido
-                        // La protección dura "un turno completo" del rival. Al cambiar el turno, si la protección
-                        // pertenece al jugador que ahora empieza, se desactiva (ha pasado el turno del rival).
-                        {
-                            ReglasFlags &fb = flagsBlanco;
-                            ReglasFlags &fn = flagsNegro;
-                            if (fb.proteccionActiva && fb.proteccionTurnoDe != turno){
-                                // La protección era de blancas y acaba de terminar el turno de negras -> desactivar
-                                if (fb.guardiaIdx >=0 && fb.guardiaIdx < (int)piezas.size()) piezas[fb.guardiaIdx].protegido = false;
-                                fb.proteccionActiva = false;
-                            }
-                            if (fn.proteccionActiva && fn.proteccionTurnoDe != turno){
-                                if (fn.guardiaIdx >=0 && fn.guardiaIdx < (int)piezas.size()) piezas[fn.guardiaIdx].protegido = false;
-                                fn.proteccionActiva = false;
-                            }
-                        }
-
-                    } else {
-                        // movimiento deja rey en jaque -> revertir
-                        piezas[idxSeleccionado].fila = origenF; piezas[idxSeleccionado].col = origenC;
-                        centrarYescalar(piezas[idxSeleccionado].sprite, origenF, origenC);
-                        if (dentroTablero(origenF,origenC)) tableroLogico[origenF][origenC] = idxSeleccionado;
-                    }
+                graficos[idxSeleccionado].sprite.setScale(graficos[idxSeleccionado].baseSx, graficos[idxSeleccionado].baseSy);
+
+                // turno del rival (en red): se guarda como premovimiento y la pieza vuelve a su casilla
+                bool premover = piezas[idxSeleccionado].color != turno;
+                if (premover && dentroRadio && (dstF != origenF || dstC != origenC)){
+                    premov = Jugada();
+                    premov.origen = (uint8_t)indiceCasilla(origenF, origenC);
+                    premov.destino = (uint8_t)indiceCasilla(dstF, dstC);
+                    hayPremov = true;
+                }
+
+                if (!premover && dentroRadio && legal){
+                    Jugada j;
+                    j.origen = (uint8_t)indiceCasilla(origenF, origenC);
+                    j.destino = (uint8_t)indiceCasilla(dstF, dstC);
+                    j.guardia = guardiaPendiente;
+                    guardiaPendiente = SIN_CASILLA;
+                    comprometerJugada(j, true);
                 } else {
                     // fuera radio o ilegal -> revertir
                     piezas[idxSeleccionado].fila = origenF; piezas[idxSeleccionado].col = origenC;
-                    centrarYescalar(piezas[idxSeleccionado].sprite, origenF, origenC);
+                    animaciones.mover(graficos[idxSeleccionado].sprite, centroCasilla(origenF, origenC), DURACION_ANIMACION_MOVIMIENTO);
                     if (dentroTablero(origenF,origenC)) tableroLogico[origenF][origenC] = idxSeleccionado;
                 }
 
@@ -747,55 +692,124 @@ int main(){
             }
         } // events
 
+        // red: mensajes que ha dejado el hilo de red (aquí nunca se espera al socket).
+        // Durante la repetición, un arrastre o la elección de promoción se quedan en la cola.
+        if (red && !enRepeticion && !arrastrando && !mostrandoPromocion){
+            MensajeRed m;
+            while (red->recibir(m)){
+                switch (m.tipo){
+                    case TipoMensajeRed::Partida:
+                        ladoRed = m.lado;
+                        ponerTitulo(ladoRed == 0 ? " - en red: juegas con blancas" : " - en red: juegas con negras", "");
+                        break;
+                    case TipoMensajeRed::Jugada:
+                        if ((int)turno != ladoRed) comprometerJugada(m.jugada, false);
+                        break;
+                    case TipoMensajeRed::Ilegal:
+                        // el servidor no aceptó la última jugada propia: se retira también aquí
+                        if (historial.puedeDeshacer()) deshacerORehacer(false);
+                        break;
+                    case TipoMensajeRed::Fin:
+                        finRed = true;
+                        hayPremov = false;
+                        reloj.detener();
+                        ponerTitulo(" - fin de la partida: ", m.motivo);
+                        break;
+                    case TipoMensajeRed::Desconectado:
+                        finRed = true;
+                        hayPremov = false;
+                        reloj.detener();
+                        ponerTitulo(" - sin conexión con el servidor", "");
+                        break;
+                    case TipoMensajeRed::Ok:
+                        break;
+                }
+            }
+        }
+
         // arrastre visual
         if (arrastrando && idxSeleccionado != -1){
-            sf::Vector2f mouse = window.mapPixelToCoords(sf::Mouse::getPosition(window));
-            piezas[idxSeleccionado].sprite.setPosition(mouse - difMouse);
+            sf::Vector2f mouse = destino.mapPixelToCoords(raton);
+            graficos[idxSeleccionado].sprite.setPosition(mouse - difMouse);
         }
 
-        // animaciones de captura
-        for (int i=0;i<(int)piezas.size();++i){
-            if (piezas[i].animandoCaptura){
-                float t = piezas[i].animClock.getElapsedTime().asSeconds() / DURACION_ANIMACION_CAPTURA;
-                if (t >= 1.0f){
-                    piezas[i].animandoCaptura = false;
-                    piezas[i].alive = false;
-                    if (piezas[i].fila >=0 && piezas[i].col >=0 && tableroLogico[piezas[i].fila][piezas[i].col] == i)
-                        tableroLogico[piezas[i].fila][piezas[i].col] = -1;
-                    piezas[i].fila = piezas[i].col = -1;
-                    piezas[i].sprite.setPosition(-2000.f, -2000.f);
-                } else {
-                    float s = 1.0f - t;
-                    const sf::Texture* tx = piezas[i].sprite.getTexture();
-                    if (tx){
-                        piezas[i].sprite.setScale(piezas[i].baseSx * s, piezas[i].baseSy * s);
-                    }
-                    sf::Color col = piezas[i].sprite.getColor();
-                    col.a = (sf::Uint8)(255 * (1.0f - t));
-                    piezas[i].sprite.setColor(col);
+        // animaciones (movimientos, enroque y capturas), independientes de los FPS
+        perf.seccion(SeccionPerfil::Animacion);
+        // (al repetir, con la duración que tuvo el frame al grabarlo)
+        float dt = relojFrame.restart().asSeconds();
+        if (reproduciendo) dt = reproductor.dt();
+        if (grabador.activo()) grabador.terminarFrame(dt);
+        animaciones.avanzar(dt);
+
+        // Jaque / mate: solo se calcula al empezar un turno (no durante la elección de promoción)
+        perf.seccion(SeccionPerfil::Jaque);
+        if (recalcularTurno && !mostrandoPromocion){
+            calcularMovimientosTurno(movsTurno, piezas, tableroLogico, turno, flagsBlanco, flagsNegro);
+            recalcularTurno = false;
+            if (mostrarControl){
+                mapaControl.actualizar(piezas, tableroLogico);
+                capaControl.construir(mapaControl, piezas);
+            }
+
+            // fin de partida (en la repetición se mira una posición pasada, no la de la partida)
+            if (!enRepeticion){
+                ResultadoPartida antes = resultado;
+                resultado = historial.tablas.resultado(movsTurno, turno);
+                if (resultado != ResultadoPartida::EnJuego){
+                    reloj.detener();
+                    if (!red && resultado != antes) ponerTitulo(" - ", descripcionResultado(resultado));
+                } else if (antes != ResultadoPartida::EnJuego && !red){
+                    ponerTitulo("", "");      // se deshizo la jugada que terminaba la partida
                 }
             }
-        }
 
-        // Jaque / mate
-        bool blancoEnJaque = estaEnJaque(piezas, ColorPieza::White);
-        bool negroEnJaque  = estaEnJaque(piezas, ColorPieza::Black);
-        bool blancoJaqueMate = esJaqueMate(piezas, ColorPieza::White, flagsBlanco, flagsNegro);
-        bool negroJaqueMate  = esJaqueMate(piezas, ColorPieza::Black, flagsBlanco, flagsNegro);
+            // premovimiento: se juega en cuanto es nuestro turno, si sigue siendo legal
+            if (hayPremov && red && (int)turno == ladoRed && !finRed){
+                hayPremov = false;
+                if (movsTurno.permitido(premov.origen / COLS, premov.origen % COLS, premov.destino / COLS, premov.destino % COLS))
+                    comprometerJugada(premov, true);
+            }
+        }
+        bool blancoEnJaque = movsTurno.blancoEnJaque;
+        bool negroEnJaque  = movsTurno.negroEnJaque;
 
         // dibujado
-        window.clear();
-        window.draw(fondo);
-        window.draw(tablero);
+        perf.seccion(SeccionPerfil::Dibujo);
+        destino.clear();
+        destino.draw(fondo);
+        destino.draw(tablero);
+
+        // relojes: el panel del bando que corre cambia de fotograma cada segundo
+        for (int l=0; l<2; ++l){
+            int64_t ms = reloj.restanteMs(l);
+            marcador.actualizar(l, ms, reloj.ladoActivo() == l, (int)((ms / 1000) % NUM_PANELES_RELOJ));
+        }
+        marcador.dibujar(destino);
+
+        if (mostrarControl) capaControl.dibujar(destino);
+
+        // premovimiento pendiente: origen y destino sombreados
+        if (hayPremov){
+            for (uint8_t k : { premov.origen, premov.destino }){
+                marcaPremov.setPosition((float)(TABLERO_X + (k % COLS) * TAM_CASILLA), (float)(TABLERO_Y + (k / COLS) * TAM_CASILLA));
+                destino.draw(marcaPremov);
+            }
+        }
 
         // dots
-        sf::CircleShape dot((float)TAM_CASILLA * 0.12f);
-        dot.setOrigin(dot.getRadius(), dot.getRadius());
-        dot.setFillColor(DOT_COLOR);
         for (auto &m : movimientosValidos){
-            sf::Vector2f c = centroCasilla(m.first, m.second);
-            dot.setPosition(c);
-            window.draw(dot);
+            puntoMovimiento.setPosition(centroCasilla(m.first, m.second));
+            destino.draw(puntoMovimiento);
+        }
+
+        // resaltar la casilla destino bajo el cursor si el movimiento es legal
+        if (arrastrando && idxSeleccionado != -1){
+            sf::Vector2f mouse = destino.mapPixelToCoords(raton);
+            auto [hF, hC] = casillaMasCercana(mouse.x, mouse.y);
+            if (movsTurno.permitido(origenF, origenC, hF, hC)){
+                resaltado.setPosition((float)(TABLERO_X + hC * TAM_CASILLA), (float)(TABLERO_Y + hF * TAM_CASILLA));
+                destino.draw(resaltado);
+            }
         }
 
         // resaltar rey en jaque
@@ -804,47 +818,85 @@ int main(){
             ColorPieza c = blancoEnJaque ? ColorPieza::White : ColorPieza::Black;
             idxRey = encontrarIndiceRey(piezas, c);
             if (idxRey != -1 && piezas[idxRey].alive){
-                sf::RectangleShape r(sf::Vector2f((float)TAM_CASILLA, (float)TAM_CASILLA));
-                r.setFillColor(sf::Color::Transparent);
-                r.setOutlineColor(sf::Color::Red);
-                r.setOutlineThickness(3.0f);
                 float left = TABLERO_X + piezas[idxRey].col * TAM_CASILLA;
                 float top  = TABLERO_Y + piezas[idxRey].fila * TAM_CASILLA;
-                r.setPosition(left, top);
-                window.draw(r);
+                marcoJaque.setPosition(left, top);
+                destino.draw(marcoJaque);
             }
         }
 
+        // Regla 1: guardia anotada con G, se activa con la próxima jugada
+        if (guardiaPendiente != SIN_CASILLA && !enRepeticion){
+            marcoGuardia.setPosition((float)(TABLERO_X + (guardiaPendiente % COLS) * TAM_CASILLA) + 4.f,
+                                     (float)(TABLERO_Y + (guardiaPendiente / COLS) * TAM_CASILLA) + 4.f);
+            destino.draw(marcoGuardia);
+        }
+
         // dibujar piezas
         for (int i=0;i<(int)piezas.size();++i){
             if (i == idxSeleccionado) continue;
-            if (piezas[i].alive || piezas[i].animandoCaptura) window.draw(piezas[i].sprite);
+            if (piezas[i].alive || graficos[i].animandoCaptura) destino.draw(graficos[i].sprite);
         }
 
         // pieza arrastrada + sombra
         if (idxSeleccionado != -1 && piezas[idxSeleccionado].alive){
-            sf::Vector2f pos = piezas[idxSeleccionado].sprite.getPosition();
+            sf::Vector2f pos = graficos[idxSeleccionado].sprite.getPosition();
             sombra.setPosition(pos.x + 6.f, pos.y + 10.f);
-            window.draw(sombra);
-            window.draw(piezas[idxSeleccionado].sprite);
+            destino.draw(sombra);
+            destino.draw(graficos[idxSeleccionado].sprite);
+        }
+
+        // deshacer / rehacer (atenuados si no hay nada que hacer; en red no hay)
+        if (!enRepeticion && !red){
+            btnDeshacer.setFillColor(historial.puedeDeshacer() ? sf::Color(255,255,255,200) : sf::Color(255,255,255,50));
+            btnRehacer.setFillColor(historial.puedeRehacer() ? sf::Color(255,255,255,200) : sf::Color(255,255,255,50));
+            destino.draw(btnDeshacer);
+            destino.draw(btnRehacer);
+        }
+
+        // barra de repetición: posición de la jugada mostrada dentro de la partida
+        if (enRepeticion){
+            destino.draw(barraRepeticion);
+            float t = (float)plyVista / (float)historial.actual;
+            cursorRepeticion.setPosition(BARRA_X + t * BARRA_ANCHO, BARRA_Y);
+            destino.draw(cursorRepeticion);
         }
 
         // UI de promoción (Regla 3): oscurecer fondo y dibujar recuadro + botones
         if (mostrandoPromocion){
-            sf::RectangleShape overlay(sf::Vector2f(1000.f, 700.f));
-            overlay.setFillColor(sf::Color(0,0,0,150));
-            overlay.setPosition(0.f,0.f);
-            window.draw(overlay);
-
-            window.draw(recuadroPromocion);
-            window.draw(btnRook);
-            window.draw(btnKnight);
-            window.draw(btnBishop);
-            window.draw(btnQueen);
+            destino.draw(veloPromocion);
+
+            destino.draw(recuadroPromocion);
+            destino.draw(btnRook);
+            destino.draw(btnKnight);
+            destino.draw(btnBishop);
+            destino.draw(btnQueen);
+        }
+
+        if (perf.visible){
+            perf.dibujar(destino);
+            perf.actualizarTitulo(window, tituloVentana);
         }
 
-        window.display();//CAMBIO
+        perf.seccion(SeccionPerfil::Presentar);
+        {
+            FueraDePresupuesto f;         // lo que pida el driver al presentar
+            if (reproduciendo) lienzo.display();
+            else window.display();//CAMBIO
+        }
+        perf.terminarFrame();
     } // loop
 
+    if (reproduciendo){
+        double segundos = std::chrono::duration<double>(Perfilador::Reloj::now() - inicioReproduccion).count();
+        perf.grabando = false;
+        cout << "Sesión " << rutaReproducir << ": " << reproductor.numEventos() << " eventos, "
+             << reproductor.segundosGrabados() << " s al grabarla\n";
+        perf.resumen(cout, segundos);
+        perf.volcar(informe + ".csv", informe + ".json");
+    }
+
+    // partida terminada: no queda nada que reanudar la próxima vez
+    if (resultado != ResultadoPartida::EnJuego || reloj.banderaCaida() != -1) diario.borrar();
     return 0;
 }
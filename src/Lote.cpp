@@ -0,0 +1,290 @@
+// Lote.cpp
+// Validación de jugadas por lotes sobre bitboards (libalmate). Ver Lote.hpp.
+//
+// El núcleo está escrito una sola vez, como plantilla sobre el tipo de una "palabra": uint64_t
+// (una jugada) o un vector de 4 uint64_t con las extensiones de vectores de GCC (cuatro jugadas,
+// una por carril). Todo son operaciones de bits y desplazamientos fijos, sin saltos ni tablas,
+// así que cada instrucción sirve para los cuatro carriles. Las condiciones son máscaras: todo
+// unos (sí) o todo ceros (no) en cada carril. La versión de 4 carriles se compila dentro de una
+// función con target("avx2") (el núcleo se mete entero en ella), y solo se usa si la CPU lo
+// tiene: el resto del binario sigue siendo x86-64 básico.
+
+#include "Lote.hpp"
+#include <cstdlib>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ALMATE_LOTE_AVX2
+#endif
+
+#define EN_LINEA inline __attribute__((always_inline))
+
+// ---------------------- Bitboards ----------------------
+typedef uint64_t Cuatro __attribute__((vector_size(32)));      // cuatro carriles de 64 bits
+
+// Las funciones que pasan un Cuatro por valor se meten siempre en la que las llama, así que el
+// aviso de que su ABI cambia con AVX no aplica
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+const uint64_t SIN_COL0 = ~0x0101010101010101ULL;
+const uint64_t SIN_COL7 = ~0x8080808080808080ULL;
+const uint64_t SIN_COL01 = ~0x0303030303030303ULL;
+const uint64_t SIN_COL67 = ~0xC0C0C0C0C0C0C0C0ULL;
+const uint64_t FILA0 = 0xFFULL;                   // última fila de las blancas
+const uint64_t FILA2 = 0xFFULL << 16;             // los peones negros llegan aquí al salir
+const uint64_t FILA5 = 0xFFULL << 40;             // y los blancos aquí
+const uint64_t FILA7 = 0xFFULL << 56;             // última fila de las negras
+
+// todo unos si x no es cero
+EN_LINEA uint64_t siNoCero(uint64_t x){ return -(uint64_t)(x != 0); }
+EN_LINEA Cuatro siNoCero(Cuatro x){ return (Cuatro)(x != 0); }
+
+EN_LINEA void poner(uint64_t &v, int, uint64_t x){ v = x; }
+EN_LINEA void poner(Cuatro &v, int carril, uint64_t x){ v[carril] = x; }
+
+// Casilla (f,c) -> f*8+c: subir una fila es restar 8, ir a la derecha sumar 1
+template <int S, class V>
+EN_LINEA V mover(V x){
+    if constexpr (S > 0) return x << S;
+    else return x >> -S;
+}
+
+// Casillas a las que llega una deslizante desde 'desde' en la dirección S hasta la primera
+// pieza (incluida), con 'vacias' como casillas libres. Relleno de Kogge-Stone: tres pasos
+// en vez de siete. BORDE quita lo que da la vuelta por el lateral del tablero.
+template <int S, uint64_t BORDE, class V>
+EN_LINEA V rayo(V desde, V vacias){
+    V pro = vacias & BORDE;
+    V gen = desde;
+    gen |= pro & mover<S>(gen);
+    pro &= mover<S>(pro);
+    gen |= pro & mover<2*S>(gen);
+    pro &= mover<2*S>(pro);
+    gen |= pro & mover<4*S>(gen);
+    return mover<S>(gen) & BORDE;
+}
+
+template <class V>
+EN_LINEA V rectas(V desde, V vacias){
+    return rayo<-8, ~0ULL>(desde, vacias) | rayo<8, ~0ULL>(desde, vacias)
+         | rayo<1, SIN_COL0>(desde, vacias) | rayo<-1, SIN_COL7>(desde, vacias);
+}
+
+template <class V>
+EN_LINEA V diagonales(V desde, V vacias){
+    return rayo<-7, SIN_COL0>(desde, vacias) | rayo<-9, SIN_COL7>(desde, vacias)
+         | rayo<9, SIN_COL0>(desde, vacias) | rayo<7, SIN_COL7>(desde, vacias);
+}
+
+template <class V>
+EN_LINEA V saltosCaballo(V x){
+    return (mover<-17>(x) & SIN_COL7) | (mover<-15>(x) & SIN_COL0) | (mover<-10>(x) & SIN_COL67) | (mover<-6>(x) & SIN_COL01)
+         | (mover<6>(x) & SIN_COL67) | (mover<10>(x) & SIN_COL01) | (mover<15>(x) & SIN_COL7) | (mover<17>(x) & SIN_COL0);
+}
+
+template <class V>
+EN_LINEA V alrededor(V x){
+    return mover<-8>(x) | mover<8>(x) | ((mover<1>(x) | mover<-7>(x) | mover<9>(x)) & SIN_COL0)
+         | ((mover<-1>(x) | mover<-9>(x) | mover<7>(x)) & SIN_COL7);
+}
+
+// Casillas que atacan los peones de las casillas 'x' (blancos donde 'blancas' está a unos)
+template <class V>
+EN_LINEA V ataquesPeon(V x, V blancas){
+    V b = (mover<-7>(x) & SIN_COL0) | (mover<-9>(x) & SIN_COL7);
+    V n = (mover<9>(x) & SIN_COL0) | (mover<7>(x) & SIN_COL7);
+    return (b & blancas) | (n & ~blancas);
+}
+
+// ---------------------- Carriles ----------------------
+// Lo que necesita el núcleo de cada jugada, ya visto desde el bando que mueve
+template <class V>
+struct Carriles {
+    V propias, rivales;
+    V peones, caballos, alfiles, torres, damas, reyes;    // de los dos bandos
+    V origen, destino;               // un bit cada uno (0 si la casilla no existe)
+    V protegida, alPaso;             // un bit o 0
+    V blancas;                       // máscara: mueven las blancas
+    V promocion;                     // máscara: la jugada pide una pieza de promoción
+    V promocionValida;               // máscara: y es torre, caballo, alfil o dama
+    V guardia;                       // bit de la pieza que se protege (0 sin guardia)
+    V guardiaMal;                    // máscara: pide guardia y no puede (usada, fuera o sin Regla 1)
+};
+
+template <class Variante, class V>
+EN_LINEA void cargar(Carriles<V> &c, int carril, const PosicionLote &p, const Jugada &j){
+    auto bit = [](uint8_t casilla){ return casilla < FILAS*COLS ? 1ULL << casilla : 0; };
+    auto mascara = [](bool b){ return b ? ~0ULL : 0; };
+    poner(c.propias, carril, p.bandos[p.turno]);
+    poner(c.rivales, carril, p.bandos[1 - p.turno]);
+    poner(c.peones, carril, p.tipos[(int)TipoPieza::Pawn]);
+    poner(c.caballos, carril, p.tipos[(int)TipoPieza::Knight]);
+    poner(c.alfiles, carril, p.tipos[(int)TipoPieza::Bishop]);
+    poner(c.torres, carril, p.tipos[(int)TipoPieza::Rook]);
+    poner(c.damas, carril, p.tipos[(int)TipoPieza::Queen]);
+    poner(c.reyes, carril, p.tipos[(int)TipoPieza::King]);
+    poner(c.origen, carril, bit(j.origen));
+    poner(c.destino, carril, bit(j.destino));
+    poner(c.protegida, carril, Variante::guardia ? p.protegida : 0);
+    poner(c.alPaso, carril, bit(p.alPaso));
+    poner(c.blancas, carril, mascara(p.turno == (uint8_t)ColorPieza::White));
+    poner(c.promocion, carril, mascara(j.promocion != 0));
+    poner(c.promocionValida, carril, mascara(j.promocion >= 1 + (int)TipoPieza::Rook && j.promocion <= 1 + (int)TipoPieza::Queen));
+    bool conGuardia = j.guardia != SIN_CASILLA;
+    poner(c.guardia, carril, conGuardia ? bit(j.guardia) : 0);
+    poner(c.guardiaMal, carril, mascara(conGuardia && (!Variante::guardia || p.guardiaUsada || j.guardia >= FILAS*COLS)));
+}
+
+// Piezas rivales que atacan 'casilla' con esa ocupación (todo el tablero de una vez por carril)
+template <class V>
+EN_LINEA V atacantes(const Carriles<V> &c, V casilla, V ocupadas, V rivales){
+    V vacias = ~ocupadas;
+    V r = (saltosCaballo(casilla) & c.caballos) | (alrededor(casilla) & c.reyes)
+        | (ataquesPeon(casilla, c.blancas) & c.peones)
+        | (rectas(casilla, vacias) & (c.torres | c.damas))
+        | (diagonales(casilla, vacias) & (c.alfiles | c.damas));
+    return r & rivales;
+}
+
+// El núcleo: 'legal' con la jugada entera comprobada; 'enroque' si es un rey que se mueve más
+// de una casilla y todo lo demás está bien (falta comprobar el enroque en sí)
+template <class V>
+EN_LINEA void comprobar(const Carriles<V> &c, V &legal, V &enroque){
+    V ocupadas = c.propias | c.rivales;
+    V vacias = ~ocupadas;
+    V o = c.origen, d = c.destino;
+    V esPeon = siNoCero(o & c.peones), esCaballo = siNoCero(o & c.caballos), esRey = siNoCero(o & c.reyes);
+    V esDama = siNoCero(o & c.damas);
+    V esRecta = siNoCero(o & c.torres) | esDama, esDiagonal = siNoCero(o & c.alfiles) | esDama;
+
+    // peones: avance, avance doble desde la fila de salida, capturas y al paso
+    V avance = ((mover<-8>(o) & c.blancas) | (mover<8>(o) & ~c.blancas)) & vacias;
+    V doble = ((mover<-8>(avance & FILA5) & c.blancas) | (mover<8>(avance & FILA2) & ~c.blancas)) & vacias;
+    V diagonalPeon = ataquesPeon(o, c.blancas);
+    V alPaso = diagonalPeon & c.alPaso & vacias;
+    V victimaAlPaso = ((mover<8>(alPaso) & c.blancas) | (mover<-8>(alPaso) & ~c.blancas)) & ocupadas & ~c.protegida;
+    alPaso &= siNoCero(victimaAlPaso);
+
+    // a dónde llega la pieza de origen, sin mirar al rey
+    V alcance = (esPeon & (avance | doble | (diagonalPeon & c.rivales) | alPaso))
+              | (esCaballo & saltosCaballo(o)) | (esRey & alrededor(o))
+              | (esRecta & rectas(o, vacias)) | (esDiagonal & diagonales(o, vacias));
+
+    // la jugada en sí: origen propio, destino ni propio ni protegido, promoción y guardia
+    V corona = esPeon & siNoCero(d & ((FILA0 & c.blancas) | (FILA7 & ~c.blancas)));
+    V bien = siNoCero(o & c.propias) & ~siNoCero(d & (c.propias | c.protegida))
+           & ~(c.promocion & ~(corona & c.promocionValida))
+           & ~c.guardiaMal & ~(siNoCero(c.guardia) & ~siNoCero(c.guardia & c.propias));
+
+    // el rey propio después de la jugada (la captura al paso quita el peón de al lado)
+    V quitada = esPeon & siNoCero(d & alPaso) & victimaAlPaso;
+    V ocupadasDespues = (ocupadas & ~o & ~quitada) | d;
+    V rivalesDespues = c.rivales & ~d & ~quitada;
+    V rey = (esRey & d) | (~esRey & c.reyes & c.propias);
+    V jaque = siNoCero(atacantes(c, rey, ocupadasDespues, rivalesDespues));
+
+    legal = bien & siNoCero(alcance & d) & ~jaque;
+    enroque = bien & esRey & ~siNoCero(d & alrededor(o));
+}
+
+// ---------------------- Enroque ----------------------
+// Como destinosEnroque (Reglas.cpp): rey y torre de la esquina sin mover, nada entre ellos y
+// ninguna casilla del rey atacada (salida, paso y llegada); el extendido una vez por partida
+template <class Variante>
+static bool enroqueLegal(const PosicionLote &p, const Jugada &j){
+    uint64_t propias = p.bandos[p.turno], ocupadas = p.bandos[0] | p.bandos[1];
+    int sF = j.origen / COLS, sC = j.origen % COLS, dC = j.destino % COLS;
+    if (j.destino / COLS != sF || !(p.sinMover & (1ULL << j.origen))) return false;
+    int pasos = abs(dC - sC), dir = (dC > sC) ? 1 : -1;
+    int maxPasos = (Variante::enroqueExtendido && !p.enroque3Usado) ? 3 : 2;
+    if (pasos < 2 || pasos > maxPasos) return false;
+    int torreC = (dir > 0) ? COLS-1 : 0;
+    if (!(p.tipos[(int)TipoPieza::Rook] & propias & p.sinMover & bitCasilla(sF, torreC))) return false;
+    for (int cc = (dir > 0 ? sC+1 : torreC+1); cc < (dir > 0 ? torreC : sC); ++cc)
+        if (ocupadas & bitCasilla(sF, cc)) return false;
+
+    Carriles<uint64_t> c;
+    cargar<Variante>(c, 0, p, j);
+    for (int k = 0; k <= pasos; ++k){
+        uint64_t casilla = bitCasilla(sF, sC + k*dir);
+        if (k >= 2 && (propias & casilla)) return false;
+        if (atacantes(c, casilla, ocupadas, c.rivales)) return false;
+    }
+    return true;
+}
+
+// ---------------------- Núcleos ----------------------
+template <class Variante>
+static uint8_t validarUna(const PosicionLote &p, const Jugada &j){
+    Carriles<uint64_t> c;
+    cargar<Variante>(c, 0, p, j);
+    uint64_t legal, enroque;
+    comprobar(c, legal, enroque);
+    if (enroque) return enroqueLegal<Variante>(p, j);
+    return (uint8_t)(legal & 1);
+}
+
+#ifdef ALMATE_LOTE_AVX2
+// De cuatro en cuatro; devuelve cuántas hizo (el resto, menos de cuatro, van una a una)
+template <class Variante>
+__attribute__((target("avx2"))) static size_t validarAvx2(const PosicionLote *posiciones, const Jugada *jugadas, size_t n, uint8_t *legales){
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4){
+        Carriles<Cuatro> c;
+        for (int k=0; k<4; ++k) cargar<Variante>(c, k, posiciones[i+k], jugadas[i+k]);
+        Cuatro legal, enroque;
+        comprobar(c, legal, enroque);
+        for (int k=0; k<4; ++k){
+            legales[i+k] = (uint8_t)(legal[k] & 1);
+            if (enroque[k]) legales[i+k] = enroqueLegal<Variante>(posiciones[i+k], jugadas[i+k]);
+        }
+    }
+    return i;
+}
+#endif
+
+bool avx2Disponible(){
+#ifdef ALMATE_LOTE_AVX2
+    static const bool disponible = __builtin_cpu_supports("avx2");
+    return disponible;
+#else
+    return false;
+#endif
+}
+
+template <class Variante>
+void validarLote(const PosicionLote *posiciones, const Jugada *jugadas, size_t n, uint8_t *legales, NucleoLote nucleo){
+    size_t i = 0;
+#ifdef ALMATE_LOTE_AVX2
+    if (nucleo != NucleoLote::Escalar && avx2Disponible()) i = validarAvx2<Variante>(posiciones, jugadas, n, legales);
+#endif
+    for (; i < n; ++i) legales[i] = validarUna<Variante>(posiciones[i], jugadas[i]);
+}
+
+// ---------------------- Posiciones ----------------------
+void posicionALote(PosicionLote &p, const vector<Pieza>& piezas, const Tablero& tablero, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro,
+                   ColorPieza turno){
+    p = PosicionLote();
+    for (int f=0; f<FILAS; ++f)
+        for (int c=0; c<COLS; ++c){
+            int i = tablero[f][c];
+            if (i == -1) continue;
+            const Pieza &q = piezas[i];
+            p.bandos[(int)q.color] |= bitCasilla(f,c);
+            p.tipos[(int)q.tipo] |= bitCasilla(f,c);
+            if (!q.hasMoved) p.sinMover |= bitCasilla(f,c);
+        }
+    const ReglasFlags &propios = (turno == ColorPieza::White) ? flagsBlanco : flagsNegro;
+    const ReglasFlags &rivales = (turno == ColorPieza::White) ? flagsNegro : flagsBlanco;
+    p.turno = (uint8_t)turno;
+    p.alPaso = (rivales.alPaso >= 0) ? (uint8_t)rivales.alPaso : SIN_CASILLA;
+    if (rivales.proteccionActiva && rivales.guardiaIdx >= 0){
+        const Pieza &g = piezas[rivales.guardiaIdx];
+        if (g.alive && dentroTablero(g.fila, g.col)) p.protegida = bitCasilla(g.fila, g.col);
+    }
+    p.guardiaUsada = propios.guardiaUsado;
+    p.enroque3Usado = propios.enroque3Usado;
+}
+
+// ---------------------- Instanciaciones ----------------------
+template void validarLote<ReglasEstandar>(const PosicionLote*, const Jugada*, size_t, uint8_t*, NucleoLote);
+template void validarLote<ReglasAlmate>(const PosicionLote*, const Jugada*, size_t, uint8_t*, NucleoLote);
@@ -0,0 +1,275 @@
+// Mate.cpp
+// Buscador de mates forzados (libalmate). Ver Mate.hpp.
+
+#include "Mate.hpp"
+
+// ---------------------- Estado ----------------------
+void BuscadorMate::aplicar(const Jugada& j, RegistroDeshacer& reg){
+    aplicarJugada(piezas, tablero, j, flagsBlanco, flagsNegro, turno, &reg);
+    nodos++;
+    if (limiteNodos && nodos >= limiteNodos) abortado = true;
+}
+
+void BuscadorMate::deshacer(const Jugada& j, const RegistroDeshacer& reg){
+    deshacerJugada(piezas, tablero, j, reg, flagsBlanco, flagsNegro, turno);
+}
+
+// Jugadas de una máscara de movimientos; al llegar a la última fila, una por pieza de promoción
+void BuscadorMate::jugadasDe(const MovimientosTurno& mt, vector<Jugada>& out) const {
+    static const TipoPieza PROMOCIONES[4] = { TipoPieza::Queen, TipoPieza::Rook, TipoPieza::Bishop, TipoPieza::Knight };
+    out.clear();
+    for (int o=0; o<FILAS*COLS; ++o){
+        uint64_t m = mt.destinos[o];
+        if (!m) continue;
+        bool peon = piezas[tablero[o / COLS][o % COLS]].tipo == TipoPieza::Pawn;
+        for (; m; m &= m - 1){
+            Jugada j;
+            j.origen = (uint8_t)o;
+            j.destino = (uint8_t)__builtin_ctzll(m);
+            int fila = j.destino / COLS;
+            if (peon && (fila == 0 || fila == FILAS-1)){
+                for (TipoPieza t : PROMOCIONES){
+                    j.promocion = (uint8_t)(1 + (int)t);
+                    out.push_back(j);
+                }
+            } else {
+                out.push_back(j);
+            }
+        }
+    }
+}
+
+// Casillas de las piezas de 'color' que el rival puede capturar con alguna de sus jugadas
+uint64_t BuscadorMate::capturables(const MovimientosTurno& mtRival, ColorPieza color) const {
+    uint64_t r = 0;
+    for (int o=0; o<FILAS*COLS; ++o){
+        uint64_t m = mtRival.destinos[o];
+        if (!m) continue;
+        bool peon = piezas[tablero[o / COLS][o % COLS]].tipo == TipoPieza::Pawn;
+        for (; m; m &= m - 1){
+            int d = __builtin_ctzll(m);
+            int v = tablero[d / COLS][d % COLS];
+            if (v == -1 && peon && d % COLS != o % COLS){
+                // al paso: la víctima está al lado del origen
+                d = indiceCasilla(o / COLS, d % COLS);
+                v = tablero[o / COLS][d % COLS];
+            }
+            if (v != -1 && piezas[v].color == color && piezas[v].tipo != TipoPieza::King) r |= 1ULL << d;
+        }
+    }
+    return r;
+}
+
+// La guardia se indica con la casilla de la pieza antes de la jugada
+uint8_t BuscadorMate::casillaAntes(int casilla, const Jugada& j, const RegistroDeshacer& reg) const {
+    int idx = tablero[casilla / COLS][casilla % COLS];
+    if (idx == reg.mover) return j.origen;
+    if (idx == reg.torre) return (uint8_t)indiceCasilla(casilla / COLS, reg.torreCol);
+    return (uint8_t)casilla;
+}
+
+// Los jaques primero: casi todos los mates forzados empiezan con uno y así se encuentran antes
+void BuscadorMate::ordenarJaquesPrimero(vector<Jugada>& lista){
+    ColorPieza defensor = (turno == ColorPieza::White) ? ColorPieza::Black : ColorPieza::White;
+    size_t jaques = 0;
+    for (size_t i=0; i<lista.size(); ++i){
+        RegistroDeshacer reg;
+        aplicar(lista[i], reg);
+        bool jaque = estaEnJaque(piezas, tablero, defensor);
+        deshacer(lista[i], reg);
+        if (jaque) std::swap(lista[i], lista[jaques++]);
+    }
+}
+
+// ---------------------- Búsqueda ----------------------
+// Atacante al turno (mts[ply] calculado): ¿mate en 'n' jugadas o menos?
+bool BuscadorMate::ataque(int n, int ply){
+    if (abortado) return false;
+    uint64_t h = hash();
+    auto it = tabla.find(h);
+    if (it != tabla.end()){
+        if (it->second.mate && it->second.mate <= n) return true;
+        if (it->second.sinMate >= n) return false;
+    }
+
+    vector<Jugada> &lista = listas[ply];
+    jugadasDe(mts[ply], lista);
+    if (n > 1) ordenarJaquesPrimero(lista);
+    Jugada usada;
+    bool mate = false;
+    for (const Jugada &j : lista){
+        if (probar(j, n, ply, &usada)){ mate = true; break; }
+        if (abortado) return false;
+    }
+
+    if (tabla.size() >= maxEntradas) tabla.clear();
+    EntradaTT &e = tabla[h];
+    if (mate){
+        if (!e.mate || n < e.mate){ e.mate = (uint8_t)n; e.mejor = usada; }
+    } else if (n > e.sinMate){
+        e.sinMate = (uint8_t)n;
+    }
+    return mate;
+}
+
+// El atacante juega 'j' (y, si no basta, 'j' con la guardia): ¿mate en 'n' o menos?
+bool BuscadorMate::probar(const Jugada& j, int n, int ply, Jugada* usada){
+    ColorPieza atacante = turno;
+    ColorPieza defensor = (turno == ColorPieza::White) ? ColorPieza::Black : ColorPieza::White;
+    bool guardiaLibre = !flagsDe(atacante).guardiaUsado;
+
+    RegistroDeshacer reg;
+    aplicar(j, reg);
+    // mate en 1: sin jaque no hay nada que mirar (la guardia no da jaque)
+    if (n == 1 && !estaEnJaque(piezas, tablero, defensor)){
+        deshacer(j, reg);
+        return false;
+    }
+    calcularMovimientosTurno(mts[ply+1], piezas, tablero, turno, flagsBlanco, flagsNegro);
+    bool mate = defensa(n, ply+1);
+
+    uint8_t guardias[16];
+    int numGuardias = 0;
+    if (!mate && !abortado && guardiaLibre){
+        for (uint64_t c = capturables(mts[ply+1], atacante); c && numGuardias < 16; c &= c - 1)
+            guardias[numGuardias++] = casillaAntes(__builtin_ctzll(c), j, reg);
+    }
+    deshacer(j, reg);
+    if (mate){ *usada = j; return true; }
+
+    // Regla 1: proteger la pieza que el rival necesita capturar
+    for (int k=0; k<numGuardias && !abortado; ++k){
+        Jugada jg = j;
+        jg.guardia = guardias[k];
+        aplicar(jg, reg);
+        calcularMovimientosTurno(mts[ply+1], piezas, tablero, turno, flagsBlanco, flagsNegro);
+        mate = defensa(n, ply+1);
+        deshacer(jg, reg);
+        if (mate){ *usada = jg; return true; }
+    }
+    return false;
+}
+
+// Defensor al turno (mts[ply] calculado) tras la jugada 'n' del atacante: ¿todas sus jugadas
+// acaban en mate en las n-1 restantes?
+bool BuscadorMate::defensa(int n, int ply){
+    const MovimientosTurno &mt = mts[ply];
+    if (mt.total == 0) return (turno == ColorPieza::White) ? mt.blancoEnJaque : mt.negroEnJaque;
+    if (n == 1 || abortado) return false;
+
+    ColorPieza defensor = turno;
+    bool guardiaLibre = !flagsDe(defensor).guardiaUsado;
+    vector<Jugada> &lista = listas[ply];
+    jugadasDe(mt, lista);
+    for (const Jugada &j : lista){
+        RegistroDeshacer reg;
+        aplicar(j, reg);
+        calcularMovimientosTurno(mts[ply+1], piezas, tablero, turno, flagsBlanco, flagsNegro);
+        bool mate = ataque(n-1, ply+1);
+
+        uint8_t guardias[16];
+        int numGuardias = 0;
+        if (mate && guardiaLibre){
+            for (uint64_t c = capturables(mts[ply+1], defensor); c && numGuardias < 16; c &= c - 1)
+                guardias[numGuardias++] = casillaAntes(__builtin_ctzll(c), j, reg);
+        }
+        deshacer(j, reg);
+        if (!mate || abortado) return false;
+
+        for (int k=0; k<numGuardias; ++k){
+            Jugada jg = j;
+            jg.guardia = guardias[k];
+            aplicar(jg, reg);
+            calcularMovimientosTurno(mts[ply+1], piezas, tablero, turno, flagsBlanco, flagsNegro);
+            mate = ataque(n-1, ply+1);
+            deshacer(jg, reg);
+            if (!mate || abortado) return false;
+        }
+    }
+    return true;
+}
+
+// Mate más corto del atacante al turno (mts[ply] calculado) hasta 'n'; 0 si no hay
+int BuscadorMate::distanciaMate(int n, int ply){
+    for (int k=1; k<=n; ++k){
+        if (ataque(k, ply)) return k;
+        if (abortado) break;
+    }
+    return 0;
+}
+
+// ---------------------- Problema ----------------------
+ProblemaMate BuscadorMate::resolver(const vector<Pieza>& piezasIni, const Tablero& tableroIni, const ReglasFlags& flagsBlancoIni, const ReglasFlags& flagsNegroIni,
+                                    ColorPieza turnoIni, int maxN, unsigned long long maxNodos){
+    piezas = piezasIni;
+    tablero = tableroIni;
+    flagsBlanco = flagsBlancoIni;
+    flagsNegro = flagsNegroIni;
+    turno = turnoIni;
+    if (maxN < 1) maxN = 1;
+    if (maxN > 100) maxN = 100;
+    mts.resize(2*maxN + 2);
+    listas.resize(2*maxN + 2);
+    abortado = false;
+    limiteNodos = maxNodos ? nodos + maxNodos : 0;
+
+    ProblemaMate r;
+    calcularMovimientosTurno(mts[0], piezas, tablero, turno, flagsBlanco, flagsNegro);
+    r.jugadas = distanciaMate(maxN, 0);
+    if (!r.jugadas){
+        r.abortado = abortado;
+        return r;
+    }
+
+    // jugadas clave: las que dan mate en N (la misma jugada con y sin guardia cuenta una vez)
+    vector<Jugada> candidatas;
+    jugadasDe(mts[0], candidatas);
+    for (const Jugada &j : candidatas){
+        Jugada usada;
+        if (probar(j, r.jugadas, 0, &usada)){
+            if (r.claves == 0) r.clave = usada;
+            if (++r.claves >= 2) break;
+        }
+        if (abortado){ r.abortado = true; return r; }
+    }
+
+    // línea principal: la defensa que más alarga el mate y la respuesta más corta
+    struct Hecha { Jugada j; RegistroDeshacer reg; };
+    vector<Hecha> hechas;
+    Jugada j = r.clave;
+    int n = r.jugadas;
+    vector<Jugada> defensas;
+    for (;;){
+        hechas.push_back({ j, RegistroDeshacer() });
+        aplicar(j, hechas.back().reg);
+        r.linea.push_back(j);
+        calcularMovimientosTurno(mts[0], piezas, tablero, turno, flagsBlanco, flagsNegro);
+        if (mts[0].total == 0 || n <= 1) break;
+
+        jugadasDe(mts[0], defensas);
+        int peor = 0;
+        Jugada elegida;
+        for (const Jugada &d : defensas){
+            RegistroDeshacer reg;
+            aplicar(d, reg);
+            calcularMovimientosTurno(mts[0], piezas, tablero, turno, flagsBlanco, flagsNegro);
+            int k = distanciaMate(n-1, 0);
+            deshacer(d, reg);
+            if (k > peor){ peor = k; elegida = d; }
+        }
+        if (peor == 0) break;
+
+        hechas.push_back({ elegida, RegistroDeshacer() });
+        aplicar(elegida, hechas.back().reg);
+        r.linea.push_back(elegida);
+        calcularMovimientosTurno(mts[0], piezas, tablero, turno, flagsBlanco, flagsNegro);
+        if (!ataque(peor, 0)) break;
+        auto it = tabla.find(hash());
+        if (it == tabla.end()) break;
+        j = it->second.mejor;
+        n = peor;
+    }
+    for (int i = (int)hechas.size() - 1; i >= 0; --i) deshacer(hechas[i].j, hechas[i].reg);
+    r.abortado = abortado;
+    return r;
+}
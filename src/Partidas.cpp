@@ -0,0 +1,530 @@
+// Partidas.cpp
+// Base de partidas indexada (IndicePartidas.hpp). Tres órdenes:
+//   indexar  lee un archivo de partidas (una por línea, jugadas en la notación del protocolo
+//            separadas por espacios; las líneas vacías o que empiezan por '#' no cuentan) y
+//            escribe su índice. Un hilo lee bloques de líneas y varios repiten las partidas y
+//            reparten sus términos en CUBOS archivos temporales según los bits altos de la clave;
+//            después cada cubo se ordena por separado (también en varios hilos) y se escribe
+//            directamente en su sitio del índice. La memoria no depende del número de partidas.
+//   buscar   partidas que cumplen todo lo pedido (intersección de las listas del índice mapeado)
+//   azar     escribe partidas jugadas al azar (con guardia y promociones) para probar
+// Uso: Partidas.exe indexar partidas.txt [--indice partidas.indice] [--hilos N] [--bloque 4096]
+//      Partidas.exe buscar [--indice partidas.indice] [--fen "<FEN>"] [--jugadas "e2e4 e7e5"]
+//                          [--material RD-RT] [--suceso enroque3] [--partidas partidas.txt] [--max 20]
+//      Partidas.exe azar 100000 [--salida partidas.txt] [--max-jugadas 160] [--hilos N] [--semilla 7]
+// Solo Linux/POSIX (mmap, pread).
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include "Protocolo.hpp"
+#include "IndicePartidas.hpp"
+using namespace std;
+
+typedef chrono::steady_clock Reloj;
+
+const int BITS_CUBOS = 8;
+const int CUBOS = 1 << BITS_CUBOS;
+const size_t APARICIONES_POR_HILO = 1 << 20;    // lo que junta cada hilo antes de vaciarlo a los cubos
+
+// Un término de una partida, tal como va a los archivos de los cubos
+struct Aparicion {
+    uint64_t termino;
+    uint32_t partida;
+    uint32_t relleno;
+    bool operator<(const Aparicion &o) const { return termino != o.termino ? termino < o.termino : partida < o.partida; }
+};
+
+// ---------------------- Términos de una partida ----------------------
+struct EstadisticasIndice {
+    long partidas = 0;             // líneas con jugadas
+    long jugadas = 0;
+    long ilegales = 0;             // partidas cortadas en una jugada ilegal
+    long apariciones = 0;
+};
+
+// Repite la partida y deja en 'terminos' sus términos sin repetir
+void terminosPartida(const string &linea, EstadoPartida &e, vector<uint64_t> &terminos, EstadisticasIndice &est){
+    terminos.clear();
+    size_t i = 0;
+    while (i < linea.size() && isspace((unsigned char)linea[i])) i++;
+    if (i == linea.size() || linea[i] == '#') return;
+    est.partidas++;
+
+    e.iniciar();
+    terminos.push_back(terminoPosicion(e.piezas, e.tablero, e.turno));
+    CuentaMaterial material = cuentaMaterial(e.piezas);
+    terminos.push_back(terminoMaterial(material));
+    string txt;
+    bool legal = true;
+    while (i < linea.size()){
+        size_t fin = i;
+        while (fin < linea.size() && !isspace((unsigned char)linea[fin])) fin++;
+        txt.assign(linea, i, fin - i);
+        i = fin;
+        while (i < linea.size() && isspace((unsigned char)linea[i])) i++;
+
+        Jugada j;
+        if (!textoAJugada(txt, j) || e.tablero[j.origen / COLS][j.origen % COLS] == -1){ legal = false; break; }
+        const Pieza &p = e.piezas[e.tablero[j.origen / COLS][j.origen % COLS]];
+        int columnas = abs(j.destino % COLS - j.origen % COLS);
+        bool rey = p.tipo == TipoPieza::King, peon = p.tipo == TipoPieza::Pawn;
+        bool alPaso = peon && columnas == 1 && e.tablero[j.destino / COLS][j.destino % COLS] == -1;
+        EfectoJugada ef;
+        if (!e.jugar(j, &ef)){ legal = false; break; }
+        est.jugadas++;
+
+        if (j.guardia != SIN_CASILLA) terminos.push_back(terminoSuceso("guardia"));
+        if (rey && columnas == 3) terminos.push_back(terminoSuceso("enroque3"));
+        if (rey && columnas == 2) terminos.push_back(terminoSuceso("enroque"));
+        if (alPaso) terminos.push_back(terminoSuceso("alpaso"));
+        if (j.promocion != 0){
+            terminos.push_back(terminoSuceso("promocion"));
+            if (j.promocion != 1 + (int)TipoPieza::Queen) terminos.push_back(terminoSuceso("subpromocion"));
+        }
+        terminos.push_back(terminoPosicion(e.piezas, e.tablero, e.turno));
+        // el material solo cambia al capturar o promocionar
+        if (ef.victima != -1 || j.promocion != 0){
+            material = cuentaMaterial(e.piezas);
+            terminos.push_back(terminoMaterial(material));
+        }
+    }
+    if (!legal){
+        est.ilegales++;
+        terminos.push_back(terminoSuceso("ilegal"));
+    } else {
+        MovimientosTurno mt;
+        e.movimientos(mt);
+        ResultadoPartida r = e.resultado(mt);
+        if (r != ResultadoPartida::EnJuego) terminos.push_back(terminoSuceso(nombreSucesoResultado(r)));
+    }
+    sort(terminos.begin(), terminos.end());
+    terminos.erase(unique(terminos.begin(), terminos.end()), terminos.end());
+}
+
+// ---------------------- indexar ----------------------
+struct Bloque {
+    vector<string> lineas;
+    size_t numLineas = 0;
+    uint32_t primera = 0;          // número de partida de lineas[0]
+};
+
+string rutaCubo(const string &indice, int c){ return indice + ".cubo" + to_string(c); }
+
+int indexar(int argc, char** argv){
+    string entrada, rutaIndice = "partidas.indice";
+    int hilos = (int)thread::hardware_concurrency();
+    size_t tamBloque = 4096, enVuelo = 64;
+    for (int i=2; i<argc; ++i){
+        string arg = argv[i];
+        if (arg == "--indice" && i+1 < argc) rutaIndice = argv[++i];
+        else if (arg == "--hilos" && i+1 < argc) hilos = atoi(argv[++i]);
+        else if (arg == "--bloque" && i+1 < argc) tamBloque = (size_t)atol(argv[++i]);
+        else if (arg == "--en-vuelo" && i+1 < argc) enVuelo = (size_t)atol(argv[++i]);
+        else entrada = arg;
+    }
+    if (hilos < 1) hilos = 1;
+    if (tamBloque < 1) tamBloque = 1;
+    if (enVuelo < 2) enVuelo = 2;
+
+    static char bufEntrada[1 << 20];
+    ifstream in;
+    in.rdbuf()->pubsetbuf(bufEntrada, sizeof(bufEntrada));
+    in.open(entrada, ios::binary);
+    struct stat st;
+    if (entrada.empty() || !in || ::stat(entrada.c_str(), &st) != 0){ cerr << "No se puede abrir " << entrada << "\n"; return 1; }
+
+    FILE *cubos[CUBOS];
+    mutex mtxCubos[CUBOS];
+    vector<uint64_t> aparicionesCubo(CUBOS, 0);
+    for (int c=0; c<CUBOS; ++c){
+        cubos[c] = fopen(rutaCubo(rutaIndice, c).c_str(), "w+b");
+        if (!cubos[c]){ cerr << "No se puede escribir " << rutaCubo(rutaIndice, c) << "\n"; return 1; }
+    }
+
+    // 1) repetir las partidas y repartir sus términos en los cubos
+    Reloj::time_point t0 = Reloj::now();
+    vector<Bloque> ranuras(enVuelo);
+    deque<Bloque*> libres, llenos;
+    for (Bloque &b : ranuras) libres.push_back(&b);
+    mutex m;
+    condition_variable cv;
+    bool finLectura = false;
+    EstadisticasIndice total;
+
+    vector<thread> trabajadores;
+    for (int h=0; h<hilos; ++h){
+        trabajadores.emplace_back([&](){
+            EstadoPartida e;
+            vector<uint64_t> terminos;
+            EstadisticasIndice est;
+            vector<vector<Aparicion>> porCubo(CUBOS);
+            size_t juntas = 0;
+            auto vaciar = [&](){
+                for (int c=0; c<CUBOS; ++c){
+                    if (porCubo[c].empty()) continue;
+                    lock_guard<mutex> lock(mtxCubos[c]);
+                    fwrite(porCubo[c].data(), sizeof(Aparicion), porCubo[c].size(), cubos[c]);
+                    aparicionesCubo[c] += porCubo[c].size();
+                    porCubo[c].clear();
+                }
+                juntas = 0;
+            };
+            for (;;){
+                Bloque *b;
+                {
+                    unique_lock<mutex> lock(m);
+                    cv.wait(lock, [&]{ return !llenos.empty() || finLectura; });
+                    if (llenos.empty()) break;
+                    b = llenos.front();
+                    llenos.pop_front();
+                }
+                for (size_t i=0; i<b->numLineas; ++i){
+                    terminosPartida(b->lineas[i], e, terminos, est);
+                    for (uint64_t t : terminos) porCubo[t >> (64 - BITS_CUBOS)].push_back({ t, b->primera + (uint32_t)i, 0 });
+                    juntas += terminos.size();
+                    est.apariciones += (long)terminos.size();
+                }
+                if (juntas >= APARICIONES_POR_HILO) vaciar();
+                {
+                    lock_guard<mutex> lock(m);
+                    libres.push_back(b);
+                }
+                cv.notify_all();
+            }
+            vaciar();
+            lock_guard<mutex> lock(m);
+            total.partidas += est.partidas;
+            total.jugadas += est.jugadas;
+            total.ilegales += est.ilegales;
+            total.apariciones += est.apariciones;
+        });
+    }
+
+    // lector (este hilo): cada línea es una partida; se apunta dónde empieza
+    vector<uint64_t> desplazamientos;
+    uint64_t desplazamiento = 0;
+    for (bool quedan = true; quedan; ){
+        Bloque *b;
+        {
+            unique_lock<mutex> lock(m);
+            cv.wait(lock, [&]{ return !libres.empty(); });
+            b = libres.front();
+            libres.pop_front();
+        }
+        if (b->lineas.size() < tamBloque) b->lineas.resize(tamBloque);
+        b->numLineas = 0;
+        b->primera = (uint32_t)desplazamientos.size();
+        while (b->numLineas < tamBloque && getline(in, b->lineas[b->numLineas])){
+            desplazamientos.push_back(desplazamiento);
+            desplazamiento += b->lineas[b->numLineas].size() + 1;
+            b->numLineas++;
+        }
+        quedan = b->numLineas == tamBloque;
+        {
+            lock_guard<mutex> lock(m);
+            if (b->numLineas > 0) llenos.push_back(b);
+            else libres.push_back(b);
+            if (!quedan) finLectura = true;
+        }
+        cv.notify_all();
+    }
+    for (thread &t : trabajadores) t.join();
+    uint64_t partidas = desplazamientos.size();
+    desplazamientos.push_back((uint64_t)st.st_size);
+    double segundosLectura = chrono::duration<double>(Reloj::now() - t0).count();
+
+    // 2) cada cubo se ordena y sus listas van a su sitio: las claves de un cubo van todas
+    // detrás de las del anterior, así que sus apariciones también
+    Reloj::time_point t1 = Reloj::now();
+    uint64_t apariciones = 0;
+    vector<uint64_t> primeraCubo(CUBOS + 1, 0);
+    for (int c=0; c<CUBOS; ++c){
+        primeraCubo[c] = apariciones;
+        apariciones += aparicionesCubo[c];
+    }
+    primeraCubo[CUBOS] = apariciones;
+
+    string temporal = rutaIndice + ".nuevo";
+    int fd = ::open(temporal.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0){ cerr << "No se puede escribir " << temporal << "\n"; return 1; }
+    atomic<int> siguienteCubo{0};
+    atomic<bool> fallo{false};
+    vector<vector<TerminoIndice>> terminosCubo(CUBOS);     // se escriben al final, cuando se sabe dónde
+    vector<thread> ordenadores;
+    for (int h=0; h<hilos; ++h){
+        ordenadores.emplace_back([&](){
+            vector<Aparicion> a;
+            vector<uint32_t> lista;
+            for (int c; (c = siguienteCubo++) < CUBOS; ){
+                a.resize(aparicionesCubo[c]);
+                rewind(cubos[c]);
+                if (fread(a.data(), sizeof(Aparicion), a.size(), cubos[c]) != a.size()){ fallo = true; continue; }
+                fclose(cubos[c]);
+                cubos[c] = nullptr;
+                ::unlink(rutaCubo(rutaIndice, c).c_str());
+                sort(a.begin(), a.end());
+                lista.resize(a.size());
+                vector<TerminoIndice> &t = terminosCubo[c];
+                for (size_t i=0; i<a.size(); ++i){
+                    if (i == 0 || a[i].termino != a[i-1].termino) t.push_back({ a[i].termino, primeraCubo[c] + i });
+                    lista[i] = a[i].partida;
+                }
+                size_t bytes = lista.size() * 4;
+                off_t donde = (off_t)(inicioApariciones(partidas) + primeraCubo[c] * 4);
+                if (bytes && ::pwrite(fd, lista.data(), bytes, donde) != (ssize_t)bytes) fallo = true;
+            }
+        });
+    }
+    for (thread &t : ordenadores) t.join();
+    for (int c=0; c<CUBOS; ++c){
+        if (cubos[c]){ fclose(cubos[c]); ::unlink(rutaCubo(rutaIndice, c).c_str()); }
+    }
+
+    // 3) términos, directorio, desplazamientos y, lo último, la cabecera
+    uint64_t numTerminos = 0;
+    for (auto &t : terminosCubo) numTerminos += t.size();
+    vector<uint64_t> directorio(TAM_DIRECTORIO, numTerminos);
+    off_t donde = (off_t)inicioTerminos(partidas, apariciones);
+    uint64_t k = 0;
+    for (int c=0; c<CUBOS; ++c){
+        vector<TerminoIndice> &t = terminosCubo[c];
+        for (size_t i=t.size(); i-- > 0; ) directorio[t[i].clave >> (64 - BITS_DIRECTORIO)] = k + i;
+        size_t bytes = t.size() * sizeof(TerminoIndice);
+        if (bytes && ::pwrite(fd, t.data(), bytes, donde) != (ssize_t)bytes) fallo = true;
+        donde += (off_t)bytes;
+        k += t.size();
+        vector<TerminoIndice>().swap(t);
+    }
+    // el directorio queda con el primer término de cada trozo; los trozos vacíos toman el siguiente
+    for (size_t d = TAM_DIRECTORIO - 1; d-- > 0; ) directorio[d] = min(directorio[d], directorio[d + 1]);
+    TerminoIndice centinela = { ~0ULL, apariciones };
+    uint8_t cabecera[TAM_CABECERA_INDICE];
+    memcpy(cabecera, CABECERA_INDICE, 16);
+    uint64_t campos[4] = { partidas, numTerminos, apariciones, (uint64_t)st.st_size };
+    memcpy(cabecera + 16, campos, sizeof(campos));
+    if (::pwrite(fd, &centinela, sizeof(centinela), donde) != (ssize_t)sizeof(centinela)
+        || ::pwrite(fd, directorio.data(), directorio.size() * 8, (off_t)inicioDirectorio(partidas)) != (ssize_t)(directorio.size() * 8)
+        || ::pwrite(fd, desplazamientos.data(), desplazamientos.size() * 8, (off_t)TAM_CABECERA_INDICE) != (ssize_t)(desplazamientos.size() * 8)
+        || ::pwrite(fd, cabecera, TAM_CABECERA_INDICE, 0) != (ssize_t)TAM_CABECERA_INDICE)
+        fallo = true;
+    // el relleno de las apariciones impares: que el archivo llegue hasta el final
+    if (::ftruncate(fd, (off_t)tamIndice(partidas, numTerminos, apariciones)) != 0) fallo = true;
+    ::close(fd);
+    if (fallo || ::rename(temporal.c_str(), rutaIndice.c_str()) != 0){
+        ::unlink(temporal.c_str());
+        cerr << "No se pudo escribir el índice " << rutaIndice << "\n";
+        return 1;
+    }
+    double segundosOrden = chrono::duration<double>(Reloj::now() - t1).count();
+
+    cerr << total.partidas << " partidas (" << total.jugadas << " jugadas, " << total.ilegales << " con jugadas ilegales) en "
+         << segundosLectura << " s (" << total.partidas / segundosLectura << " partidas/s), " << hilos << " hilos\n"
+         << numTerminos << " términos, " << apariciones << " apariciones, ordenado y escrito en " << segundosOrden << " s, "
+         << tamIndice(partidas, numTerminos, apariciones) / (1024.0 * 1024.0) << " MB en " << rutaIndice << "\n";
+    return 0;
+}
+
+// ---------------------- buscar ----------------------
+int buscar(int argc, char** argv){
+    string rutaIndice = "partidas.indice", rutaPartidas;
+    size_t maximo = 20;
+    vector<pair<string, string>> criterios;      // (opción, valor), en el orden dado
+    for (int i=2; i<argc; ++i){
+        string arg = argv[i];
+        if (arg == "--indice" && i+1 < argc) rutaIndice = argv[++i];
+        else if (arg == "--partidas" && i+1 < argc) rutaPartidas = argv[++i];
+        else if (arg == "--max" && i+1 < argc) maximo = (size_t)atol(argv[++i]);
+        else if ((arg == "--fen" || arg == "--jugadas" || arg == "--material" || arg == "--suceso") && i+1 < argc) criterios.push_back({ arg, argv[++i] });
+        else { cerr << "Opción desconocida: " << arg << "\n"; return 1; }
+    }
+    auto listaSucesos = [](){
+        string l;
+        for (const string &s : nombresSucesos()) l += (l.empty() ? "" : ", ") + s;
+        return l;
+    };
+    if (criterios.empty()){
+        cerr << "Falta qué buscar: --fen, --jugadas, --material o --suceso (" << listaSucesos() << ")\n";
+        return 1;
+    }
+    for (auto &c : criterios){
+        if (c.first == "--suceso" && !esSucesoIndice(c.second)){
+            cerr << "Suceso desconocido: " << c.second << " (" << listaSucesos() << ")\n";
+            return 1;
+        }
+    }
+
+    Reloj::time_point t0 = Reloj::now();
+    IndicePartidas indice;
+    if (!indice.abrir(rutaIndice)){ cerr << "No se puede abrir el índice " << rutaIndice << "\n"; return 1; }
+    Reloj::time_point t1 = Reloj::now();
+
+    // las listas de material en cualquiera de los dos bandos se juntan aquí
+    deque<vector<uint32_t>> uniones;
+    vector<ListaPartidas> listas;
+    for (auto &c : criterios){
+        if (c.first == "--fen" || c.first == "--jugadas"){
+            EstadoPartida e;
+            string error;
+            if (c.first == "--fen"){
+                if (!textoAPosicion(c.second, e, error)){ cerr << "FEN no válido (" << error << "): " << c.second << "\n"; return 1; }
+            } else {
+                e.iniciar();
+                istringstream in(c.second);
+                string txt;
+                while (in >> txt){
+                    Jugada j;
+                    if (!textoAJugada(txt, j) || !e.jugar(j)){ cerr << "Jugada ilegal: " << txt << "\n"; return 1; }
+                }
+            }
+            listas.push_back(indice.partidasCon(terminoPosicion(e.piezas, e.tablero, e.turno)));
+        } else if (c.first == "--material"){
+            CuentaMaterial m;
+            if (!textoAMaterial(c.second, m)){ cerr << "Material no válido: " << c.second << " (p.ej. RD-RT)\n"; return 1; }
+            CuentaMaterial invertido;
+            for (int t=0; t<6; ++t){ invertido.n[0][t] = m.n[1][t]; invertido.n[1][t] = m.n[0][t]; }
+            ListaPartidas a = indice.partidasCon(terminoMaterial(m));
+            if (invertido == m){
+                listas.push_back(a);
+            } else {
+                ListaPartidas b = indice.partidasCon(terminoMaterial(invertido));
+                uniones.emplace_back(a.n + b.n);
+                vector<uint32_t> &u = uniones.back();
+                u.resize((size_t)(set_union(a.p, a.p + a.n, b.p, b.p + b.n, u.begin()) - u.begin()));
+                listas.push_back({ u.data(), u.size() });
+            }
+        } else {
+            listas.push_back(indice.partidasCon(terminoSuceso(c.second)));
+        }
+    }
+    vector<uint32_t> resultado;
+    interseccion(listas, resultado);
+    Reloj::time_point t2 = Reloj::now();
+
+    int fdPartidas = -1;
+    if (!rutaPartidas.empty()){
+        struct stat st;
+        fdPartidas = ::open(rutaPartidas.c_str(), O_RDONLY);
+        if (fdPartidas < 0) cerr << "No se puede abrir " << rutaPartidas << "\n";
+        else if (::fstat(fdPartidas, &st) == 0 && (uint64_t)st.st_size != indice.tamArchivoPartidas())
+            cerr << "Aviso: " << rutaPartidas << " no tiene el tamaño que tenía al indexarlo\n";
+    }
+    string linea;
+    for (size_t i=0; i<resultado.size() && (maximo == 0 || i < maximo); ++i){
+        uint32_t p = resultado[i];
+        cout << p + 1;
+        if (fdPartidas >= 0){
+            uint64_t a = indice.inicioPartida(p), b = indice.finPartida(p);
+            linea.resize((size_t)(b - a));
+            ssize_t n = ::pread(fdPartidas, &linea[0], linea.size(), (off_t)a);
+            linea.resize(n > 0 ? (size_t)n : 0);
+            while (!linea.empty() && (linea.back() == '\n' || linea.back() == '\r')) linea.pop_back();
+            cout << '\t' << linea;
+        }
+        cout << '\n';
+    }
+    if (fdPartidas >= 0) ::close(fdPartidas);
+
+    cerr << resultado.size() << " partidas de " << indice.numPartidas()
+         << " (abrir " << chrono::duration<double, milli>(t1 - t0).count() << " ms, buscar "
+         << chrono::duration<double, milli>(t2 - t1).count() << " ms)\n";
+    return 0;
+}
+
+// ---------------------- azar ----------------------
+// Partida al azar de hasta 'maxJugadas' medias jugadas: a veces con guardia y, al promocionar,
+// a cualquier pieza
+string partidaAlAzar(mt19937 &azar, int maxJugadas){
+    EstadoPartida e;
+    e.iniciar();
+    string s;
+    for (int n=0; n<maxJugadas; ++n){
+        MovimientosTurno mt;
+        e.movimientos(mt);
+        if (e.resultado(mt) != ResultadoPartida::EnJuego) break;
+        int k = (int)(azar() % (unsigned)mt.total);
+        Jugada j;
+        for (int o=0; o<FILAS*COLS && j.origen == SIN_CASILLA; ++o){
+            for (uint64_t m = mt.destinos[o]; m; m &= m - 1){
+                if (k-- == 0){
+                    j.origen = (uint8_t)o;
+                    j.destino = (uint8_t)__builtin_ctzll(m);
+                    break;
+                }
+            }
+        }
+        const ReglasFlags &propios = (e.turno == ColorPieza::White) ? e.flagsBlanco : e.flagsNegro;
+        if (!propios.guardiaUsado && azar() % 40 == 0) j.guardia = j.origen;
+        const Pieza &p = e.piezas[e.tablero[j.origen / COLS][j.origen % COLS]];
+        if (p.tipo == TipoPieza::Pawn && (j.destino / COLS == 0 || j.destino / COLS == FILAS-1))
+            j.promocion = (uint8_t)(1 + (int)TipoPieza::Rook + azar() % 4);
+        e.jugar(j);
+        if (!s.empty()) s += ' ';
+        s += jugadaATexto(j);
+    }
+    return s;
+}
+
+int azar(int argc, char** argv){
+    long cuantas = 0;
+    int maxJugadas = 160, hilos = (int)thread::hardware_concurrency();
+    unsigned semilla = 7;
+    string salida = "-";
+    for (int i=2; i<argc; ++i){
+        string arg = argv[i];
+        if (arg == "--salida" && i+1 < argc) salida = argv[++i];
+        else if (arg == "--max-jugadas" && i+1 < argc) maxJugadas = atoi(argv[++i]);
+        else if (arg == "--hilos" && i+1 < argc) hilos = atoi(argv[++i]);
+        else if (arg == "--semilla" && i+1 < argc) semilla = (unsigned)atoi(argv[++i]);
+        else cuantas = atol(arg.c_str());
+    }
+    if (hilos < 1) hilos = 1;
+    FILE *out = (salida == "-") ? stdout : fopen(salida.c_str(), "wb");
+    if (!out){ cerr << "No se puede escribir " << salida << "\n"; return 1; }
+
+    // por rondas: cada hilo juega un trozo de partidas seguidas y se escriben en orden; la
+    // partida i sale siempre igual (su semilla es semilla + i), con los hilos que sean
+    const long TROZO = 1024;
+    vector<string> textos(hilos);
+    for (long base = 0; base < cuantas; base += TROZO * hilos){
+        vector<thread> ts;
+        for (int h=0; h<hilos; ++h){
+            ts.emplace_back([&, h](){
+                textos[h].clear();
+                for (long i = base + h * TROZO; i < min(cuantas, base + (h + 1) * TROZO); ++i){
+                    mt19937 azar(semilla + (unsigned)i);
+                    textos[h] += partidaAlAzar(azar, maxJugadas);
+                    textos[h] += '\n';
+                }
+            });
+        }
+        for (thread &t : ts) t.join();
+        for (string &t : textos) fwrite(t.data(), 1, t.size(), out);
+    }
+    if (out != stdout) fclose(out);
+    return 0;
+}
+
+int main(int argc, char** argv){
+    string orden = (argc > 1) ? argv[1] : "";
+    if (orden == "indexar") return indexar(argc, argv);
+    if (orden == "buscar") return buscar(argc, argv);
+    if (orden == "azar") return azar(argc, argv);
+    cerr << "Uso: Partidas.exe indexar partidas.txt [--indice partidas.indice] [--hilos N]\n"
+         << "     Partidas.exe buscar [--indice partidas.indice] [--fen \"<FEN>\"] [--jugadas \"e2e4 e7e5\"] [--material RD-RT]\n"
+         << "                         [--suceso enroque3] [--partidas partidas.txt] [--max 20]\n"
+         << "     Partidas.exe azar 100000 [--salida partidas.txt] [--max-jugadas 160] [--hilos N] [--semilla 7]\n";
+    return 1;
+}
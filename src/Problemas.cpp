@@ -0,0 +1,204 @@
+// Problemas.cpp
+// Generador de problemas de mate: recorre partidas y, en sus últimas posiciones, busca mates
+// forzados de hasta N jugadas (Mate.hpp) en varios hilos. Se quedan los de solución única
+// (una sola jugada clave) y de al menos --min jugadas; cada partida da como mucho un problema
+// por secuencia de mate.
+// Las partidas se leen de un archivo, una por línea, con las jugadas en la notación del
+// protocolo separadas por espacios ("e2e4 e7e5 g1f3 ..."); con --azar se juegan al azar.
+// Uso: Problemas.exe [--partidas archivo | --azar 500] [--max 3] [--min 2] [--ultimas 16]
+//                    [--nodos 200000] [--hilos N] [--semilla 7] [--salida problemas.txt]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include "Protocolo.hpp"
+#include "Mate.hpp"
+using namespace std;
+
+typedef chrono::steady_clock Reloj;
+
+// ---------------------- Partidas ----------------------
+bool leerPartida(const string &linea, vector<Jugada> &jugadas){
+    jugadas.clear();
+    istringstream in(linea);
+    string txt;
+    while (in >> txt){
+        Jugada j;
+        if (!textoAJugada(txt, j)) return false;
+        jugadas.push_back(j);
+    }
+    return !jugadas.empty();
+}
+
+vector<vector<Jugada>> partidasAlAzar(int cuantas, unsigned semilla){
+    vector<vector<Jugada>> partidas(cuantas);
+    mt19937 azar(semilla);
+    for (vector<Jugada> &p : partidas){
+        EstadoPartida e;
+        e.iniciar();
+        for (;;){
+            MovimientosTurno mt;
+            e.movimientos(mt);
+            if (e.resultado(mt) != ResultadoPartida::EnJuego || e.jugadas >= 300) break;
+            int k = (int)(azar() % (unsigned)mt.total);
+            Jugada j;
+            for (int o=0; o<FILAS*COLS && j.origen == SIN_CASILLA; ++o){
+                for (uint64_t m = mt.destinos[o]; m; m &= m - 1){
+                    if (k-- == 0){
+                        j.origen = (uint8_t)o;
+                        j.destino = (uint8_t)__builtin_ctzll(m);
+                        break;
+                    }
+                }
+            }
+            e.jugar(j);
+            p.push_back(j);
+        }
+    }
+    return partidas;
+}
+
+// ---------------------- Búsqueda en paralelo ----------------------
+struct Estadisticas {
+    long posiciones = 0;           // posiciones resueltas
+    long conMate = 0;
+    long unicos = 0;               // problemas aceptados
+    long dobles = 0;               // mate con más de una jugada clave
+    long abortados = 0;            // sin decidir con los nodos dados
+    long conGuardia = 0;           // problemas cuya solución usa la guardia
+    long conEnroque3 = 0;          // ... o el enroque extendido
+    unsigned long long nodos = 0;
+
+    void sumar(const Estadisticas &o){
+        posiciones += o.posiciones; conMate += o.conMate; unicos += o.unicos; dobles += o.dobles;
+        abortados += o.abortados; conGuardia += o.conGuardia; conEnroque3 += o.conEnroque3; nodos += o.nodos;
+    }
+};
+
+struct Opciones {
+    int maxN = 3, minN = 2, ultimas = 16;
+    unsigned long long nodos = 200000;
+};
+
+// Problemas de una partida (en orden); actualiza las estadísticas del hilo
+void minarPartida(const vector<Jugada> &partida, const Opciones &op, BuscadorMate &buscador, Estadisticas &est, vector<string> &salida){
+    EstadoPartida e;
+    e.iniciar();
+    int desde = (op.ultimas > 0) ? (int)partida.size() - op.ultimas : 0;
+    string previas;
+    int saltar = 0;
+    for (size_t ply = 0; ply <= partida.size(); ++ply){
+        if ((int)ply >= desde && saltar == 0){
+            unsigned long long antes = buscador.nodos;
+            ProblemaMate r = buscador.resolver(e.piezas, e.tablero, e.flagsBlanco, e.flagsNegro, e.turno, op.maxN, op.nodos);
+            est.nodos += buscador.nodos - antes;
+            est.posiciones++;
+            if (r.abortado) est.abortados++;
+            else if (r.jugadas){
+                est.conMate++;
+                if (r.claves > 1) est.dobles++;
+                else if (r.jugadas >= op.minN){
+                    est.unicos++;
+                    bool guardia = false, enroque3 = false;
+                    for (size_t k = 0; k < r.linea.size(); k += 2){
+                        const Jugada &j = r.linea[k];
+                        if (j.guardia != SIN_CASILLA) guardia = true;
+                        int pieza = e.tablero[j.origen / COLS][j.origen % COLS];
+                        if (k == 0 && pieza != -1 && e.piezas[pieza].tipo == TipoPieza::King && abs(j.destino % COLS - j.origen % COLS) == 3) enroque3 = true;
+                    }
+                    est.conGuardia += guardia;
+                    est.conEnroque3 += enroque3;
+
+                    string linea = to_string(r.jugadas) + " " + jugadaATexto(r.clave) + " |";
+                    for (const Jugada &j : r.linea) linea += " " + jugadaATexto(j);
+                    linea += " |" + previas;
+                    salida.push_back(linea);
+                    saltar = 2 * r.jugadas;      // el resto de esta secuencia de mate
+                }
+            }
+        }
+        if (saltar > 0) saltar--;
+        if (ply == partida.size()) break;
+        Jugada j = partida[ply];
+        if (!e.jugar(j)) break;                  // partida mal grabada: se para aquí
+        previas += " " + jugadaATexto(j);
+    }
+}
+
+int main(int argc, char** argv){
+    Opciones op;
+    string archivo, archivoSalida = "problemas.txt";
+    int azar = 0, hilos = (int)thread::hardware_concurrency();
+    unsigned semilla = 7;
+    for (int i=1; i+1<argc; ++i){
+        string arg = argv[i];
+        if (arg == "--partidas") archivo = argv[++i];
+        else if (arg == "--azar") azar = atoi(argv[++i]);
+        else if (arg == "--max") op.maxN = atoi(argv[++i]);
+        else if (arg == "--min") op.minN = atoi(argv[++i]);
+        else if (arg == "--ultimas") op.ultimas = atoi(argv[++i]);
+        else if (arg == "--nodos") op.nodos = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--hilos") hilos = atoi(argv[++i]);
+        else if (arg == "--semilla") semilla = (unsigned)atoi(argv[++i]);
+        else if (arg == "--salida") archivoSalida = argv[++i];
+    }
+    if (hilos < 1) hilos = 1;
+    if (op.maxN < 1) op.maxN = 1;
+
+    vector<vector<Jugada>> partidas;
+    if (!archivo.empty()){
+        ifstream in(archivo);
+        if (!in){ cerr << "No se puede abrir " << archivo << "\n"; return 1; }
+        string linea;
+        long malas = 0;
+        vector<Jugada> p;
+        while (getline(in, linea)){
+            if (linea.empty() || linea[0] == '#') continue;
+            if (leerPartida(linea, p)) partidas.push_back(p);
+            else malas++;
+        }
+        if (malas) cerr << malas << " líneas no son partidas, se ignoran\n";
+    } else {
+        partidas = partidasAlAzar(azar > 0 ? azar : 500, semilla);
+    }
+
+    // cada hilo toma la siguiente partida libre; la salida se escribe después en el orden de entrada
+    vector<vector<string>> problemas(partidas.size());
+    vector<Estadisticas> porHilo(hilos);
+    atomic<size_t> siguiente(0);
+    Reloj::time_point t0 = Reloj::now();
+    vector<thread> trabajadores;
+    for (int h=0; h<hilos; ++h){
+        trabajadores.emplace_back([&, h](){
+            BuscadorMate buscador;
+            for (size_t i = siguiente++; i < partidas.size(); i = siguiente++)
+                minarPartida(partidas[i], op, buscador, porHilo[h], problemas[i]);
+        });
+    }
+    for (thread &t : trabajadores) t.join();
+    double segundos = chrono::duration<double>(Reloj::now() - t0).count();
+
+    Estadisticas total;
+    for (const Estadisticas &e : porHilo) total.sumar(e);
+
+    ofstream out(archivoSalida);
+    out << "# N clave | línea principal | jugadas desde la posición inicial\n";
+    for (const vector<string> &p : problemas)
+        for (const string &l : p) out << l << "\n";
+
+    cout << partidas.size() << " partidas, " << hilos << " hilos, mate en " << op.minN << ".." << op.maxN << "\n"
+         << "posiciones " << total.posiciones << " (" << total.posiciones / segundos << "/s) | nodos " << total.nodos
+         << " (" << total.nodos / segundos << "/s) | " << segundos << " s\n"
+         << "con mate " << total.conMate << " | problemas " << total.unicos << " (guardia " << total.conGuardia
+         << ", enroque extendido " << total.conEnroque3 << ") | varias claves " << total.dobles
+         << " | sin decidir " << total.abortados << "\n"
+         << "problemas escritos en " << archivoSalida << "\n";
+    return 0;
+}
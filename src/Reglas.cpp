@@ -0,0 +1,812 @@
+// Reglas.cpp
+// Reglas de Almate (libalmate): todo lo que antes vivía en Reglas.hpp con el tablero global.
+// Cada función recibe el tablero con el que trabaja, así que varias posiciones se pueden
+// evaluar a la vez en hilos distintos.
+
+#include "Reglas.hpp"
+
+// contadores de llamadas para el perfilador (uno por hilo)
+thread_local ContadoresPerfil perfContadores;
+
+// ---------------------- Movimiento / reglas ----------------------
+bool lineaLibre(const Tablero& tablero, int f1,int c1,int f2,int c2){
+    int dx = (c2>c1)?1: (c2<c1)? -1: 0;
+    int dy = (f2>f1)?1: (f2<f1)? -1: 0;
+    int x = c1 + dx;
+    int y = f1 + dy;
+    while(x != c2 || y != f2){
+        if (!dentroTablero(y,x)) return false;
+        if (tablero[y][x] != -1) return false;
+        x += dx; y += dy;
+    }
+    return true;
+}
+
+bool puedeAtacar(const vector<Pieza>& piezas, const Tablero& tablero, int attIdx, int f, int c){
+    if (attIdx < 0 || attIdx >= (int)piezas.size()) return false;
+    const Pieza &p = piezas[attIdx];
+    if (!p.alive) return false;
+    int sF = p.fila, sC = p.col;
+    if (!dentroTablero(sF,sC)) return false;
+    int dx = c - sC;
+    int dy = f - sF;
+    int adx = abs(dx), ady = abs(dy);
+
+    switch(p.tipo){
+        case TipoPieza::Pawn: {
+            int dir = (p.color == ColorPieza::White) ? -1 : 1;
+            if (ady==1 && adx==1 && dy==dir) return true;
+            return false;
+        }
+        case TipoPieza::Rook: {
+            if (dx!=0 && dy!=0) return false;
+            return lineaLibre(tablero, sF,sC,f,c);
+        }
+        case TipoPieza::Bishop: {
+            if (adx!=ady) return false;
+            return lineaLibre(tablero, sF,sC,f,c);
+        }
+        case TipoPieza::Queen: {
+            if (!((dx==0) || (dy==0) || (adx==ady))) return false;
+            return lineaLibre(tablero, sF,sC,f,c);
+        }
+        case TipoPieza::Knight: {
+            if ((adx==1 && ady==2) || (adx==2 && ady==1)) return true;
+            return false;
+        }
+        case TipoPieza::King: {
+            if (adx<=1 && ady<=1) return true;
+            return false;
+        }
+    }
+    return false;
+}
+
+// Rectas primero (0-3) y diagonales después (4-7); los saltos del caballo
+static const int DIRECCIONES[8][2] = { {-1,0}, {1,0}, {0,-1}, {0,1}, {-1,-1}, {-1,1}, {1,-1}, {1,1} };
+static const int SALTOS[8][2] = { {-2,-1}, {-2,1}, {-1,-2}, {-1,2}, {1,-2}, {1,2}, {2,-1}, {2,1} };
+
+// Se mira hacia fuera desde la casilla (saltos, peones, rey y la primera pieza de cada rayo), no
+// pieza por pieza: unas 40 lecturas del tablero como mucho.
+uint64_t atacantesCasilla(const vector<Pieza>& piezas, const Tablero& tablero, ColorPieza colorAtacante, int f, int c, int saltar){
+    uint64_t r = 0;
+    auto es = [&](int ff, int cc, TipoPieza tipo){
+        if (!dentroTablero(ff,cc)) return false;
+        int i = tablero[ff][cc];
+        return i != -1 && piezas[i].color == colorAtacante && piezas[i].tipo == tipo;
+    };
+    for (int k=0; k<8; ++k){
+        if (es(f + SALTOS[k][0], c + SALTOS[k][1], TipoPieza::Knight)) r |= bitCasilla(f + SALTOS[k][0], c + SALTOS[k][1]);
+        if (es(f + DIRECCIONES[k][0], c + DIRECCIONES[k][1], TipoPieza::King)) r |= bitCasilla(f + DIRECCIONES[k][0], c + DIRECCIONES[k][1]);
+    }
+    // los peones blancos atacan hacia arriba: el que ataca (f,c) está una fila por debajo
+    int filaPeon = f + ((colorAtacante == ColorPieza::White) ? 1 : -1);
+    for (int dc = -1; dc <= 1; dc += 2)
+        if (es(filaPeon, c + dc, TipoPieza::Pawn)) r |= bitCasilla(filaPeon, c + dc);
+
+    for (int d=0; d<8; ++d){
+        TipoPieza deslizante = (d < 4) ? TipoPieza::Rook : TipoPieza::Bishop;
+        int ff = f + DIRECCIONES[d][0], cc = c + DIRECCIONES[d][1];
+        for (; dentroTablero(ff,cc); ff += DIRECCIONES[d][0], cc += DIRECCIONES[d][1]){
+            int i = tablero[ff][cc];
+            if (i == -1 || indiceCasilla(ff,cc) == saltar) continue;
+            const Pieza &p = piezas[i];
+            if (p.color == colorAtacante && (p.tipo == deslizante || p.tipo == TipoPieza::Queen)) r |= bitCasilla(ff,cc);
+            break;
+        }
+    }
+    return r;
+}
+
+bool estaCasillaAtacada(const vector<Pieza>& piezas, const Tablero& tablero, ColorPieza colorAtacante, int f, int c){
+    return atacantesCasilla(piezas, tablero, colorAtacante, f, c) != 0;
+}
+
+// Al revés que atacantesCasilla: desde la pieza hacia fuera. Las deslizantes llegan hasta la
+// primera pieza que encuentran, sea del color que sea (la defienden).
+uint64_t casillasAtacadas(const vector<Pieza>& piezas, const Tablero& tablero, int idx){
+    const Pieza &p = piezas[idx];
+    if (!p.alive || !dentroTablero(p.fila,p.col)) return 0;
+    uint64_t r = 0;
+    auto pasos = [&](const int (*d)[2]){
+        for (int k=0; k<8; ++k)
+            if (dentroTablero(p.fila + d[k][0], p.col + d[k][1])) r |= bitCasilla(p.fila + d[k][0], p.col + d[k][1]);
+    };
+    switch (p.tipo){
+        case TipoPieza::Pawn: {
+            int f = p.fila + ((p.color == ColorPieza::White) ? -1 : 1);
+            for (int dc = -1; dc <= 1; dc += 2)
+                if (dentroTablero(f, p.col + dc)) r |= bitCasilla(f, p.col + dc);
+            break;
+        }
+        case TipoPieza::Knight: pasos(SALTOS); break;
+        case TipoPieza::King:   pasos(DIRECCIONES); break;
+        default: {
+            int d0 = (p.tipo == TipoPieza::Bishop) ? 4 : 0, d1 = (p.tipo == TipoPieza::Rook) ? 4 : 8;
+            for (int d=d0; d<d1; ++d){
+                int f = p.fila + DIRECCIONES[d][0], c = p.col + DIRECCIONES[d][1];
+                for (; dentroTablero(f,c); f += DIRECCIONES[d][0], c += DIRECCIONES[d][1]){
+                    r |= bitCasilla(f,c);
+                    if (tablero[f][c] != -1) break;
+                }
+            }
+        }
+    }
+    return r;
+}
+
+template <class Variante>
+bool movimientoLegal(const vector<Pieza>& piezas, const Tablero& tablero, int idx, int dstF, int dstC, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro){
+    perfContadores.movimientoLegal++;
+    if (!dentroTablero(dstF,dstC)) return false;
+    const Pieza &p = piezas[idx];
+    if (!p.alive) return false;
+    int sF = p.fila, sC = p.col;
+    if (sF==dstF && sC==dstC) return false;
+
+    // no capturar propia pieza
+    if (tablero[dstF][dstC] != -1){
+        int occ = tablero[dstF][dstC];
+        if (occ >= 0 && piezas[occ].color == p.color) return false;
+
+        // Regla 1: pieza protegida no puede ser capturada durante el turno de protección
+        if constexpr (Variante::guardia){
+            const ReglasFlags& flagsOponente = (p.color == ColorPieza::White) ? flagsNegro : flagsBlanco;
+            if (flagsOponente.proteccionActiva && flagsOponente.guardiaIdx == occ){
+                // La captura se ignora este turno: el movimiento a casilla ocupada por protegido no es legal
+                return false;
+            }
+        }
+    }
+
+    int dx = dstC - sC;
+    int dy = dstF - sF;
+    int adx = abs(dx), ady = abs(dy);
+
+    switch(p.tipo){
+        case TipoPieza::Pawn: {
+            int dir = (p.color == ColorPieza::White) ? -1 : 1; // white sube (fila decrece)
+            if (dx==0 && dy==dir && tablero[dstF][dstC]==-1) return true;
+            if (dx==0 && dy==2*dir){
+                bool inicio = (p.color==ColorPieza::White)? (sF==6) : (sF==1);
+                if (!inicio) return false;
+                int midF = sF + dir;
+                if (tablero[midF][sC]==-1 && tablero[dstF][dstC]==-1) return true;
+                return false;
+            }
+            if (abs(dx)==1 && dy==dir && tablero[dstF][dstC]!=-1){
+                int occ = tablero[dstF][dstC];
+                if (occ>=0 && piezas[occ].color != p.color){
+                    // también respeta protección del oponente (ya validado arriba)
+                    return true;
+                }
+            }
+            // al paso: la casilla que saltó el peón rival en su última jugada
+            if (abs(dx)==1 && dy==dir && tablero[dstF][dstC]==-1){
+                const ReglasFlags& flagsOponente = (p.color == ColorPieza::White) ? flagsNegro : flagsBlanco;
+                int victima = tablero[sF][dstC];
+                if (flagsOponente.alPaso == indiceCasilla(dstF,dstC) && victima != -1){
+                    if (Variante::guardia && flagsOponente.proteccionActiva && flagsOponente.guardiaIdx == victima) return false;
+                    return true;
+                }
+            }
+            return false;
+        }
+        case TipoPieza::Rook: {
+            if (dx!=0 && dy!=0) return false;
+            if (!lineaLibre(tablero, sF,sC,dstF,dstC)) return false;
+            return true;
+        }
+        case TipoPieza::Bishop: {
+            if (adx!=ady) return false;
+            if (!lineaLibre(tablero, sF,sC,dstF,dstC)) return false;
+            return true;
+        }
+        case TipoPieza::Queen: {
+            if (!((dx==0) || (dy==0) || (adx==ady))) return false;
+            if (!lineaLibre(tablero, sF,sC,dstF,dstC)) return false;
+            return true;
+        }
+        case TipoPieza::Knight: {
+            if ((adx==1 && ady==2) || (adx==2 && ady==1)) return true;
+            return false;
+        }
+        case TipoPieza::King: {
+            // movimiento normal de 1 casilla
+            if (adx<=1 && ady<=1) return true;
+
+            // --- enroque normal (2 casillas) ---
+            if (ady==0 && (adx==2)){
+                if (p.hasMoved) return false;
+                int dir = (dx>0)? 1 : -1;
+                int rookCol = (dir>0) ? 7 : 0;
+                if (!dentroTablero(sF, rookCol)) return false;
+                int rookIdx = tablero[sF][rookCol];
+                if (rookIdx == -1) return false;
+                const Pieza &r = piezas[rookIdx];
+                if (!r.alive || r.tipo != TipoPieza::Rook || r.color != p.color || r.hasMoved) return false;
+
+                // camino libre
+                for (int cc = (dir>0? sC+1 : rookCol+1); cc < (dir>0? rookCol : sC); ++cc){
+                    if (tablero[sF][cc] != -1) return false;
+                }
+
+                // casillas del rey no deben estar atacadas
+                ColorPieza enemigo = (p.color==ColorPieza::White)? ColorPieza::Black : ColorPieza::White;
+                if (estaCasillaAtacada(piezas, tablero, enemigo, sF, sC)) return false;
+                int passC = sC + dir;
+                int finalC = sC + 2*dir;
+                if (estaCasillaAtacada(piezas, tablero, enemigo, sF, passC)) return false;
+                if (estaCasillaAtacada(piezas, tablero, enemigo, sF, finalC)) return false;
+                return true;
+            }
+
+            // --- Regla 2: enroque extendido (3 casillas) una vez por jugador ---
+            if (Variante::enroqueExtendido && ady==0 && (adx==3)){
+                // Nota: validación de "una vez por partida" se hace antes de aplicar movimiento (no aquí),
+                // pero aquí comprobamos condiciones posicionales.
+                if (p.hasMoved) return false;
+                int dir = (dx>0)? 1 : -1;
+                // Se puede enrocar con CUALQUIER torre del lado escogido siempre que no se haya movido.
+                int rookCol = (dir>0) ? 7 : 0;
+                if (!dentroTablero(sF, rookCol)) return false;
+                int rookIdx = tablero[sF][rookCol];
+                if (rookIdx == -1) return false;
+                const Pieza &r = piezas[rookIdx];
+                if (!r.alive || r.tipo != TipoPieza::Rook || r.color != p.color || r.hasMoved) return false;
+
+                // camino libre completo entre rey y torre
+                for (int cc = (dir>0? sC+1 : rookCol+1); cc < (dir>0? rookCol : sC); ++cc){
+                    if (tablero[sF][cc] != -1) return false;
+                }
+
+                // casillas del rey no deben estar atacadas durante el paso
+                ColorPieza enemigo = (p.color==ColorPieza::White)? ColorPieza::Black : ColorPieza::White;
+                if (estaCasillaAtacada(piezas, tablero, enemigo, sF, sC)) return false;
+                int passC1 = sC + dir;
+                int passC2 = sC + 2*dir;
+                int finalC = sC + 3*dir;
+                if (estaCasillaAtacada(piezas, tablero, enemigo, sF, passC1)) return false;
+                if (estaCasillaAtacada(piezas, tablero, enemigo, sF, passC2)) return false;
+                if (estaCasillaAtacada(piezas, tablero, enemigo, sF, finalC)) return false;
+                return true;
+            }
+
+            return false;
+        }
+    }
+    return false;
+}
+
+int encontrarIndiceRey(const vector<Pieza>& piezas, ColorPieza color){
+    for(int i=0;i<(int)piezas.size();++i){
+        if (piezas[i].alive && piezas[i].tipo==TipoPieza::King && piezas[i].color==color)
+            return i;
+    }
+    return -1;
+}
+
+template <class Variante>
+bool estaEnJaque(const vector<Pieza>& piezas, const Tablero& tablero, ColorPieza color){
+    int reyIdx = encontrarIndiceRey(piezas, color);
+    if (reyIdx == -1) return false;
+    int reyF = piezas[reyIdx].fila, reyC = piezas[reyIdx].col;
+    if (!dentroTablero(reyF, reyC)) return false;
+    // la guardia no impide dar jaque: basta con los ataques
+    ColorPieza rival = (color == ColorPieza::White) ? ColorPieza::Black : ColorPieza::White;
+    return atacantesCasilla(piezas, tablero, rival, reyF, reyC) != 0;
+}
+
+template <class Variante>
+bool dejaReyEnJaqueSimulado(vector<Pieza>& piezas, const Tablero& tablero, int moverIdx, int dstF, int dstC, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro){
+    perfContadores.dejaReyEnJaque++;
+
+    // manejar captura si existe (bloqueada si protegido)
+    int victIdx = -1;
+    if (dentroTablero(dstF,dstC)) {
+        victIdx = tablero[dstF][dstC];
+        if (Variante::guardia && victIdx != -1) {
+            const ReglasFlags& flagsOponente = (piezas[moverIdx].color == ColorPieza::White) ? flagsNegro : flagsBlanco;
+            if (flagsOponente.proteccionActiva && flagsOponente.guardiaIdx == victIdx) {
+                // captura bloqueada -> el movimiento a esa casilla no es válido realmente
+                return true; // fuerza "en jaque" como consecuencia de movimiento inválido
+            }
+        }
+    }
+
+    // la simulación trabaja sobre una copia del tablero; de las piezas se guardan solo las que
+    // se tocan (la que mueve, la capturada y la torre del enroque) y se restauran al final
+    Tablero sim = tablero;
+    int tocadas[3] = { moverIdx, -1, -1 };
+    Pieza copias[3];
+    copias[0] = piezas[moverIdx];
+
+    int srcF = piezas[moverIdx].fila;
+    int srcC = piezas[moverIdx].col;
+
+    if (dentroTablero(srcF,srcC)) sim[srcF][srcC] = -1;
+
+    // al paso: la víctima no está en el destino sino al lado del origen
+    if (victIdx == -1 && piezas[moverIdx].tipo == TipoPieza::Pawn && dstC != srcC){
+        victIdx = tablero[srcF][dstC];
+        if (victIdx != -1) sim[srcF][dstC] = -1;
+    }
+
+    if (victIdx != -1){
+        tocadas[1] = victIdx;
+        copias[1] = piezas[victIdx];
+        piezas[victIdx].alive = false;
+        piezas[victIdx].fila = piezas[victIdx].col = -1;
+    }
+    piezas[moverIdx].fila = dstF;
+    piezas[moverIdx].col = dstC;
+    sim[dstF][dstC] = moverIdx;
+
+    // enroque normal y extendido en simulación
+    if (copias[0].tipo == TipoPieza::King && abs(dstC - srcC) >= 2){
+        int dir = (dstC - srcC) > 0 ? 1 : -1;
+        int rookCol = (dir>0)? 7 : 0;
+        int rookIdx = tablero[srcF][rookCol];
+        if (rookIdx != -1){
+            int newRookCol = (abs(dstC - srcC) == 2) ? (srcC + dir) : (srcC + 2*dir); // extendido: torre cruza 2 casillas
+            if (dentroTablero(srcF, rookCol)) sim[srcF][rookCol] = -1;
+            sim[srcF][newRookCol] = rookIdx;
+            tocadas[2] = rookIdx;
+            copias[2] = piezas[rookIdx];
+            piezas[rookIdx].fila = srcF;
+            piezas[rookIdx].col = newRookCol;
+        }
+    }
+
+    ColorPieza colorMover = piezas[moverIdx].color;
+    bool enJaque = estaEnJaque<Variante>(piezas, sim, colorMover);
+
+    for (int k=2; k>=0; --k)
+        if (tocadas[k] != -1) piezas[tocadas[k]] = copias[k];
+    return enJaque;
+}
+
+// ---------------------- Generación legal ----------------------
+// Los jaques y las clavadas se calculan una vez por posición; con ellos cada pieza genera solo
+// sus destinos legales, sin mover nada ni volver a buscar jaques por cada candidato.
+struct InfoRey {
+    int casilla = -1;                // rey del bando que mueve (-1 si no tiene)
+    uint64_t jaques = 0;             // casillas de las piezas que le dan jaque
+    uint64_t evasion = ~0ULL;        // con un solo jaque: capturar al que lo da o interponerse
+    int numClavadas = 0;
+    uint8_t clavada[8];              // piezas propias clavadas contra el rey (como mucho una por rayo)
+    uint64_t rayo[8];                // por dónde pueden moverse sin destapar al rey
+    uint64_t bloqueadas = 0;         // piezas propias y, con la guardia, la protegida del rival
+    int protegida = -1;              // índice de esa pieza protegida
+};
+
+// Casillas estrictamente entre 'a' y 'b' si están en la misma fila, columna o diagonal
+static uint64_t entreCasillas(int a, int b){
+    int df = b / COLS - a / COLS, dc = b % COLS - a % COLS;
+    if (df != 0 && dc != 0 && abs(df) != abs(dc)) return 0;
+    int pf = (df > 0) - (df < 0), pc = (dc > 0) - (dc < 0);
+    uint64_t r = 0;
+    for (int f = a / COLS + pf, c = a % COLS + pc; indiceCasilla(f,c) != b; f += pf, c += pc) r |= bitCasilla(f,c);
+    return r;
+}
+
+template <class Variante>
+static void analizarRey(const vector<Pieza>& piezas, const Tablero& tablero, ColorPieza color, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro,
+                        InfoRey& info){
+    for (int f=0; f<FILAS; ++f)
+        for (int c=0; c<COLS; ++c){
+            int i = tablero[f][c];
+            if (i != -1 && piezas[i].color == color) info.bloqueadas |= bitCasilla(f,c);
+        }
+    const ReglasFlags& rivales = (color == ColorPieza::White) ? flagsNegro : flagsBlanco;
+    if (Variante::guardia && rivales.proteccionActiva && rivales.guardiaIdx >= 0 && piezas[rivales.guardiaIdx].alive){
+        info.protegida = rivales.guardiaIdx;
+        info.bloqueadas |= bitCasilla(piezas[info.protegida].fila, piezas[info.protegida].col);
+    }
+
+    int reyIdx = encontrarIndiceRey(piezas, color);
+    if (reyIdx == -1 || !dentroTablero(piezas[reyIdx].fila, piezas[reyIdx].col)) return;
+    int reyF = piezas[reyIdx].fila, reyC = piezas[reyIdx].col;
+    info.casilla = indiceCasilla(reyF, reyC);
+
+    ColorPieza rival = (color == ColorPieza::White) ? ColorPieza::Black : ColorPieza::White;
+    info.jaques = atacantesCasilla(piezas, tablero, rival, reyF, reyC);
+    if (info.jaques && !(info.jaques & (info.jaques - 1))){
+        int atacante = __builtin_ctzll(info.jaques);
+        info.evasion = info.jaques | entreCasillas(info.casilla, atacante);
+    }
+
+    // clavadas: una pieza propia y detrás, en el mismo rayo, una pieza rival que se mueve por él
+    for (int d=0; d<8; ++d){
+        TipoPieza deslizante = (d < 4) ? TipoPieza::Rook : TipoPieza::Bishop;
+        int propia = -1;
+        uint64_t rayo = 0;
+        int f = reyF + DIRECCIONES[d][0], c = reyC + DIRECCIONES[d][1];
+        for (; dentroTablero(f,c); f += DIRECCIONES[d][0], c += DIRECCIONES[d][1]){
+            rayo |= bitCasilla(f,c);
+            int i = tablero[f][c];
+            if (i == -1) continue;
+            const Pieza &p = piezas[i];
+            if (p.color == color){
+                if (propia != -1) break;
+                propia = indiceCasilla(f,c);
+                continue;
+            }
+            if (propia != -1 && (p.tipo == deslizante || p.tipo == TipoPieza::Queen)){
+                info.clavada[info.numClavadas] = (uint8_t)propia;
+                info.rayo[info.numClavadas] = rayo;
+                info.numClavadas++;
+            }
+            break;
+        }
+    }
+}
+
+// Enroque normal (2 casillas) y, en Almate, extendido (3): rey y torre sin mover, camino libre
+// y ninguna casilla del rey atacada (la de salida, las de paso y la de llegada)
+template <class Variante>
+static uint64_t destinosEnroque(const vector<Pieza>& piezas, const Tablero& tablero, const Pieza& rey, const ReglasFlags& propios){
+    uint64_t r = 0;
+    if (rey.hasMoved) return 0;
+    int sF = rey.fila, sC = rey.col;
+    ColorPieza enemigo = (rey.color == ColorPieza::White) ? ColorPieza::Black : ColorPieza::White;
+    for (int dir = -1; dir <= 1; dir += 2){
+        int rookCol = (dir > 0) ? 7 : 0;
+        int rookIdx = tablero[sF][rookCol];
+        if (rookIdx == -1) continue;
+        const Pieza &t = piezas[rookIdx];
+        if (t.tipo != TipoPieza::Rook || t.color != rey.color || t.hasMoved) continue;
+        bool libre = true;
+        for (int cc = (dir > 0 ? sC+1 : rookCol+1); cc < (dir > 0 ? rookCol : sC) && libre; ++cc) libre = tablero[sF][cc] == -1;
+        if (!libre) continue;
+
+        // Regla 2: el extendido una vez por partida
+        int maxPasos = (Variante::enroqueExtendido && !propios.enroque3Usado) ? 3 : 2;
+        for (int pasos = 0; pasos <= maxPasos; ++pasos){
+            int cc = sC + pasos*dir;
+            if (!dentroTablero(sF, cc)) break;
+            if (pasos >= 2){
+                int occ = tablero[sF][cc];
+                if (occ != -1 && piezas[occ].color == rey.color) break;
+            }
+            if (atacantesCasilla(piezas, tablero, enemigo, sF, cc) != 0) break;
+            if (pasos >= 2) r |= bitCasilla(sF, cc);
+        }
+    }
+    return r;
+}
+
+template <class Variante>
+static uint64_t destinosPieza(const vector<Pieza>& piezas, const Tablero& tablero, int idx, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro,
+                              const InfoRey& info){
+    const Pieza &p = piezas[idx];
+    int sF = p.fila, sC = p.col;
+    const ReglasFlags& propios = (p.color == ColorPieza::White) ? flagsBlanco : flagsNegro;
+    const ReglasFlags& rivales = (p.color == ColorPieza::White) ? flagsNegro : flagsBlanco;
+    ColorPieza enemigo = (p.color == ColorPieza::White) ? ColorPieza::Black : ColorPieza::White;
+
+    uint64_t r = 0;
+    if (p.tipo == TipoPieza::King){
+        for (int k=0; k<8; ++k){
+            int f = sF + DIRECCIONES[k][0], c = sC + DIRECCIONES[k][1];
+            if (!dentroTablero(f,c) || (info.bloqueadas & bitCasilla(f,c))) continue;
+            // el rey no tapa los rayos que lo atacan: se salta su casilla
+            if (atacantesCasilla(piezas, tablero, enemigo, f, c, info.casilla) == 0) r |= bitCasilla(f,c);
+        }
+        return r | destinosEnroque<Variante>(piezas, tablero, p, propios);
+    }
+    // jaque doble: solo puede mover el rey
+    if (info.jaques & (info.jaques - 1)) return 0;
+
+    uint64_t alPaso = 0;
+    switch (p.tipo){
+        case TipoPieza::Pawn: {
+            int dir = (p.color == ColorPieza::White) ? -1 : 1;
+            int f = sF + dir;
+            if (!dentroTablero(f, sC)) break;
+            if (tablero[f][sC] == -1){
+                r |= bitCasilla(f, sC);
+                bool inicio = (p.color == ColorPieza::White) ? (sF == 6) : (sF == 1);
+                if (inicio && tablero[f + dir][sC] == -1) r |= bitCasilla(f + dir, sC);
+            }
+            for (int dc = -1; dc <= 1; dc += 2){
+                int c = sC + dc;
+                if (!dentroTablero(f, c)) continue;
+                if (tablero[f][c] != -1){
+                    r |= bitCasilla(f, c);
+                } else if (rivales.alPaso == indiceCasilla(f, c) && tablero[sF][c] != -1 && tablero[sF][c] != info.protegida){
+                    alPaso = bitCasilla(f, c);
+                }
+            }
+            break;
+        }
+        case TipoPieza::Knight:
+            for (int k=0; k<8; ++k){
+                int f = sF + SALTOS[k][0], c = sC + SALTOS[k][1];
+                if (dentroTablero(f,c)) r |= bitCasilla(f,c);
+            }
+            break;
+        default: {
+            int d0 = (p.tipo == TipoPieza::Bishop) ? 4 : 0;
+            int d1 = (p.tipo == TipoPieza::Rook) ? 4 : 8;
+            for (int d = d0; d < d1; ++d){
+                int f = sF + DIRECCIONES[d][0], c = sC + DIRECCIONES[d][1];
+                for (; dentroTablero(f,c); f += DIRECCIONES[d][0], c += DIRECCIONES[d][1]){
+                    r |= bitCasilla(f,c);
+                    if (tablero[f][c] != -1) break;
+                }
+            }
+            break;
+        }
+    }
+    r &= ~info.bloqueadas & info.evasion;
+    for (int k=0; k<info.numClavadas; ++k)
+        if (info.clavada[k] == indiceCasilla(sF, sC)) r &= info.rayo[k];
+
+    // al paso: se van dos piezas de la fila del rey a la vez, así que se comprueba sobre una copia
+    if (alPaso && info.casilla != -1){
+        int d = __builtin_ctzll(alPaso);
+        Tablero sim = tablero;
+        sim[sF][sC] = -1;
+        sim[sF][d % COLS] = -1;
+        sim[d / COLS][d % COLS] = idx;
+        if (atacantesCasilla(piezas, sim, enemigo, info.casilla / COLS, info.casilla % COLS) == 0) r |= alPaso;
+    } else {
+        r |= alPaso;
+    }
+    return r;
+}
+
+template <class Variante>
+bool esJaqueMate(const vector<Pieza>& piezas, const Tablero& tablero, ColorPieza color, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro){
+    InfoRey info;
+    analizarRey<Variante>(piezas, tablero, color, flagsBlanco, flagsNegro, info);
+    if (!info.jaques) return false;
+    for (int i=0; i<(int)piezas.size(); ++i){
+        const Pieza &p = piezas[i];
+        if (!p.alive || p.color != color || !dentroTablero(p.fila, p.col)) continue;
+        if (destinosPieza<Variante>(piezas, tablero, i, flagsBlanco, flagsNegro, info)) return false;
+    }
+    return true;
+}
+
+// ---------------------- Movimientos legales del turno ----------------------
+template <class Variante>
+bool destinoLegal(const vector<Pieza>& piezas, const Tablero& tablero, int idx, int dstF, int dstC, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro){
+    const Pieza &p = piezas[idx];
+    if (!p.alive || !dentroTablero(p.fila, p.col) || !dentroTablero(dstF, dstC)) return false;
+    InfoRey info;
+    analizarRey<Variante>(piezas, tablero, p.color, flagsBlanco, flagsNegro, info);
+    return (destinosPieza<Variante>(piezas, tablero, idx, flagsBlanco, flagsNegro, info) & bitCasilla(dstF, dstC)) != 0;
+}
+
+template <class Variante>
+void calcularMovimientosTurno(MovimientosTurno &mt, const vector<Pieza>& piezas, const Tablero& tablero, ColorPieza turno, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro){
+    mt = MovimientosTurno();
+    InfoRey info;
+    analizarRey<Variante>(piezas, tablero, turno, flagsBlanco, flagsNegro, info);
+
+    for(int i=0;i<(int)piezas.size();++i){
+        const Pieza &p = piezas[i];
+        if (!p.alive || p.color != turno) continue;
+        if (!dentroTablero(p.fila, p.col)) continue;
+        uint64_t m = destinosPieza<Variante>(piezas, tablero, i, flagsBlanco, flagsNegro, info);
+        mt.destinos[indiceCasilla(p.fila, p.col)] = m;
+        mt.total += __builtin_popcountll(m);
+    }
+
+    bool enJaque = info.jaques != 0;
+    ColorPieza rival = (turno==ColorPieza::White)? ColorPieza::Black : ColorPieza::White;
+    bool rivalEnJaque = estaEnJaque<Variante>(piezas, tablero, rival);
+    mt.blancoEnJaque = (turno==ColorPieza::White)? enJaque : rivalEnJaque;
+    mt.negroEnJaque  = (turno==ColorPieza::White)? rivalEnJaque : enJaque;
+    mt.jaqueMate = enJaque && mt.total == 0;
+}
+
+// ---------------------- Jugadas ----------------------
+template <class Variante>
+EfectoJugada aplicarJugada(vector<Pieza>& piezas, Tablero& tablero, const Jugada& j, ReglasFlags& flagsBlanco, ReglasFlags& flagsNegro, ColorPieza& turno,
+                           RegistroDeshacer* deshacer){
+    EfectoJugada ef;
+    int origenF = j.origen / COLS, origenC = j.origen % COLS;
+    int dstF = j.destino / COLS, dstC = j.destino % COLS;
+    ReglasFlags &propios = (turno==ColorPieza::White)? flagsBlanco : flagsNegro;
+    ReglasFlags &rivales = (turno==ColorPieza::White)? flagsNegro : flagsBlanco;
+
+    RegistroDeshacer reg;
+    reg.flagsBlanco = flagsBlanco;
+    reg.flagsNegro = flagsNegro;
+    reg.turno = turno;
+
+    // Regla 1: guardia activada durante el turno (aplicarla otra vez no cambia nada)
+    if (Variante::guardia && j.guardia != SIN_CASILLA){
+        int g = tablero[j.guardia / COLS][j.guardia % COLS];
+        if (g != -1){
+            propios.guardiaUsado = true;
+            propios.guardiaIdx = g;
+            piezas[g].protegido = true;
+            propios.proteccionActiva = true;
+            propios.proteccionTurnoDe = turno;
+        }
+    }
+
+    int idx = tablero[origenF][origenC];
+    ef.mover = idx;
+    reg.mover = (int8_t)idx;
+    reg.moverHasMoved = piezas[idx].hasMoved;
+    reg.moverTipo = piezas[idx].tipo;
+
+    // captura: la víctima sale del juego ya; su sprite se anima aparte
+    int victim = tablero[dstF][dstC];
+    if (victim == -1 && piezas[idx].tipo == TipoPieza::Pawn && dstC != origenC){
+        // al paso: el peón capturado está al lado del origen
+        victim = tablero[origenF][dstC];
+        if (victim != -1){
+            tablero[origenF][dstC] = -1;
+            reg.alPaso = true;
+        }
+    }
+    if (victim != -1 && victim != idx && piezas[victim].color != piezas[idx].color){
+        piezas[victim].alive = false;
+        piezas[victim].fila = piezas[victim].col = -1;
+        ef.victima = victim;
+        reg.victima = (int8_t)victim;
+    }
+
+    int moveCols = abs(dstC - origenC);
+    if (piezas[idx].tipo == TipoPieza::King && (moveCols == 2 || (Variante::enroqueExtendido && moveCols == 3))){
+        int dir = (dstC - origenC) > 0 ? 1 : -1;
+        int rookCol = (dir>0)? 7 : 0;
+        int rookIdx = tablero[origenF][rookCol];
+        if (rookIdx != -1){
+            reg.torre = (int8_t)rookIdx;
+            reg.torreCol = (int8_t)rookCol;
+            reg.torreHasMoved = piezas[rookIdx].hasMoved;
+
+            // mover torre
+            int newRookCol = (moveCols==2) ? (origenC + dir) : (origenC + 2*dir);
+            tablero[origenF][rookCol] = -1;
+            piezas[rookIdx].fila = origenF;
+            piezas[rookIdx].col = newRookCol;
+            tablero[origenF][newRookCol] = rookIdx;
+            piezas[rookIdx].hasMoved = true;
+            ef.torre = rookIdx;
+
+            // Regla 2: registrar uso de enroque extendido
+            if (moveCols == 3) propios.enroque3Usado = true;
+        }
+    }
+
+    tablero[origenF][origenC] = -1;
+    piezas[idx].fila = dstF; piezas[idx].col = dstC;
+    tablero[dstF][dstC] = idx;
+    piezas[idx].hasMoved = true;
+
+    // al paso: el derecho del rival caduca con esta jugada; un avance doble abre el propio
+    rivales.alPaso = -1;
+    propios.alPaso = -1;
+    if (piezas[idx].tipo == TipoPieza::Pawn && abs(dstF - origenF) == 2)
+        propios.alPaso = indiceCasilla((origenF + dstF) / 2, origenC);
+
+    // Regla 3: promoción al llegar a última fila
+    if (piezas[idx].tipo == TipoPieza::Pawn){
+        bool llegoUltima = (piezas[idx].color==ColorPieza::White)? (dstF==0) : (dstF==7);
+        if (llegoUltima){
+            if (j.promocion != 0) piezas[idx].tipo = (TipoPieza)(j.promocion - 1);
+            else ef.promocionPendiente = true;
+        }
+    }
+
+    // Cambiar turno
+    turno = (turno == ColorPieza::White) ? ColorPieza::Black : ColorPieza::White;
+
+    // Regla 1: finalizar protección al cerrar el turno del protegido
+    // La protección dura "un turno completo" del rival. Al cambiar el turno, si la protección
+    // pertenece al jugador que ahora empieza, se desactiva (ha pasado el turno del rival).
+    if constexpr (Variante::guardia){
+        ReglasFlags* todos[2] = { &flagsBlanco, &flagsNegro };
+        for (ReglasFlags* f : todos){
+            if (f->proteccionActiva && f->proteccionTurnoDe == turno){
+                if (f->guardiaIdx >=0 && f->guardiaIdx < (int)piezas.size()) piezas[f->guardiaIdx].protegido = false;
+                f->proteccionActiva = false;
+            }
+        }
+    }
+
+    if (deshacer) *deshacer = reg;
+    return ef;
+}
+
+EfectoJugada deshacerJugada(vector<Pieza>& piezas, Tablero& tablero, const Jugada& j, const RegistroDeshacer& reg,
+                            ReglasFlags& flagsBlanco, ReglasFlags& flagsNegro, ColorPieza& turno){
+    EfectoJugada ef;
+    int origenF = j.origen / COLS, origenC = j.origen % COLS;
+    int dstF = j.destino / COLS, dstC = j.destino % COLS;
+
+    // la marca "protegido" se recalcula a partir de los flags restaurados
+    if (flagsBlanco.guardiaIdx >= 0) piezas[flagsBlanco.guardiaIdx].protegido = false;
+    if (flagsNegro.guardiaIdx >= 0)  piezas[flagsNegro.guardiaIdx].protegido = false;
+
+    int idx = reg.mover;
+    ef.mover = idx;
+    tablero[dstF][dstC] = -1;
+    piezas[idx].fila = origenF; piezas[idx].col = origenC;
+    piezas[idx].tipo = reg.moverTipo;
+    piezas[idx].hasMoved = reg.moverHasMoved;
+    tablero[origenF][origenC] = idx;
+
+    if (reg.torre != -1){
+        Pieza &t = piezas[reg.torre];
+        tablero[t.fila][t.col] = -1;
+        t.col = reg.torreCol;
+        t.hasMoved = reg.torreHasMoved;
+        tablero[t.fila][t.col] = reg.torre;
+        ef.torre = reg.torre;
+    }
+
+    if (reg.victima != -1){
+        Pieza &v = piezas[reg.victima];
+        v.alive = true;
+        v.fila = reg.alPaso ? origenF : dstF;
+        v.col = dstC;
+        tablero[v.fila][v.col] = reg.victima;
+        ef.victima = reg.victima;
+    }
+
+    flagsBlanco = reg.flagsBlanco;
+    flagsNegro = reg.flagsNegro;
+    turno = reg.turno;
+    if (flagsBlanco.guardiaIdx >= 0) piezas[flagsBlanco.guardiaIdx].protegido = flagsBlanco.proteccionActiva;
+    if (flagsNegro.guardiaIdx >= 0)  piezas[flagsNegro.guardiaIdx].protegido = flagsNegro.proteccionActiva;
+    return ef;
+}
+
+// ---------------------- Posición inicial ----------------------
+string nombrePieza(TipoPieza tipo, ColorPieza color){
+    bool b = (color == ColorPieza::White);
+    switch(tipo){
+        case TipoPieza::Pawn:   return b ? "PeonB" : "PeonR";
+        case TipoPieza::Rook:   return b ? "TorreB" : "TorreR";
+        case TipoPieza::Knight: return b ? "CaballoB" : "CaballoR";
+        case TipoPieza::Bishop: return b ? "AlfilB" : "AlfilR";
+        case TipoPieza::Queen:  return b ? "DamaB" : "DamaR";
+        case TipoPieza::King:   return b ? "ReyB" : "ReyR";
+    }
+    return "";
+}
+
+void colocarPosicionInicial(vector<Pieza>& piezas, Tablero& tablero){
+    piezas.clear();
+    tablero.vaciar();
+
+    auto addPieza = [&](TipoPieza tipo, ColorPieza color, int fila, int col){
+        Pieza p;
+        p.tipo = tipo;
+        p.color = color;
+        p.fila = (int8_t)fila;
+        p.col = (int8_t)col;
+        tablero[fila][col] = (int)piezas.size();
+        piezas.push_back(p);
+    };
+
+    const TipoPieza fondo[COLS] = { TipoPieza::Rook, TipoPieza::Knight, TipoPieza::Bishop, TipoPieza::Queen,
+                                    TipoPieza::King, TipoPieza::Bishop, TipoPieza::Knight, TipoPieza::Rook };
+    for(int c=0;c<8;c++) addPieza(TipoPieza::Pawn, ColorPieza::White, 6, c);
+    for(int c=0;c<8;c++) addPieza(fondo[c], ColorPieza::White, 7, c);
+    for(int c=0;c<8;c++) addPieza(TipoPieza::Pawn, ColorPieza::Black, 1, c);
+    for(int c=0;c<8;c++) addPieza(fondo[c], ColorPieza::Black, 0, c);
+}
+
+// ---------------------- Variantes compiladas ----------------------
+// Una instancia de cada función por variante; añadir una variante es añadir su línea aquí.
+#define ALMATE_INSTANCIAR_VARIANTE(V) \
+    template bool movimientoLegal<V>(const vector<Pieza>&, const Tablero&, int, int, int, const ReglasFlags&, const ReglasFlags&); \
+    template bool estaEnJaque<V>(const vector<Pieza>&, const Tablero&, ColorPieza); \
+    template bool dejaReyEnJaqueSimulado<V>(vector<Pieza>&, const Tablero&, int, int, int, const ReglasFlags&, const ReglasFlags&); \
+    template bool esJaqueMate<V>(const vector<Pieza>&, const Tablero&, ColorPieza, const ReglasFlags&, const ReglasFlags&); \
+    template bool destinoLegal<V>(const vector<Pieza>&, const Tablero&, int, int, int, const ReglasFlags&, const ReglasFlags&); \
+    template void calcularMovimientosTurno<V>(MovimientosTurno&, const vector<Pieza>&, const Tablero&, ColorPieza, const ReglasFlags&, const ReglasFlags&); \
+    template EfectoJugada aplicarJugada<V>(vector<Pieza>&, Tablero&, const Jugada&, ReglasFlags&, ReglasFlags&, ColorPieza&, RegistroDeshacer*);
+
+ALMATE_INSTANCIAR_VARIANTE(ReglasEstandar)
+ALMATE_INSTANCIAR_VARIANTE(ReglasAlmate)
@@ -0,0 +1,583 @@
+// Servidor.cpp
+// Servidor sin ventana para partidas Almate por TCP: miles de partidas independientes en un
+// solo proceso. Un hilo acepta conexiones y las empareja de dos en dos; cada partida se asigna
+// a un hilo trabajador con su propio bucle epoll, así que una partida solo la toca un hilo.
+// Las jugadas se validan con las mismas reglas que el juego (Reglas.hpp).
+// Espectadores: en el puerto siguiente se envía "VER <id>\n" y se recibe la partida en binario
+// (foto y deltas, ver Difusion.hpp). La petición la lee un trabajador en su bucle, como todo lo
+// demás, y pasa la conexión al dueño de la partida. Se cierra cuando los dos jugadores se han ido.
+// Requisitos: Linux (epoll). Uso: Servidor.exe [--puerto 5555] [--puerto-espectadores 5556] [--hilos N]
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "Reglas.hpp"
+#include "Protocolo.hpp"
+#include "Difusion.hpp"
+using namespace std;
+
+const int MAX_EVENTOS = 256;
+const int BUFFER_ESPECTADOR = 8 * 1024;      // poco buffer en el núcleo: el retraso se ve pronto y se coalesce
+const int ESPERA_PETICION_MS = 2000;         // lo que tiene un espectador para enviar "VER <id>"
+
+typedef chrono::steady_clock Reloj;
+
+// ---------------------- Partidas ----------------------
+struct Partida;
+
+struct Conexion {
+    int fd = -1;
+    int lado = 0;                 // 0 = blancas, 1 = negras, -1 = espectador, -2 = espectador sin petición
+    Partida* partida = nullptr;
+    string entrada;               // línea a medias
+    string salida;                // pendiente de enviar (el socket no admitía más)
+    Reloj::time_point limite;     // sin petición: se cierra si no ha llegado para entonces
+};
+
+struct Partida {
+    int id = 0;
+    Conexion jugadores[2];
+    EstadoPartida estado;
+    bool terminada = false;
+    unique_ptr<Difusor> difusor;                  // con el primer espectador
+    vector<unique_ptr<Conexion>> espectadores;
+};
+
+struct EspectadorNuevo {
+    int fd;
+    int partida;
+};
+
+// ---------------------- Sockets ----------------------
+bool ponerNoBloqueante(int fd){
+    int f = fcntl(fd, F_GETFL, 0);
+    return f != -1 && fcntl(fd, F_SETFL, f | O_NONBLOCK) != -1;
+}
+
+int escuchar(int puerto){
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int si = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &si, sizeof(si));
+    sockaddr_in dir{};
+    dir.sin_family = AF_INET;
+    dir.sin_addr.s_addr = htonl(INADDR_ANY);
+    dir.sin_port = htons((uint16_t)puerto);
+    if (bind(fd, (sockaddr*)&dir, sizeof(dir)) != 0 || listen(fd, 4096) != 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Id de la partida de "VER <id>"; -1 si la línea no es eso
+int leerPeticionVer(const string &linea){
+    if (linea.compare(0, 4, "VER ") != 0) return -1;
+    int id = atoi(linea.c_str() + 4);
+    return id > 0 ? id : -1;
+}
+
+// Sube el límite de descriptores al máximo permitido (dos por partida)
+void subirLimiteDescriptores(){
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max){
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0)
+        cout << "Descriptores: " << lim.rlim_cur << " (hasta ~" << lim.rlim_cur / 2 << " partidas)\n";
+}
+
+// ---------------------- Trabajador ----------------------
+// Dueño de sus partidas: las recibe del aceptador por una cola con eventfd y atiende sus
+// sockets con epoll. Nada de lo que hay aquí se comparte con otros hilos salvo la cola y los contadores.
+// También lee las peticiones de los espectadores que le reparte el aceptador (sin bloquear: un
+// espectador lento o callado no retrasa a nadie) y pasa cada uno al dueño de su partida.
+struct Trabajador {
+    int ep = -1;
+    int aviso = -1;                               // eventfd: hay partidas nuevas en 'nuevas'
+    mutex mtxNuevas;
+    vector<unique_ptr<Partida>> nuevas;
+    vector<EspectadorNuevo> espectadoresNuevos;
+    vector<int> peticionesNuevas;                 // espectadores recién aceptados, sin leer
+    const vector<unique_ptr<Trabajador>> *todos = nullptr;
+    vector<unique_ptr<Conexion>> peticiones;      // esperando "VER <id>"
+    vector<unique_ptr<Partida>> partidas;
+    unordered_map<int, Partida*> porId;
+    vector<Partida*> porLiberar;                  // se borran al acabar el lote de eventos
+    vector<unique_ptr<Conexion>> porCerrar;       // espectadores que se fueron en este lote
+
+    atomic<long> jugadas{0};
+    atomic<long> ilegales{0};
+    atomic<int> activas{0};
+    atomic<int> espectadores{0};
+
+    bool iniciar(){
+        ep = epoll_create1(0);
+        aviso = eventfd(0, EFD_NONBLOCK);
+        if (ep == -1 || aviso == -1) return false;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;                    // nullptr = el eventfd
+        return epoll_ctl(ep, EPOLL_CTL_ADD, aviso, &ev) == 0;
+    }
+
+    void entregar(unique_ptr<Partida> p){
+        {
+            lock_guard<mutex> lk(mtxNuevas);
+            nuevas.push_back(move(p));
+        }
+        uint64_t uno = 1;
+        if (write(aviso, &uno, sizeof(uno)) < 0) {}
+    }
+
+    void entregarEspectador(int fd, int partida){
+        {
+            lock_guard<mutex> lk(mtxNuevas);
+            espectadoresNuevos.push_back({fd, partida});
+        }
+        uint64_t uno = 1;
+        if (write(aviso, &uno, sizeof(uno)) < 0) {}
+    }
+
+    void entregarPeticion(int fd){
+        {
+            lock_guard<mutex> lk(mtxNuevas);
+            peticionesNuevas.push_back(fd);
+        }
+        uint64_t uno = 1;
+        if (write(aviso, &uno, sizeof(uno)) < 0) {}
+    }
+
+    void enviar(Conexion &c, const string &linea){
+        if (c.fd == -1) return;
+        if (c.salida.empty()){
+            ssize_t n = send(c.fd, linea.data(), linea.size(), MSG_NOSIGNAL);
+            if (n == (ssize_t)linea.size()) return;
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return;   // se verá como cierre al leer
+            c.salida.assign(linea, n < 0 ? 0 : (size_t)n, string::npos);
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLOUT;
+            ev.data.ptr = &c;
+            epoll_ctl(ep, EPOLL_CTL_MOD, c.fd, &ev);
+        } else {
+            c.salida += linea;
+        }
+    }
+
+    void vaciar(Conexion &c){
+        while (!c.salida.empty()){
+            ssize_t n = send(c.fd, c.salida.data(), c.salida.size(), MSG_NOSIGNAL);
+            if (n <= 0) return;
+            c.salida.erase(0, (size_t)n);
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = &c;
+        epoll_ctl(ep, EPOLL_CTL_MOD, c.fd, &ev);
+    }
+
+    void cerrar(Conexion &c){
+        if (c.fd == -1) return;
+        epoll_ctl(ep, EPOLL_CTL_DEL, c.fd, nullptr);
+        close(c.fd);
+        c.fd = -1;
+    }
+
+    void arrancar(unique_ptr<Partida> p){
+        Partida *pp = p.get();
+        for (int l=0; l<2; ++l){
+            Conexion &c = pp->jugadores[l];
+            c.lado = l;
+            c.partida = pp;
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.ptr = &c;
+            epoll_ctl(ep, EPOLL_CTL_ADD, c.fd, &ev);
+        }
+        pp->estado.iniciar();
+        porId[pp->id] = pp;
+        partidas.push_back(move(p));
+        activas++;
+        enviar(pp->jugadores[0], "PARTIDA " + to_string(pp->id) + " BLANCAS\n");
+        enviar(pp->jugadores[1], "PARTIDA " + to_string(pp->id) + " NEGRAS\n");
+    }
+
+    // La partida ya no existe (o aún no ha empezado): se cierra sin más
+    void anadirEspectador(const EspectadorNuevo &e){
+        auto it = porId.find(e.partida);
+        if (it == porId.end()){
+            close(e.fd);
+            return;
+        }
+        Partida &p = *it->second;
+        if (!p.difusor) p.difusor.reset(new Difusor(p.estado));
+        p.espectadores.emplace_back(new Conexion());
+        Conexion &c = *p.espectadores.back();
+        c.fd = e.fd;
+        c.lado = -1;
+        c.partida = &p;
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        ev.data.ptr = &c;
+        epoll_ctl(ep, EPOLL_CTL_ADD, c.fd, &ev);
+        p.difusor->suscribir(c.fd);
+        espectadores++;
+    }
+
+    void anadirPeticion(int fd){
+        peticiones.emplace_back(new Conexion());
+        Conexion &c = *peticiones.back();
+        c.fd = fd;
+        c.lado = -2;
+        c.limite = Reloj::now() + chrono::milliseconds(ESPERA_PETICION_MS);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = &c;
+        epoll_ctl(ep, EPOLL_CTL_ADD, c.fd, &ev);
+    }
+
+    // Sale de 'peticiones' (se borra al acabar el lote); con 'cerrarla', también el socket
+    void soltarPeticion(Conexion &c, bool cerrarla){
+        if (cerrarla) cerrar(c);
+        else {
+            epoll_ctl(ep, EPOLL_CTL_DEL, c.fd, nullptr);
+            c.fd = -1;
+        }
+        for (size_t i=0; i<peticiones.size(); ++i){
+            if (peticiones[i].get() == &c){
+                porCerrar.push_back(move(peticiones[i]));
+                peticiones[i] = move(peticiones.back());
+                peticiones.pop_back();
+                break;
+            }
+        }
+    }
+
+    void leerPeticion(Conexion &c){
+        char buf[256];
+        for (;;){
+            ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            for (ssize_t i=0; i<n; ++i){
+                if (buf[i] != '\n'){
+                    if (c.entrada.size() >= MAX_LINEA) break;
+                    c.entrada += buf[i];
+                    continue;
+                }
+                if (!c.entrada.empty() && c.entrada.back() == '\r') c.entrada.pop_back();
+                int id = leerPeticionVer(c.entrada);
+                if (id == -1){ soltarPeticion(c, true); return; }      // no esperar al plazo
+                int fd = c.fd;
+                soltarPeticion(c, false);
+                Trabajador &dueno = *(*todos)[id % todos->size()];
+                if (&dueno == this) anadirEspectador({fd, id});
+                else dueno.entregarEspectador(fd, id);
+                return;
+            }
+            if (c.entrada.size() >= MAX_LINEA) break;
+        }
+        soltarPeticion(c, true);      // cerró, petición no válida o línea absurda
+    }
+
+    // Cierra las peticiones que no han llegado a tiempo; devuelve cuánto esperar a la siguiente
+    int caducarPeticiones(){
+        if (peticiones.empty()) return -1;
+        Reloj::time_point ahora = Reloj::now(), proxima = Reloj::time_point::max();
+        for (size_t i=0; i<peticiones.size(); ){
+            Conexion &c = *peticiones[i];
+            if (c.limite <= ahora){
+                soltarPeticion(c, true);      // pone la última en su sitio
+                continue;
+            }
+            proxima = min(proxima, c.limite);
+            i++;
+        }
+        if (peticiones.empty()) return -1;
+        return (int)chrono::duration_cast<chrono::milliseconds>(proxima - ahora).count() + 1;
+    }
+
+    void quitarEspectador(Conexion &c){
+        Partida &p = *c.partida;
+        p.difusor->desuscribir(c.fd);
+        cerrar(c);
+        espectadores--;
+        for (size_t i=0; i<p.espectadores.size(); ++i){
+            if (p.espectadores[i].get() == &c){
+                // no se borra todavía: puede quedar algún evento suyo en este lote
+                porCerrar.push_back(move(p.espectadores[i]));
+                p.espectadores[i] = move(p.espectadores.back());
+                p.espectadores.pop_back();
+                break;
+            }
+        }
+    }
+
+    // Los espectadores solo escriben para pedir la partida: lo demás se descarta
+    void atenderEspectador(Conexion &c, uint32_t eventos){
+        if (eventos & EPOLLOUT) c.partida->difusor->sePuedeEscribir(c.fd);
+        if (!(eventos & (EPOLLIN | EPOLLHUP | EPOLLERR))) return;
+        char buf[256];
+        for (;;){
+            ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+            if (n > 0) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            if (n < 0 && errno == EINTR) continue;
+            quitarEspectador(c);
+            return;
+        }
+    }
+
+    void terminar(Partida &p, const string &motivo){
+        if (p.terminada) return;
+        p.terminada = true;
+        activas--;
+        for (Conexion &c : p.jugadores) enviar(c, "FIN " + motivo + "\n");
+    }
+
+    // Una partida se libera cuando los dos jugadores han cerrado (al final del lote: puede
+    // quedar algún evento suyo pendiente en el mismo epoll_wait)
+    void quizaLiberar(Partida *p){
+        if (p->jugadores[0].fd != -1 || p->jugadores[1].fd != -1) return;
+        porLiberar.push_back(p);
+    }
+
+    void liberarPendientes(){
+        for (Partida *p : porLiberar){
+            for (auto &e : p->espectadores){
+                cerrar(*e);
+                espectadores--;
+            }
+            porId.erase(p->id);
+            for (size_t i=0; i<partidas.size(); ++i){
+                if (partidas[i].get() == p){
+                    partidas[i] = move(partidas.back());
+                    partidas.pop_back();
+                    break;
+                }
+            }
+        }
+        porLiberar.clear();
+        porCerrar.clear();
+    }
+
+    void procesarLinea(Conexion &c, const string &linea){
+        Partida &p = *c.partida;
+        if (linea.compare(0, 7, "JUGADA ") != 0) return;     // órdenes desconocidas se ignoran
+        string txt = linea.substr(7);
+        Jugada j;
+        bool turnoPropio = !p.terminada && (int)p.estado.turno == c.lado;
+        bool valida = turnoPropio && textoAJugada(txt, j);
+        DeltaJugada d;
+        if (valida && p.difusor) d = crearDelta(p.estado, j);    // antes de aplicarla
+        if (!valida || !p.estado.jugar(j)){
+            ilegales++;
+            enviar(c, "ILEGAL " + txt + "\n");
+            return;
+        }
+        jugadas++;
+        if (p.difusor) p.difusor->publicar(d, p.estado);
+        enviar(c, "OK\n");
+        enviar(p.jugadores[1 - c.lado], "JUGADA " + jugadaATexto(j) + "\n");
+
+        // ¿se acabó? (mate, ahogado o tablas)
+        MovimientosTurno mt;
+        p.estado.movimientos(mt);
+        ResultadoPartida r = p.estado.resultado(mt);
+        if (r != ResultadoPartida::EnJuego) terminar(p, motivoResultado(r));
+    }
+
+    void leer(Conexion &c){
+        char buf[4096];
+        bool cortar = false;
+        while (!cortar){
+            ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            for (ssize_t i=0; i<n && !cortar; ++i){
+                if (buf[i] == '\n'){
+                    if (!c.entrada.empty() && c.entrada.back() == '\r') c.entrada.pop_back();
+                    procesarLinea(c, c.entrada);
+                    c.entrada.clear();
+                } else if (c.entrada.size() < MAX_LINEA){
+                    c.entrada += buf[i];
+                } else {
+                    cortar = true;      // línea absurda: se trata como desconexión
+                }
+            }
+        }
+
+        // desconexión: si la partida seguía, el rival gana por abandono
+        Partida *p = c.partida;
+        cerrar(c);
+        terminar(*p, "ABANDONO");
+        Conexion &rival = p->jugadores[1 - c.lado];
+        if (rival.salida.empty()) cerrar(rival);
+        quizaLiberar(p);
+    }
+
+    void bucle(){
+        epoll_event eventos[MAX_EVENTOS];
+        int espera = -1;
+        for (;;){
+            int n = epoll_wait(ep, eventos, MAX_EVENTOS, espera);
+            if (n < 0){
+                if (errno == EINTR) continue;
+                perror("epoll_wait");
+                return;
+            }
+            for (int i=0; i<n; ++i){
+                if (eventos[i].data.ptr == nullptr){
+                    uint64_t v;
+                    if (read(aviso, &v, sizeof(v)) < 0) {}
+                    vector<unique_ptr<Partida>> lote;
+                    vector<EspectadorNuevo> loteEspectadores;
+                    vector<int> lotePeticiones;
+                    {
+                        lock_guard<mutex> lk(mtxNuevas);
+                        lote.swap(nuevas);
+                        loteEspectadores.swap(espectadoresNuevos);
+                        lotePeticiones.swap(peticionesNuevas);
+                    }
+                    for (auto &p : lote) arrancar(move(p));
+                    for (auto &e : loteEspectadores) anadirEspectador(e);
+                    for (int fd : lotePeticiones) anadirPeticion(fd);
+                    continue;
+                }
+                Conexion &c = *(Conexion*)eventos[i].data.ptr;
+                if (c.fd == -1) continue;                 // cerrada en este mismo lote
+                if (c.lado == -1){
+                    atenderEspectador(c, eventos[i].events);
+                    continue;
+                }
+                if (c.lado == -2){
+                    leerPeticion(c);
+                    continue;
+                }
+                if (eventos[i].events & EPOLLOUT) vaciar(c);
+                if (eventos[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) leer(c);
+            }
+            espera = caducarPeticiones();
+            liberarPendientes();
+        }
+    }
+};
+
+// ---------------------- MAIN ----------------------
+int main(int argc, char** argv){
+    int puerto = PUERTO_POR_DEFECTO;
+    int puertoEspectadores = -1;
+    int hilos = (int)thread::hardware_concurrency();
+    for (int i=1; i<argc; ++i){
+        string arg = argv[i];
+        if (arg == "--puerto" && i+1 < argc) puerto = atoi(argv[++i]);
+        else if (arg == "--hilos" && i+1 < argc) hilos = atoi(argv[++i]);
+        else if (arg == "--puerto-espectadores" && i+1 < argc) puertoEspectadores = atoi(argv[++i]);
+    }
+    if (puertoEspectadores < 0) puertoEspectadores = puerto + 1;
+    if (hilos < 1) hilos = 1;
+
+    signal(SIGPIPE, SIG_IGN);
+    subirLimiteDescriptores();
+
+    int si = 1;
+    int escucha = escuchar(puerto);
+    int escuchaEspectadores = escuchar(puertoEspectadores);
+    if (escucha < 0 || escuchaEspectadores < 0){
+        perror("No se pudo escuchar");
+        return 1;
+    }
+
+    vector<unique_ptr<Trabajador>> trabajadores;
+    vector<thread> hilosTrabajo;
+    for (int i=0; i<hilos; ++i){
+        trabajadores.emplace_back(new Trabajador());
+        if (!trabajadores.back()->iniciar()){
+            perror("epoll");
+            return 1;
+        }
+    }
+    for (auto &t : trabajadores) t->todos = &trabajadores;
+    for (auto &t : trabajadores) hilosTrabajo.emplace_back([&t]{ t->bucle(); });
+    cout << "Servidor en el puerto " << puerto << " (espectadores " << puertoEspectadores << ") con " << hilos << " hilos\n";
+
+    // estadísticas cada 5 s
+    thread informe([&]{
+        long anteriores = 0;
+        for (;;){
+            this_thread::sleep_for(chrono::seconds(5));
+            long jug = 0, ileg = 0;
+            int act = 0, esp = 0;
+            for (auto &t : trabajadores){ jug += t->jugadas; ileg += t->ilegales; act += t->activas; esp += t->espectadores; }
+            cout << "partidas activas " << act << " | jugadas/s " << (jug - anteriores) / 5
+                 << " | total " << jug << " | ilegales " << ileg << " | espectadores " << esp << endl;
+            anteriores = jug;
+        }
+    });
+    informe.detach();
+
+    // espectadores: se reparten por turnos entre los trabajadores, que leen la petición
+    // (con tiempo límite) y los pasan al dueño de la partida; aquí no se espera a ninguno
+    thread aceptaEspectadores([&]{
+        int siguiente = 0;
+        for (;;){
+            int fd = accept(escuchaEspectadores, nullptr, nullptr);
+            if (fd < 0){
+                if (errno == EMFILE || errno == ENFILE) this_thread::sleep_for(chrono::milliseconds(100));
+                continue;
+            }
+            int buffer = BUFFER_ESPECTADOR;
+            setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &si, sizeof(si));
+            ponerNoBloqueante(fd);
+            trabajadores[siguiente]->entregarPeticion(fd);
+            siguiente = (siguiente + 1) % hilos;
+        }
+    });
+    aceptaEspectadores.detach();
+
+    // aceptar y emparejar: dos conexiones seguidas forman una partida
+    int esperando = -1;
+    int siguienteId = 1;
+    for (;;){
+        int fd = accept(escucha, nullptr, nullptr);
+        if (fd < 0){
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("accept");
+            if (errno == EMFILE || errno == ENFILE) this_thread::sleep_for(chrono::milliseconds(100));
+            continue;
+        }
+        ponerNoBloqueante(fd);
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &si, sizeof(si));
+        if (esperando == -1){
+            esperando = fd;
+            continue;
+        }
+        unique_ptr<Partida> p(new Partida());
+        p->id = siguienteId++;
+        p->jugadores[0].fd = esperando;
+        p->jugadores[1].fd = fd;
+        esperando = -1;
+        trabajadores[p->id % hilos]->entregar(move(p));
+    }
+}
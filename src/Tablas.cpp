@@ -0,0 +1,221 @@
+// Tablas.cpp
+// Detección de fin de partida (libalmate): hash Zobrist incremental, regla de las 50 jugadas,
+// triple repetición y material insuficiente. Ver Tablas.hpp.
+
+#include "Tablas.hpp"
+
+// ---------------------- Claves Zobrist ----------------------
+// Fijas (se generan al compilar): el mismo hash en el juego, el servidor y las herramientas
+struct ClavesZobrist {
+    uint64_t pieza[2][6][FILAS*COLS] = {};
+    uint64_t turnoNegras = 0;
+
+    static constexpr uint64_t siguiente(uint64_t &estado){
+        uint64_t z = (estado += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    constexpr ClavesZobrist(){
+        uint64_t estado = 0xA1A3A7E5ULL;
+        for (int c=0; c<2; ++c)
+            for (int t=0; t<6; ++t)
+                for (int s=0; s<FILAS*COLS; ++s)
+                    pieza[c][t][s] = siguiente(estado);
+        turnoNegras = siguiente(estado);
+    }
+};
+
+static constexpr ClavesZobrist ZOBRIST{};
+
+static inline uint64_t clavePieza(ColorPieza color, TipoPieza tipo, int casilla){
+    return ZOBRIST.pieza[(int)color][(int)tipo][casilla];
+}
+
+// los derechos se empaquetan en 64 bits y se mezclan en una sola clave
+static inline uint64_t claveDerechos(uint64_t d){
+    uint64_t e = d;
+    return d ? ClavesZobrist::siguiente(e) : 0;
+}
+
+// ---------------------- Derechos ----------------------
+// Solo lo que cambia qué jugadas hay: enroques posibles (rey y torre sin mover en su casilla),
+// guardia y enroque extendido gastados, pieza protegida, y la casilla al paso si el bando al
+// que le toca tiene un peón que pueda capturar.
+static uint64_t derechos(const vector<Pieza>& piezas, const Tablero& tablero, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro, ColorPieza turno){
+    uint64_t d = 0;
+    const ReglasFlags* flags[2] = { &flagsBlanco, &flagsNegro };
+    for (int lado=0; lado<2; ++lado){
+        ColorPieza color = (ColorPieza)lado;
+        int fila = (color == ColorPieza::White) ? FILAS-1 : 0;
+        auto sinMover = [&](int col, TipoPieza tipo){
+            int i = tablero[fila][col];
+            return i != -1 && piezas[i].tipo == tipo && piezas[i].color == color && !piezas[i].hasMoved;
+        };
+        if (sinMover(4, TipoPieza::King)){
+            if (sinMover(7, TipoPieza::Rook)) d |= 1ULL << (lado*2);
+            if (sinMover(0, TipoPieza::Rook)) d |= 1ULL << (lado*2 + 1);
+        }
+        const ReglasFlags &f = *flags[lado];
+        if (f.guardiaUsado)  d |= 1ULL << (4 + lado);
+        if (f.enroque3Usado) d |= 1ULL << (6 + lado);
+        if (f.proteccionActiva && f.guardiaIdx >= 0 && piezas[f.guardiaIdx].alive){
+            const Pieza &g = piezas[f.guardiaIdx];
+            d |= (uint64_t)(64 | indiceCasilla(g.fila, g.col)) << (8 + lado*7);
+        }
+    }
+
+    // al paso: lo abrió el bando que acaba de mover
+    const ReglasFlags &rival = (turno == ColorPieza::White) ? flagsNegro : flagsBlanco;
+    if (rival.alPaso >= 0){
+        int f = rival.alPaso / COLS, c = rival.alPaso % COLS;
+        int filaCaptor = f + ((turno == ColorPieza::White) ? 1 : -1);
+        for (int dc = -1; dc <= 1; dc += 2){
+            if (!dentroTablero(filaCaptor, c + dc)) continue;
+            int i = tablero[filaCaptor][c + dc];
+            if (i != -1 && piezas[i].tipo == TipoPieza::Pawn && piezas[i].color == turno){
+                d |= (uint64_t)(64 | rival.alPaso) << 22;
+                break;
+            }
+        }
+    }
+    return d;
+}
+
+// ---------------------- Material ----------------------
+void FirmaMaterial::anadir(ColorPieza color, TipoPieza tipo, int casilla, int signo){
+    piezas[(int)color][(int)tipo] += signo;
+    if (tipo == TipoPieza::Bishop){
+        int oscura = ((casilla / COLS) + (casilla % COLS)) & 1;
+        alfiles[(int)color][oscura] += signo;
+    }
+}
+
+// Sin peones, torres ni damas: rey solo, un caballo o un alfil contra rey, o solo alfiles y
+// todos en casillas del mismo color
+bool materialInsuficiente(const FirmaMaterial &m){
+    int caballos = 0, alfilesClaros = 0, alfilesOscuros = 0;
+    for (int lado=0; lado<2; ++lado){
+        if (m.piezas[lado][(int)TipoPieza::Pawn] || m.piezas[lado][(int)TipoPieza::Rook] || m.piezas[lado][(int)TipoPieza::Queen])
+            return false;
+        caballos += m.piezas[lado][(int)TipoPieza::Knight];
+        alfilesClaros += m.alfiles[lado][0];
+        alfilesOscuros += m.alfiles[lado][1];
+    }
+    int menores = caballos + alfilesClaros + alfilesOscuros;
+    if (menores <= 1) return true;
+    return caballos == 0 && (alfilesClaros == 0 || alfilesOscuros == 0);
+}
+
+// ---------------------- Hash completo ----------------------
+uint64_t hashPosicion(const vector<Pieza>& piezas, const Tablero& tablero, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro, ColorPieza turno){
+    uint64_t h = 0;
+    for (const Pieza &p : piezas)
+        if (p.alive) h ^= clavePieza(p.color, p.tipo, indiceCasilla(p.fila, p.col));
+    if (turno == ColorPieza::Black) h ^= ZOBRIST.turnoNegras;
+    return h ^ claveDerechos(derechos(piezas, tablero, flagsBlanco, flagsNegro, turno));
+}
+
+// ---------------------- Seguimiento ----------------------
+void SeguimientoTablas::iniciar(const vector<Pieza>& piezas, const Tablero& tablero, const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro, ColorPieza turno,
+                                int reloj50){
+    pila.assign(1, Entrada());
+    Entrada &e = pila.back();
+    e.reloj50 = (uint16_t)reloj50;
+    e.derechos = derechos(piezas, tablero, flagsBlanco, flagsNegro, turno);
+    e.hash = hashPosicion(piezas, tablero, flagsBlanco, flagsNegro, turno);
+    for (const Pieza &p : piezas)
+        if (p.alive) e.material.anadir(p.color, p.tipo, indiceCasilla(p.fila, p.col), 1);
+}
+
+void SeguimientoTablas::registrar(const vector<Pieza>& piezas, const Tablero& tablero, const Jugada& j, const RegistroDeshacer& reg,
+                                  const ReglasFlags& flagsBlanco, const ReglasFlags& flagsNegro, ColorPieza turno){
+    Entrada e = pila.back();
+    const Pieza &m = piezas[reg.mover];
+
+    // la pieza que mueve (con su tipo nuevo si promocionó)
+    e.hash ^= clavePieza(m.color, reg.moverTipo, j.origen) ^ clavePieza(m.color, m.tipo, j.destino);
+    if (m.tipo != reg.moverTipo){
+        e.material.anadir(m.color, reg.moverTipo, j.origen, -1);
+        e.material.anadir(m.color, m.tipo, j.destino, 1);
+    }
+
+    if (reg.victima != -1){
+        const Pieza &v = piezas[reg.victima];
+        int casilla = reg.alPaso ? indiceCasilla(j.origen / COLS, j.destino % COLS) : j.destino;
+        e.hash ^= clavePieza(v.color, v.tipo, casilla);
+        e.material.anadir(v.color, v.tipo, casilla, -1);
+    }
+
+    if (reg.torre != -1){
+        const Pieza &t = piezas[reg.torre];
+        e.hash ^= clavePieza(t.color, t.tipo, indiceCasilla(t.fila, reg.torreCol)) ^ clavePieza(t.color, t.tipo, indiceCasilla(t.fila, t.col));
+    }
+
+    e.hash ^= ZOBRIST.turnoNegras;
+    uint64_t d = derechos(piezas, tablero, flagsBlanco, flagsNegro, turno);
+    e.hash ^= claveDerechos(e.derechos) ^ claveDerechos(d);
+    e.derechos = d;
+
+    bool irreversible = reg.moverTipo == TipoPieza::Pawn || reg.victima != -1;
+    e.reloj50 = irreversible ? 0 : (uint16_t)(e.reloj50 + 1);
+    pila.push_back(e);
+}
+
+void SeguimientoTablas::promocionar(int casilla, ColorPieza color, TipoPieza nuevoTipo){
+    Entrada &e = pila.back();
+    e.hash ^= clavePieza(color, TipoPieza::Pawn, casilla) ^ clavePieza(color, nuevoTipo, casilla);
+    e.material.anadir(color, TipoPieza::Pawn, casilla, -1);
+    e.material.anadir(color, nuevoTipo, casilla, 1);
+}
+
+// Solo puede repetirse una posición posterior a la última jugada irreversible, y con el mismo
+// bando moviendo: como mucho reloj50/2 comparaciones
+int SeguimientoTablas::vecesRepetida() const {
+    const Entrada &e = pila.back();
+    int veces = 1;
+    int ultima = (int)pila.size() - 1;
+    for (int i = ultima - 2; i >= 0 && i >= ultima - (int)e.reloj50; i -= 2)
+        if (pila[i].hash == e.hash) veces++;
+    return veces;
+}
+
+ResultadoPartida SeguimientoTablas::resultado(const MovimientosTurno& mt, ColorPieza turno) const {
+    if (mt.total == 0){
+        bool enJaque = (turno == ColorPieza::White) ? mt.blancoEnJaque : mt.negroEnJaque;
+        if (!enJaque) return ResultadoPartida::Ahogado;
+        return (turno == ColorPieza::White) ? ResultadoPartida::MateNegras : ResultadoPartida::MateBlancas;
+    }
+    if (materialInsuficiente(pila.back().material)) return ResultadoPartida::MaterialInsuficiente;
+    if (pila.back().reloj50 >= 100) return ResultadoPartida::Regla50;
+    if (vecesRepetida() >= 3) return ResultadoPartida::Repeticion;
+    return ResultadoPartida::EnJuego;
+}
+
+// ---------------------- Textos ----------------------
+const char* motivoResultado(ResultadoPartida r){
+    switch (r){
+        case ResultadoPartida::MateBlancas:          return "MATE_BLANCAS";
+        case ResultadoPartida::MateNegras:           return "MATE_NEGRAS";
+        case ResultadoPartida::Ahogado:              return "AHOGADO";
+        case ResultadoPartida::Repeticion:           return "TABLAS_REPETICION";
+        case ResultadoPartida::Regla50:              return "TABLAS_50";
+        case ResultadoPartida::MaterialInsuficiente: return "TABLAS_MATERIAL";
+        case ResultadoPartida::EnJuego:              break;
+    }
+    return "";
+}
+
+const char* descripcionResultado(ResultadoPartida r){
+    switch (r){
+        case ResultadoPartida::MateBlancas:          return "jaque mate, ganan las blancas";
+        case ResultadoPartida::MateNegras:           return "jaque mate, ganan las negras";
+        case ResultadoPartida::Ahogado:              return "tablas por ahogado";
+        case ResultadoPartida::Repeticion:           return "tablas por triple repetición";
+        case ResultadoPartida::Regla50:              return "tablas por la regla de las 50 jugadas";
+        case ResultadoPartida::MaterialInsuficiente: return "tablas por material insuficiente";
+        case ResultadoPartida::EnJuego:              break;
+    }
+    return "";
+}
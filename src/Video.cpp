@@ -0,0 +1,338 @@
+// Video.cpp
+// Exporta una partida como animación: la repite jugada a jugada con las mismas animaciones que el
+// juego (deslizamientos, enroques y capturas, Animaciones.hpp), la dibuja fuera de pantalla
+// (sf::RenderTexture) a --fps fijos y guarda cada frame como PNG o como un GIF animado codificado
+// aquí mismo (Gif.hpp), sin programas ni servicios externos.
+// Este hilo dibuja y lee los píxeles directamente en un anillo de --en-vuelo búferes reservados
+// al empezar; varios hilos codifican los frames y otro los escribe en orden. El dibujo no
+// comprime nada y la memoria no crece con la duración de la partida: si los codificadores van
+// por detrás, el dibujo espera a que se libere un búfer.
+// Entrada: un archivo con una partida por línea en la notación del protocolo ("e2e4 e7e5 ...")
+// y la línea que se exporta, o la partida en la propia orden con --jugadas.
+// Salida: si acaba en .gif, un GIF animado (en bucle); si no, una carpeta con un PNG por frame
+// (000000.png, 000001.png, ...).
+// Uso: Video.exe [partidas.txt [--linea 1] | --jugadas "e2e4 e7e5 ..."] [--salida partida.gif]
+//                [--fps 30] [--tam 480] [--pausa 0.6] [--velocidad 1] [--hilos N] [--en-vuelo 16]
+
+#include <SFML/Graphics.hpp>
+#include <SFML/OpenGL.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <filesystem>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "Protocolo.hpp"
+#include "Graficos.hpp"
+#include "Animaciones.hpp"
+#include "Gif.hpp"
+using namespace std;
+
+typedef chrono::steady_clock Reloj;
+
+// la posición final se queda un rato antes de que el GIF vuelva a empezar
+const float PAUSA_FINAL = 2.0f;  // segundos
+
+// ---------------------- Escena ----------------------
+// Un sprite por pieza, como en el juego, y la vista puesta sobre el tablero: las coordenadas son
+// las de la ventana del juego, así que centroCasilla y centrarYescalar valen tal cual.
+struct Escena {
+    map<string, sf::Texture> tex;
+    sf::Sprite tablero;
+    vector<SpritePieza> graficos;
+    PlanificadorAnimaciones animaciones;
+    sf::RenderTexture lienzo;
+    unsigned tam = 0;
+
+    bool iniciar(unsigned t){
+        const char* nombres[] = { "PeonB","PeonR","TorreB","TorreR","CaballoB","CaballoR",
+                                  "AlfilB","AlfilR","DamaB","DamaR","ReyB","ReyR","Tablero" };
+        for (const char* n : nombres){
+            if (!cargarTxt(tex[n], string("assets/images/") + n + ".png")) return false;
+            tex[n].setSmooth(true);
+        }
+        inicializarTablero(tablero, tex);
+
+        tam = t;
+        if (!lienzo.create(tam, tam)) return false;
+        lienzo.setSmooth(true);
+        lienzo.setView(sf::View(sf::FloatRect((float)TABLERO_X, (float)TABLERO_Y, 8.0f * TAM_CASILLA, 8.0f * TAM_CASILLA)));
+        return true;
+    }
+
+    // Sprites en la posición de 'e' (el planificador guarda punteros a ellos: no se redimensiona después)
+    void colocar(const EstadoPartida &e){
+        graficos.assign(e.piezas.size(), SpritePieza());
+        for (int i=0; i<(int)e.piezas.size(); ++i){
+            const Pieza &p = e.piezas[i];
+            SpritePieza &g = graficos[i];
+            g.sprite.setTexture(tex[claveTextura(p.tipo, p.color)]);
+            const sf::Texture* t = g.sprite.getTexture();
+            g.baseSx = (float)TAM_CASILLA / (float)t->getSize().x;
+            g.baseSy = (float)TAM_CASILLA / (float)t->getSize().y;
+            g.sprite.setScale(g.baseSx, g.baseSy);
+            centrarYescalar(g.sprite, p.fila, p.col);
+        }
+    }
+
+    // Como animarJugada en Juego.cpp
+    void animar(const EstadoPartida &e, const EfectoJugada &ef){
+        if (ef.victima != -1){
+            SpritePieza &v = graficos[ef.victima];
+            animaciones.capturar(v.sprite, v.baseSx, v.baseSy, DURACION_ANIMACION_CAPTURA, &v.animandoCaptura);
+        }
+        const Pieza &m = e.piezas[ef.mover];
+        graficos[ef.mover].sprite.setTexture(tex[claveTextura(m.tipo, m.color)]);
+        animaciones.mover(graficos[ef.mover].sprite, centroCasilla(m.fila, m.col), DURACION_ANIMACION_MOVIMIENTO);
+        if (ef.torre != -1){
+            const Pieza &t = e.piezas[ef.torre];
+            animaciones.mover(graficos[ef.torre].sprite, centroCasilla(t.fila, t.col),
+                              DURACION_ANIMACION_MOVIMIENTO * 2.0f, Suavizado::EntradaSalidaCubica);
+        }
+    }
+
+    // Dibuja y lee los píxeles en 'rgba' (tam*tam*4 bytes, la fila de abajo primero) sin pasar
+    // por un sf::Image, que reservaría memoria en cada frame
+    void dibujar(const EstadoPartida &e, uint8_t *rgba){
+        lienzo.clear();
+        lienzo.draw(tablero);
+        for (int i=0; i<(int)e.piezas.size(); ++i)
+            if (e.piezas[i].alive || graficos[i].animandoCaptura) lienzo.draw(graficos[i].sprite);
+        lienzo.display();
+        lienzo.setActive(true);
+        glReadPixels(0, 0, (GLsizei)tam, (GLsizei)tam, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    }
+};
+
+// ---------------------- Entrada ----------------------
+bool leerPartida(const string &ruta, long numLinea, string &jugadas){
+    ifstream in(ruta);
+    if (!in) return false;
+    for (long n=1; getline(in, jugadas); ++n)
+        if (n == numLinea){
+            if (!jugadas.empty() && jugadas.back() == '\r') jugadas.pop_back();
+            return true;
+        }
+    return false;
+}
+
+// ---------------------- Tubería ----------------------
+// Ranuras en anillo: el frame k usa la ranura k % enVuelo. Los codificadores toman los frames en
+// orden y el escritor saca el siguiente en cuanto está hecho. El frame k del GIF se compara con
+// el k-1, así que una ranura se reutiliza cuando el frame siguiente ya está escrito: el dibujo
+// espera a que dibujados - escritos < enVuelo - 1.
+struct Ranura {
+    vector<uint8_t> rgba;           // reservado al empezar y reutilizado
+    vector<uint8_t> datos;          // el frame ya codificado (GIF)
+    bool hecho = false;
+    bool ok = true;
+};
+
+int main(int argc, char** argv){
+    string entrada, jugadas, salida = "partida.gif";
+    long numLinea = 1;
+    bool conJugadas = false;
+    unsigned tam = 480;
+    int fps = 30;
+    float pausa = 0.6f, velocidad = 1.0f;
+    int hilos = (int)thread::hardware_concurrency();
+    long enVuelo = 16;
+    for (int i=1; i<argc; ++i){
+        string arg = argv[i];
+        if (arg == "--jugadas" && i+1 < argc){ jugadas = argv[++i]; conJugadas = true; }
+        else if (arg == "--linea" && i+1 < argc) numLinea = atol(argv[++i]);
+        else if (arg == "--salida" && i+1 < argc) salida = argv[++i];
+        else if (arg == "--tam" && i+1 < argc) tam = (unsigned)atoi(argv[++i]);
+        else if (arg == "--fps" && i+1 < argc) fps = atoi(argv[++i]);
+        else if (arg == "--pausa" && i+1 < argc) pausa = (float)atof(argv[++i]);
+        else if (arg == "--velocidad" && i+1 < argc) velocidad = (float)atof(argv[++i]);
+        else if (arg == "--hilos" && i+1 < argc) hilos = atoi(argv[++i]);
+        else if (arg == "--en-vuelo" && i+1 < argc) enVuelo = atol(argv[++i]);
+        else entrada = arg;
+    }
+    if (hilos < 1) hilos = 1;
+    if (enVuelo < 3) enVuelo = 3;
+    if (tam < 16) tam = 16;
+    if (fps < 1) fps = 1;
+    if (fps > 50) fps = 50;              // los visores no respetan retardos de menos de 2 centésimas
+    if (pausa < 0) pausa = 0;
+    if (velocidad <= 0) velocidad = 1.0f;
+    if (!conJugadas){
+        if (entrada.empty()){ cerr << "Uso: Video.exe [partidas.txt [--linea 1] | --jugadas \"e2e4 ...\"] [--salida partida.gif | carpeta] [--fps 30] [--tam 480]\n"; return 1; }
+        if (!leerPartida(entrada, numLinea, jugadas)){ cerr << "No se puede leer la línea " << numLinea << " de " << entrada << "\n"; return 1; }
+    }
+
+    bool gif = salida.size() >= 4 && salida.compare(salida.size() - 4, 4, ".gif") == 0;
+    FILE *out = nullptr;
+    if (gif){
+        out = fopen(salida.c_str(), "wb");
+        if (!out){ cerr << "No se puede escribir " << salida << "\n"; return 1; }
+    } else {
+        std::error_code ec;
+        filesystem::create_directories(salida, ec);
+    }
+
+    Escena escena;
+    if (!escena.iniciar(tam)){ cerr << "No se pudo preparar el dibujo\n"; return 1; }
+    escena.animaciones.velocidad = velocidad;
+
+    vector<Ranura> ranuras(enVuelo);
+    for (Ranura &r : ranuras) r.rgba.resize((size_t)tam * tam * 4);
+    PaletaGif paleta;                    // del primer frame; se calcula antes de publicarlo
+    mutex m;
+    condition_variable cv;
+    long dibujados = 0, tomados = 0, escritos = 0, fallidos = 0;
+    size_t bytesGif = 0;
+    bool finDibujo = false;
+
+    // retardo del frame k en centésimas, repartiendo el redondeo para que la duración total cuadre
+    auto retardo = [&](long k){ return (int)(llround((k + 1) * 100.0 / fps) - llround(k * 100.0 / fps)); };
+
+    vector<thread> codificadores;
+    for (int h=0; h<hilos; ++h){
+        codificadores.emplace_back([&](){
+            CompresorLzw lzw;
+            sf::Image imagen;
+            char nombre[32];
+            for (;;){
+                long k;
+                {
+                    unique_lock<mutex> lock(m);
+                    cv.wait(lock, [&]{ return tomados < dibujados || finDibujo; });
+                    if (tomados == dibujados) return;
+                    k = tomados++;
+                }
+                Ranura &r = ranuras[k % enVuelo];
+                r.datos.clear();
+                if (gif){
+                    const uint8_t *anterior = k > 0 ? ranuras[(k - 1) % enVuelo].rgba.data() : nullptr;
+                    frameGif(r.datos, r.rgba.data(), anterior, (int)tam, (int)tam, true, retardo(k), paleta, lzw);
+                } else {
+                    imagen.create(tam, tam, r.rgba.data());
+                    imagen.flipVertically();
+                    snprintf(nombre, sizeof(nombre), "/%06ld.png", k);
+                    r.ok = imagen.saveToFile(salida + nombre);
+                }
+                {
+                    lock_guard<mutex> lock(m);
+                    r.hecho = true;
+                }
+                cv.notify_all();
+            }
+        });
+    }
+
+    thread escritor([&](){
+        vector<uint8_t> cabecera;
+        for (;;){
+            Ranura *r;
+            {
+                unique_lock<mutex> lock(m);
+                cv.wait(lock, [&]{ return ranuras[escritos % enVuelo].hecho || (finDibujo && escritos == dibujados); });
+                if (!ranuras[escritos % enVuelo].hecho) break;
+                r = &ranuras[escritos % enVuelo];
+            }
+            if (gif){
+                if (escritos == 0){
+                    cabeceraGif(cabecera, (int)tam, (int)tam, paleta);
+                    fwrite(cabecera.data(), 1, cabecera.size(), out);
+                    bytesGif += cabecera.size();
+                }
+                fwrite(r->datos.data(), 1, r->datos.size(), out);
+                bytesGif += r->datos.size();
+            }
+            {
+                lock_guard<mutex> lock(m);
+                if (!r->ok) fallidos++;
+                r->hecho = false;
+                escritos++;
+            }
+            cv.notify_all();
+        }
+        if (gif){
+            fputc(FIN_GIF, out);
+            bytesGif++;
+        }
+    });
+
+    // dibujo (este hilo: el contexto de OpenGL es suyo); la ranura se llena sin el cerrojo
+    Reloj::time_point t0 = Reloj::now();
+    double segundosDibujo = 0, segundosEspera = 0;
+    EstadoPartida e;
+    e.iniciar();
+    escena.colocar(e);
+
+    auto emitir = [&](){
+        Reloj::time_point t1 = Reloj::now();
+        Ranura *r;
+        {
+            unique_lock<mutex> lock(m);
+            cv.wait(lock, [&]{ return dibujados - escritos < enVuelo - 1; });
+            r = &ranuras[dibujados % enVuelo];
+        }
+        Reloj::time_point t2 = Reloj::now();
+        escena.dibujar(e, r->rgba.data());
+        if (gif && dibujados == 0) paleta.calcular(r->rgba.data(), (size_t)tam * tam);
+        segundosEspera += chrono::duration<double>(t2 - t1).count();
+        segundosDibujo += chrono::duration<double>(Reloj::now() - t2).count();
+        {
+            lock_guard<mutex> lock(m);
+            dibujados++;
+        }
+        cv.notify_all();
+    };
+    auto mantener = [&](float segundos){
+        for (long f = lround(segundos * fps); f > 0; --f) emitir();
+    };
+
+    const float dt = 1.0f / (float)fps;
+    int numJugadas = 0;
+    string error;
+    mantener(pausa);
+    istringstream in(jugadas);
+    string txt;
+    while (in >> txt){
+        Jugada j;
+        EfectoJugada ef;
+        if (!textoAJugada(txt, j) || !e.jugar(j, &ef)){ error = "jugada no válida: " + txt; break; }
+        numJugadas++;
+        escena.animar(e, ef);
+        do {
+            escena.animaciones.avanzar(dt);
+            emitir();
+        } while (escena.animaciones.numActivos > 0);
+        mantener(pausa);
+    }
+    mantener(PAUSA_FINAL);
+    if (dibujados == 0) emitir();       // al menos un frame aunque todas las pausas sean 0
+
+    {
+        lock_guard<mutex> lock(m);
+        finDibujo = true;
+    }
+    cv.notify_all();
+    for (thread &t : codificadores) t.join();
+    escritor.join();
+    if (out) fclose(out);
+
+    double segundos = chrono::duration<double>(Reloj::now() - t0).count();
+    if (!error.empty()) cerr << error << " (se exporta hasta la jugada " << numJugadas << ")\n";
+    cout << numJugadas << " jugadas, " << escritos << " frames de " << tam << "x" << tam << " a " << fps << " fps ("
+         << (double)escritos / fps << " s de vídeo) en " << segundos << " s (" << escritos / segundos << " frames/s), "
+         << hilos << " hilos de codificación\n"
+         << "dibujo y lectura " << segundosDibujo << " s | esperando búfer libre " << segundosEspera << " s | búferes "
+         << enVuelo << " x " << ((size_t)tam * tam * 4) / 1024 << " KiB";
+    if (gif) cout << " | " << salida << " " << bytesGif / 1024 << " KiB";
+    else cout << " | " << salida << "/";
+    if (fallidos) cout << " | no se pudieron escribir " << fallidos;
+    cout << "\n";
+    return (fallidos || !error.empty()) ? 1 : 0;
+}